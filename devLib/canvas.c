@@ -0,0 +1,750 @@
+/*
+ * canvas.c:
+ *	1-bit deep drawing surface in the page layout used by the KS0108,
+ *	SSD1306 and friends. The graphics drivers keep their framebuffer
+ *	in one of these and just send the dirty parts of it.
+ *
+ *	Everything that can be is drawn as a rectangle in device space
+ *	rather than a pixel at a time: the rotation is done once per call,
+ *	and a span fills up to 32 pixels of a row with one word operation.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "font.h"
+#include "canvas.h"
+
+#define	FONT_CHARS	256
+
+
+/*
+ * rotate:
+ *	Turn user coordinates into device ones for the current orientation:
+ *	0: Normal
+ *	1: Rotated a quarter turn - X runs down the device's rows
+ *	2: Upside down
+ *	3: Rotated the other way
+ *********************************************************************************
+ */
+
+static void rotate (const struct canvas *c, int *x, int *y)
+{
+  register int tmp ;
+
+  switch (c->orientation)
+  {
+    case 0:
+      break ;
+
+    case 1:
+      tmp = *x ;
+      *x  = *y ;
+      *y  = c->height - tmp - 1 ;
+      break ;
+
+    case 2:
+      *x = c->width  - *x - 1 ;
+      *y = c->height - *y - 1 ;
+      break ;
+
+    case 3:
+      tmp = *x ;
+      *x  = c->width - *y - 1 ;
+      *y  = tmp ;
+      break ;
+  }
+}
+
+
+/*
+ * orientRect:
+ *	Turn a user rectangle into a device one with x1 <= x2 and y1 <= y2
+ *********************************************************************************
+ */
+
+static void orientRect (struct canvas *c, int *x1, int *y1, int *x2, int *y2)
+{
+  register int tmp ;
+
+  canvasOrient (c, x1, y1) ;
+  canvasOrient (c, x2, y2) ;
+
+  if (*x1 > *x2) { tmp = *x1 ; *x1 = *x2 ; *x2 = tmp ; }
+  if (*y1 > *y2) { tmp = *y1 ; *y1 = *y2 ; *y2 = tmp ; }
+}
+
+
+/*
+ * markDirty: putByte: setPixel:
+ *	Update the device buffer, noting which columns actually changed
+ *********************************************************************************
+ */
+
+static inline void markDirty (struct canvas *c, int page, int lo, int hi)
+{
+  if (lo < c->dirtyLo [page]) c->dirtyLo [page] = lo ;
+  if (hi > c->dirtyHi [page]) c->dirtyHi [page] = hi ;
+}
+
+static inline void putByte (struct canvas *c, int page, int x, unsigned char value, unsigned char mask)
+{
+  unsigned char *ptr, new ;
+
+  if ((page < 0) || (page >= c->pages) || (mask == 0))
+    return ;
+
+  ptr = &c->buffer [page * c->width + x] ;
+  new = (*ptr & ~mask) | (value & mask) ;
+  if (new != *ptr)
+  {
+    *ptr = new ;
+    markDirty (c, page, x, x) ;
+  }
+}
+
+static inline void setPixel (struct canvas *c, int x, int y, int colour)
+{
+  canvasOrient (c, &x, &y) ;
+
+  if ((x < 0) || (x >= c->width) || (y < 0) || (y >= c->height))
+    return ;
+
+  putByte (c, y >> 3, x, (colour != 0) ? 0xFF : 0x00, 1 << (y & 7)) ;
+}
+
+
+/*
+ * spanFill:
+ *	Set the masked bits of count consecutive column bytes - that's a
+ *	horizontal span of up to 8 rows - 4 columns at a time.
+ *	Returns non-zero if anything changed.
+ *********************************************************************************
+ */
+
+static unsigned int spanFill (unsigned char *ptr, int count, unsigned char mask, int colour)
+{
+  uint32_t mask32  = mask * 0x01010101u ;
+  uint32_t value32 = (colour != 0) ? mask32 : 0 ;
+  uint32_t word, new ;
+  unsigned int changed = 0 ;
+
+  for (; count >= 4 ; count -= 4, ptr += 4)
+  {
+    memcpy (&word, ptr, 4) ;
+    new      = (word & ~mask32) | value32 ;
+    changed |= word ^ new ;
+    memcpy (ptr, &new, 4) ;
+  }
+
+  for (; count > 0 ; --count, ++ptr)
+  {
+    new      = (*ptr & ~mask) | (value32 & mask) ;
+    changed |= *ptr ^ new ;
+    *ptr     = new ;
+  }
+
+  return changed ;
+}
+
+
+/*
+ * fillDevice:
+ *	Fill a device rectangle, clipped to the screen
+ *********************************************************************************
+ */
+
+static void fillDevice (struct canvas *c, int x1, int y1, int x2, int y2, int colour)
+{
+  int page, last ;
+  unsigned char mask ;
+
+  if (x1 < 0) x1 = 0 ;
+  if (y1 < 0) y1 = 0 ;
+  if (x2 >= c->width)  x2 = c->width  - 1 ;
+  if (y2 >= c->height) y2 = c->height - 1 ;
+
+  if ((x1 > x2) || (y1 > y2))
+    return ;
+
+  last = y2 >> 3 ;
+  for (page = y1 >> 3 ; page <= last ; ++page)
+  {
+    mask = 0xFF ;
+    if (page == (y1 >> 3)) mask &= 0xFF << (y1 & 7) ;
+    if (page == last)      mask &= 0xFF >> (7 - (y2 & 7)) ;
+
+    if (spanFill (&c->buffer [page * c->width + x1], x2 - x1 + 1, mask, colour) != 0)
+      markDirty (c, page, x1, x2) ;
+  }
+}
+
+
+/*
+ * buildGlyphs:
+ *	Render the font into device page layout for the current orientation,
+ *	so printing a character is a blit rather than a point at a time.
+ *********************************************************************************
+ */
+
+static void buildGlyphs (struct canvas *c)
+{
+  int ch, row, bit, x, y, x0, y0, x1, y1, pages ;
+  unsigned char *glyph, line ;
+
+  x0 = 0 ;             y0 = 0 ;
+  x1 = fontWidth - 1 ; y1 = fontHeight - 1 ;
+  rotate (c, &x0, &y0) ;
+  rotate (c, &x1, &y1) ;
+  if (x1 < x0) x0 = x1 ;
+  if (y1 < y0) y0 = y1 ;
+
+  c->glyphWidth  = (c->orientation & 1) ? fontHeight : fontWidth ;
+  c->glyphHeight = (c->orientation & 1) ? fontWidth  : fontHeight ;
+  pages          = (c->glyphHeight + 7) / 8 ;
+
+  memset (c->glyphs, 0, FONT_CHARS * c->glyphWidth * pages) ;
+
+  for (ch = 0 ; ch < FONT_CHARS ; ++ch)
+  {
+    glyph = c->glyphs + ch * c->glyphWidth * pages ;
+
+// The first line of each character is the top one, and user Y runs up
+
+    for (row = 0 ; row < fontHeight ; ++row)
+    {
+      line = font [ch * fontHeight + row] ;
+      for (bit = 0 ; bit < fontWidth ; ++bit)
+      {
+	if ((line & (0x80 >> bit)) == 0)
+	  continue ;
+
+	x = bit ;
+	y = fontHeight - 1 - row ;
+	rotate (c, &x, &y) ;
+	x -= x0 ;
+	y -= y0 ;
+	glyph [(y >> 3) * c->glyphWidth + x] |= 1 << (y & 7) ;
+      }
+    }
+  }
+}
+
+
+/*
+ * canvasInit: canvasFree:
+ *	Set up a canvas for a device width x height pixels. height needn't
+ *	be a multiple of 8. Returns 0, or -1 if we're out of memory.
+ *********************************************************************************
+ */
+
+int canvasInit (struct canvas *c, int width, int height)
+{
+  int glyphSize ;
+
+  memset (c, 0, sizeof (*c)) ;
+
+  c->width  = width ;
+  c->height = height ;
+  c->pages  = (height + 7) / 8 ;
+
+  glyphSize = fontWidth * ((fontHeight + 7) / 8) ;
+  if (fontHeight * ((fontWidth + 7) / 8) > glyphSize)
+    glyphSize = fontHeight * ((fontWidth + 7) / 8) ;
+
+  c->buffer  = (unsigned char *)malloc (c->pages * width) ;
+  c->dirtyLo = (int *)malloc (c->pages * sizeof (int)) ;
+  c->dirtyHi = (int *)malloc (c->pages * sizeof (int)) ;
+  c->glyphs  = (unsigned char *)malloc (FONT_CHARS * glyphSize) ;
+
+  if ((c->buffer == NULL) || (c->dirtyLo == NULL) || (c->dirtyHi == NULL) || (c->glyphs == NULL))
+  {
+    canvasFree (c) ;
+    return -1 ;
+  }
+
+  canvasSetOrientation (c, 0) ;
+  canvasClear          (c, 0) ;
+
+  return 0 ;
+}
+
+void canvasFree (struct canvas *c)
+{
+  free (c->buffer)  ; c->buffer  = NULL ;
+  free (c->dirtyLo) ; c->dirtyLo = NULL ;
+  free (c->dirtyHi) ; c->dirtyHi = NULL ;
+  free (c->glyphs)  ; c->glyphs  = NULL ;
+}
+
+
+/*
+ * canvasSetOrigin: canvasSetOrientation:
+ *	Set the user origin, and the orientation - which also resets the
+ *	origin.
+ *********************************************************************************
+ */
+
+void canvasSetOrigin (struct canvas *c, int x, int y)
+{
+  c->xOrigin = x ;
+  c->yOrigin = y ;
+}
+
+void canvasSetOrientation (struct canvas *c, int orientation)
+{
+  c->orientation = orientation & 3 ;
+
+  canvasSetOrigin (c, 0, 0) ;
+
+  if (c->orientation & 1)
+  {
+    c->maxX = c->height ;
+    c->maxY = c->width ;
+  }
+  else
+  {
+    c->maxX = c->width ;
+    c->maxY = c->height ;
+  }
+
+  buildGlyphs (c) ;
+}
+
+
+/*
+ * canvasOrient: canvasGetSize: canvasClean:
+ *	Turn user coordinates into device ones, return the user screen
+ *	size, and mark a page as sent.
+ *********************************************************************************
+ */
+
+void canvasOrient (struct canvas *c, int *x, int *y)
+{
+  *x += c->xOrigin ;
+  *y += c->yOrigin ;
+
+  rotate (c, x, y) ;
+}
+
+void canvasGetSize (struct canvas *c, int *x, int *y)
+{
+  *x = c->maxX ;
+  *y = c->maxY ;
+}
+
+void canvasClean (struct canvas *c, int page)
+{
+  c->dirtyLo [page] = c->width ;
+  c->dirtyHi [page] = -1 ;
+}
+
+
+/*
+ *********************************************************************************
+ * Standard Graphical Functions
+ *********************************************************************************
+ */
+
+
+/*
+ * canvasPoint:
+ *	Plot a pixel.
+ *********************************************************************************
+ */
+
+void canvasPoint (struct canvas *c, int x, int y, int colour)
+{
+  c->lastX = x ;
+  c->lastY = y ;
+
+  setPixel (c, x, y, colour) ;
+}
+
+
+/*
+ * canvasFillRect:
+ *	Fill a rectangle given any two opposite corners
+ *********************************************************************************
+ */
+
+void canvasFillRect (struct canvas *c, int x1, int y1, int x2, int y2, int colour)
+{
+  orientRect (c, &x1, &y1, &x2, &y2) ;
+  fillDevice (c, x1, y1, x2, y2, colour) ;
+}
+
+
+/*
+ * canvasLine: canvasLineTo:
+ *	Classic Bressenham Line code - horizontal and vertical lines are
+ *	filled as rectangles.
+ *********************************************************************************
+ */
+
+void canvasLine (struct canvas *c, int x0, int y0, int x1, int y1, int colour)
+{
+  int dx, dy ;
+  int sx, sy ;
+  int err, e2 ;
+
+  c->lastX = x1 ;
+  c->lastY = y1 ;
+
+  if ((x0 == x1) || (y0 == y1))
+  {
+    canvasFillRect (c, x0, y0, x1, y1, colour) ;
+    return ;
+  }
+
+  dx = abs (x1 - x0) ;
+  dy = abs (y1 - y0) ;
+
+  sx = (x0 < x1) ? 1 : -1 ;
+  sy = (y0 < y1) ? 1 : -1 ;
+
+  err = dx - dy ;
+
+  for (;;)
+  {
+    setPixel (c, x0, y0, colour) ;
+
+    if ((x0 == x1) && (y0 == y1))
+      break ;
+
+    e2 = 2 * err ;
+
+    if (e2 > -dy)
+    {
+      err -= dy ;
+      x0  += sx ;
+    }
+
+    if (e2 < dx)
+    {
+      err += dx ;
+      y0  += sy ;
+    }
+  }
+}
+
+void canvasLineTo (struct canvas *c, int x, int y, int colour)
+{
+  canvasLine (c, c->lastX, c->lastY, x, y, colour) ;
+}
+
+
+/*
+ * canvasRectangle:
+ *	A rectangle is a spoilt days fishing
+ *********************************************************************************
+ */
+
+void canvasRectangle (struct canvas *c, int x1, int y1, int x2, int y2, int colour, int filled)
+{
+  if (filled)
+  {
+    canvasFillRect (c, x1, y1, x2, y2, colour) ;
+    c->lastX = x2 ;
+    c->lastY = y2 ;
+  }
+  else
+  {
+    canvasLine   (c, x1, y1, x2, y1, colour) ;
+    canvasLineTo (c, x2, y2, colour) ;
+    canvasLineTo (c, x1, y2, colour) ;
+    canvasLineTo (c, x1, y1, colour) ;
+  }
+}
+
+
+/*
+ * canvasCircle:
+ *      This is the midpoint circle algorithm.
+ *********************************************************************************
+ */
+
+void canvasCircle (struct canvas *c, int x, int y, int r, int colour, int filled)
+{
+  int ddF_x = 1 ;
+  int ddF_y = -2 * r ;
+
+  int f = 1 - r ;
+  int x1 = 0 ;
+  int y1 = r ;
+
+  if (filled)
+  {
+    canvasLine (c, x, y + r, x, y - r, colour) ;
+    canvasLine (c, x + r, y, x - r, y, colour) ;
+  }
+  else
+  {
+    canvasPoint (c, x, y + r, colour) ;
+    canvasPoint (c, x, y - r, colour) ;
+    canvasPoint (c, x + r, y, colour) ;
+    canvasPoint (c, x - r, y, colour) ;
+  }
+
+  while (x1 < y1)
+  {
+    if (f >= 0)
+    {
+      y1-- ;
+      ddF_y += 2 ;
+      f += ddF_y ;
+    }
+    x1++ ;
+    ddF_x += 2 ;
+    f += ddF_x ;
+    if (filled)
+    {
+      canvasLine (c, x + x1, y + y1, x - x1, y + y1, colour) ;
+      canvasLine (c, x + x1, y - y1, x - x1, y - y1, colour) ;
+      canvasLine (c, x + y1, y + x1, x - y1, y + x1, colour) ;
+      canvasLine (c, x + y1, y - x1, x - y1, y - x1, colour) ;
+    }
+    else
+    {
+      canvasPoint (c, x + x1, y + y1, colour) ; canvasPoint (c, x - x1, y + y1, colour) ;
+      canvasPoint (c, x + x1, y - y1, colour) ; canvasPoint (c, x - x1, y - y1, colour) ;
+      canvasPoint (c, x + y1, y + x1, colour) ; canvasPoint (c, x - y1, y + x1, colour) ;
+      canvasPoint (c, x + y1, y - x1, colour) ; canvasPoint (c, x - y1, y - x1, colour) ;
+    }
+  }
+}
+
+
+/*
+ * canvasEllipse:
+ *	Fast ellipse drawing algorithm by
+ *      John Kennedy
+ *	Mathematics Department
+ *	Santa Monica College
+ *	1900 Pico Blvd.
+ *	Santa Monica, CA 90405
+ *	jrkennedy6@gmail.com
+ *	-Confirned in email this algorithm is in the public domain -GH-
+ *********************************************************************************
+ */
+
+static void plot4ellipsePoints (struct canvas *c, int cx, int cy, int x, int y, int colour, int filled)
+{
+  if (filled)
+  {
+    canvasLine (c, cx + x, cy + y, cx - x, cy + y, colour) ;
+    canvasLine (c, cx - x, cy - y, cx + x, cy - y, colour) ;
+  }
+  else
+  {
+    canvasPoint (c, cx + x, cy + y, colour) ;
+    canvasPoint (c, cx - x, cy + y, colour) ;
+    canvasPoint (c, cx - x, cy - y, colour) ;
+    canvasPoint (c, cx + x, cy - y, colour) ;
+  }
+}
+
+void canvasEllipse (struct canvas *c, int cx, int cy, int xRadius, int yRadius, int colour, int filled)
+{
+  int x, y ;
+  int xChange, yChange, ellipseError ;
+  int twoAsquare, twoBsquare ;
+  int stoppingX, stoppingY ;
+
+  twoAsquare = 2 * xRadius * xRadius ;
+  twoBsquare = 2 * yRadius * yRadius ;
+
+  x = xRadius ;
+  y = 0 ;
+
+  xChange = yRadius * yRadius * (1 - 2 * xRadius) ;
+  yChange = xRadius * xRadius ;
+
+  ellipseError = 0 ;
+  stoppingX    = twoBsquare * xRadius ;
+  stoppingY    = 0 ;
+
+  while (stoppingX >= stoppingY)	// 1st set of points
+  {
+    plot4ellipsePoints (c, cx, cy, x, y, colour, filled) ;
+    ++y ;
+    stoppingY    += twoAsquare ;
+    ellipseError += yChange ;
+    yChange      += twoAsquare ;
+
+    if ((2 * ellipseError + xChange) > 0 )
+    {
+      --x ;
+      stoppingX    -= twoBsquare ;
+      ellipseError += xChange ;
+      xChange      += twoBsquare ;
+    }
+  }
+
+  x = 0 ;
+  y = yRadius ;
+
+  xChange = yRadius * yRadius ;
+  yChange = xRadius * xRadius * (1 - 2 * yRadius) ;
+
+  ellipseError = 0 ;
+  stoppingX    = 0 ;
+  stoppingY    = twoAsquare * yRadius ;
+
+  while (stoppingX <= stoppingY)	//2nd set of points
+  {
+    plot4ellipsePoints (c, cx, cy, x, y, colour, filled) ;
+    ++x ;
+    stoppingX    += twoBsquare ;
+    ellipseError += xChange ;
+    xChange      += twoBsquare ;
+
+    if ((2 * ellipseError + yChange) > 0 )
+    {
+      --y ;
+      stoppingY -= twoAsquare ;
+      ellipseError += yChange ;
+      yChange += twoAsquare ;
+    }
+  }
+}
+
+
+/*
+ * canvasBlit:
+ *	Copy a bitmap to the device rectangle with its lowest corner at
+ *	dx, dy, clipped to the screen. The bitmap is w columns by h rows in
+ *	the same page layout as the canvas, and isn't rotated. Set bits are
+ *	drawn in fgCol and clear ones in bgCol, a byte at a time.
+ *********************************************************************************
+ */
+
+void canvasBlit (struct canvas *c, int dx, int dy, const unsigned char *bitmap, int w, int h, int bgCol, int fgCol)
+{
+  int i, x, y, page, srcPages, shift, rows ;
+  unsigned char fg, bg, value, mask ;
+
+  fg       = (fgCol != 0) ? 0xFF : 0x00 ;
+  bg       = (bgCol != 0) ? 0xFF : 0x00 ;
+  srcPages = (h + 7) / 8 ;
+
+  for (i = 0 ; i < w ; ++i)
+  {
+    x = dx + i ;
+    if ((x < 0) || (x >= c->width))
+      continue ;
+
+    for (page = 0 ; page < srcPages ; ++page)
+    {
+      rows  = h - page * 8 ;
+      mask  = (rows >= 8) ? 0xFF : (1 << rows) - 1 ;
+      value = bitmap [page * w + i] ;
+      value = ((value & fg) | (~value & bg)) & mask ;
+
+      y     = dy + page * 8 ;
+      shift = y & 7 ;
+
+      putByte (c, y >> 3, x, value << shift, mask << shift) ;
+      if (shift != 0)
+	putByte (c, (y >> 3) + 1, x, value >> (8 - shift), mask >> (8 - shift)) ;
+    }
+  }
+}
+
+
+/*
+ * canvasPutchar:
+ *	Print a single character to the screen
+ *********************************************************************************
+ */
+
+void canvasPutchar (struct canvas *c, int x, int y, int ch, int bgCol, int fgCol)
+{
+  int x2 = x + fontWidth  - 1 ;
+  int y2 = y + fontHeight - 1 ;
+
+  orientRect (c, &x, &y, &x2, &y2) ;
+
+  canvasBlit (c, x, y, c->glyphs + (ch & 0xFF) * c->glyphWidth * ((c->glyphHeight + 7) / 8),
+	c->glyphWidth, c->glyphHeight, bgCol, fgCol) ;
+}
+
+
+/*
+ * canvasPuts:
+ *	Send a string to the display. Obeys \n and \r formatting
+ *********************************************************************************
+ */
+
+void canvasPuts (struct canvas *c, int x, int y, const char *str, int bgCol, int fgCol)
+{
+  int ch, mx, my ;
+
+  mx = x ; my = y ;
+
+  while (*str)
+  {
+    ch = *str++ ;
+
+    if (ch == '\r')
+    {
+      mx = x ;
+      continue ;
+    }
+
+    if (ch == '\n')
+    {
+      mx  = x ;
+      my -= fontHeight ;
+      continue ;
+    }
+
+    canvasPutchar (c, mx, my, ch, bgCol, fgCol) ;
+
+    mx += fontWidth ;
+    if (mx >= (c->maxX - fontWidth))
+    {
+      mx  = 0 ;
+      my -= fontHeight ;
+    }
+  }
+}
+
+
+/*
+ * canvasClear:
+ *	Clear the whole canvas to the given colour.
+ *********************************************************************************
+ */
+
+void canvasClear (struct canvas *c, int colour)
+{
+  int page ;
+
+  memset (c->buffer, (colour != 0) ? 0xFF : 0x00, c->pages * c->width) ;
+
+  for (page = 0 ; page < c->pages ; ++page)
+  {
+    c->dirtyLo [page] = 0 ;
+    c->dirtyHi [page] = c->width - 1 ;
+  }
+}
@@ -0,0 +1,76 @@
+/*
+ * canvas.h:
+ *	1-bit deep drawing surface in the page layout used by the KS0108,
+ *	SSD1306 and friends.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+// canvas:
+//	buffer holds pages of 8 rows, one byte per column with bit 0 the
+//	lowest numbered row of the page: pixel (x, y) of the device is bit
+//	(y & 7) of buffer [(y >> 3) * width + x]. Each page keeps the range
+//	of columns changed since the driver last sent it, lo > hi when clean.
+//
+//	Drawing is in user coordinates, which are rotated to the device by
+//	the orientation and moved by the origin. As with lcd128x64, user Y
+//	runs up the screen.
+
+struct canvas
+{
+  int width, height, pages ;		// Device
+  unsigned char *buffer ;
+  int *dirtyLo, *dirtyHi ;
+
+  int orientation ;
+  int maxX, maxY ;			// User
+  int xOrigin, yOrigin ;
+  int lastX, lastY ;
+
+  unsigned char *glyphs ;		// The font rotated to suit, in page layout
+  int glyphWidth, glyphHeight ;
+} ;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int  canvasInit           (struct canvas *c, int width, int height) ;
+extern void canvasFree           (struct canvas *c) ;
+
+extern void canvasSetOrigin      (struct canvas *c, int x, int y) ;
+extern void canvasSetOrientation (struct canvas *c, int orientation) ;
+extern void canvasOrient         (struct canvas *c, int *x, int *y) ;
+extern void canvasGetSize        (struct canvas *c, int *x, int *y) ;
+extern void canvasClean          (struct canvas *c, int page) ;
+
+extern void canvasPoint          (struct canvas *c, int  x, int  y, int colour) ;
+extern void canvasFillRect       (struct canvas *c, int x1, int y1, int x2, int y2, int colour) ;
+extern void canvasLine           (struct canvas *c, int x0, int y0, int x1, int y1, int colour) ;
+extern void canvasLineTo         (struct canvas *c, int  x, int  y, int colour) ;
+extern void canvasRectangle      (struct canvas *c, int x1, int y1, int x2, int y2, int colour, int filled) ;
+extern void canvasCircle         (struct canvas *c, int  x, int  y, int  r, int colour, int filled) ;
+extern void canvasEllipse        (struct canvas *c, int cx, int cy, int xRadius, int yRadius, int colour, int filled) ;
+extern void canvasBlit           (struct canvas *c, int dx, int dy, const unsigned char *bitmap, int w, int h, int bgCol, int fgCol) ;
+extern void canvasPutchar        (struct canvas *c, int  x, int  y, int ch, int bgCol, int fgCol) ;
+extern void canvasPuts           (struct canvas *c, int  x, int  y, const char *str, int bgCol, int fgCol) ;
+extern void canvasClear          (struct canvas *c, int colour) ;
+
+#ifdef __cplusplus
+}
+#endif
@@ -28,6 +28,7 @@
 #include <stdarg.h>
 
 #include <wiringPi.h>
+#include <wiringShift.h>
 
 #include "ds1302.h"
 
@@ -49,6 +50,10 @@
 
 static int dPin, cPin, sPin ;
 
+// The chip is good for 2MHz at 5v but only 500KHz at 2v
+
+#define	DS_CLOCK	500000
+
 /*
  * dsShiftIn:
  *	Shift a number in from the chip, LSB first. Note that the data is
@@ -58,17 +63,11 @@ static int dPin, cPin, sPin ;
 
 static unsigned int dsShiftIn (void)
 {
-  uint8_t value = 0 ;
-  int i ;
+  uint8_t value ;
 
   pinMode (dPin, INPUT) ;	delayMicroseconds (1) ;
 
-  for (i = 0 ; i < 8 ; ++i)
-  {
-    value |= (digitalRead (dPin) << i) ;
-    digitalWrite (cPin, HIGH) ; delayMicroseconds (1) ;
-    digitalWrite (cPin, LOW) ;	delayMicroseconds (1) ;
-  }
+  shiftInBuf (dPin, cPin, LSBFIRST, &value, 1, DS_CLOCK) ;
 
   return value;
 }
@@ -83,16 +82,11 @@ static unsigned int dsShiftIn (void)
 
 static void dsShiftOut (unsigned int data)
 {
-  int i ;
+  uint8_t value = data ;
 
   pinMode (dPin, OUTPUT) ;
 
-  for (i = 0 ; i < 8 ; ++i)
-  {
-    digitalWrite (dPin, data & (1 << i)) ;	delayMicroseconds (1) ;
-    digitalWrite (cPin, HIGH) ;			delayMicroseconds (1) ;
-    digitalWrite (cPin, LOW) ;			delayMicroseconds (1) ;
-  }
+  shiftOutBuf (dPin, cPin, LSBFIRST, &value, 1, DS_CLOCK) ;
 }
 
 
@@ -133,11 +133,62 @@ static int myAnalogRead (struct wiringPiNodeStruct *node, const int chan)
   return gertboardAnalogRead (chan - node->pinBase) ;
 }
 
+static void myAnalogReadMulti (struct wiringPiNodeStruct *node, const int *pins, int *values, int count)
+{
+  uint8_t spiData [2 * 16] ;
+  int i, n ;
+
+// All the conversions in one chained SPI message
+
+  while (count > 0)
+  {
+    n = (count > 16) ? 16 : count ;
+
+    for (i = 0 ; i < n ; ++i)
+    {
+      spiData [i * 2 + 0] = (pins [i] == node->pinBase) ? 0b11010000 : 0b11110000 ;
+      spiData [i * 2 + 1] = 0 ;
+    }
+
+    wiringPiSPIDataRWChain (SPI_A2D, spiData, 2, n) ;
+
+    for (i = 0 ; i < n ; ++i)
+      values [i] = ((spiData [i * 2] << 7) | (spiData [i * 2 + 1] >> 1)) & 0x3FF ;
+
+    pins   += n ;
+    values += n ;
+    count  -= n ;
+  }
+}
+
 static void myAnalogWrite (struct wiringPiNodeStruct *node, const int chan, const int value)
 {
   gertboardAnalogWrite (chan - node->pinBase, value) ;
 }
 
+static void myAnalogWriteMulti (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count)
+{
+  uint8_t spiData [2 * 16] ;
+  int i, n ;
+
+  while (count > 0)
+  {
+    n = (count > 16) ? 16 : count ;
+
+    for (i = 0 ; i < n ; ++i)
+    {
+      spiData [i * 2 + 0] = ((pins [i] == node->pinBase) ? 0x30 : 0xB0) | ((values [i] >> 4) & 0x0F) ;
+      spiData [i * 2 + 1] = ((values [i] << 4) & 0xF0) ;
+    }
+
+    wiringPiSPIDataRWChain (SPI_D2A, spiData, 2, n) ;
+
+    pins   += n ;
+    values += n ;
+    count  -= n ;
+  }
+}
+
 
 /*
  * gertboardAnalogSetup:
@@ -157,8 +208,10 @@ int gertboardAnalogSetup (const int pinBase)
     return  x;
 
   node = wiringPiNewNode (pinBase, 2) ;
-  node->analogRead  = myAnalogRead ;
-  node->analogWrite = myAnalogWrite ;
+  node->analogRead       = myAnalogRead ;
+  node->analogReadMulti  = myAnalogReadMulti ;
+  node->analogWrite      = myAnalogWrite ;
+  node->analogWriteMulti = myAnalogWriteMulti ;
 
   return 0 ;
 }
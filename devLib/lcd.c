@@ -26,9 +26,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 
 #include <wiringPi.h>
+#include <wiringPiI2C.h>
 
 #include "lcd.h"
 
@@ -67,12 +69,38 @@
 
 #define	LCD_CDSHIFT_RL	0x04
 
+// PCF8574 I2C backpack wiring - the usual one: P0 RS, P1 R/W, P2 E,
+//	P3 backlight, P4-P7 D4-D7
+
+#define	LCD_I2C_RS	0x01
+#define	LCD_I2C_E	0x04
+#define	LCD_I2C_BL	0x08
+
+#define	LCD_I2C_BUF	512
+
+// lcdDataStruct:
+//	shadow is what we last put in each character position, so we only
+//	send the ones that change. cx, cy is where the next character goes;
+//	hx, hy is where the display's address counter actually is (hx of -1
+//	when we don't know), and we only move that when we have to.
+
 struct lcdDataStruct
 {
   int bits, rows, cols ;
   int rsPin, strbPin ;
+  int rwPin ;			// -1 if R/W is tied low
   int dataPins [8] ;
   int cx, cy ;
+  int hx, hy ;
+  unsigned char *shadow ;
+
+// I2C backpack: each nibble is 2 bytes for the PCF8574 - with E high,
+//	then low - and they're collected here and sent in one write.
+
+  int           i2cFd ;		// -1 for GPIO pins
+  unsigned char backlight ;
+  unsigned char *i2cBuf ;
+  int           i2cLen ;
 } ;
 
 struct lcdDataStruct *lcds [MAX_LCDS] ;
@@ -84,6 +112,35 @@ static int lcdControl ;
 static const int rowOff [4] = { 0x00, 0x40, 0x14, 0x54 } ;
 
 
+/*
+ * i2cFlush: i2cNibble:
+ *	Queue up a nibble for the backpack and send the queue. At 100kHz
+ *	each byte takes 90uS on the bus, which is longer than both the E
+ *	pulse and the 37uS commands need, so no delays are needed.
+ *********************************************************************************
+ */
+
+static void i2cFlush (struct lcdDataStruct *lcd)
+{
+  if ((lcd->i2cFd < 0) || (lcd->i2cLen == 0))
+    return ;
+
+  wiringPiI2CWriteRaw (lcd->i2cFd, lcd->i2cBuf, lcd->i2cLen) ;
+  lcd->i2cLen = 0 ;
+}
+
+static void i2cNibble (struct lcdDataStruct *lcd, int rs, unsigned char nibble)
+{
+  unsigned char byte = ((nibble & 0x0F) << 4) | lcd->backlight | (rs ? LCD_I2C_RS : 0) ;
+
+  if (lcd->i2cLen > LCD_I2C_BUF - 2)
+    i2cFlush (lcd) ;
+
+  lcd->i2cBuf [lcd->i2cLen++] = byte | LCD_I2C_E ;
+  lcd->i2cBuf [lcd->i2cLen++] = byte ;
+}
+
+
 /*
  * strobe:
  *	Toggle the strobe (Really the "E") pin to the device.
@@ -95,23 +152,87 @@ static void strobe (const struct lcdDataStruct *lcd)
 {
 
 // Note timing changes for new version of delayMicroseconds ()
+//	Without the busy flag the delay after has to cover the slowest
+//	ordinary command (37uS); with it we only need the pulse width.
 
-  digitalWrite (lcd->strbPin, 1) ; delayMicroseconds (50) ;
-  digitalWrite (lcd->strbPin, 0) ; delayMicroseconds (50) ;
+  if (lcd->rwPin == -1)
+  {
+    digitalWrite (lcd->strbPin, 1) ; delayMicroseconds (50) ;
+    digitalWrite (lcd->strbPin, 0) ; delayMicroseconds (50) ;
+  }
+  else
+  {
+    digitalWrite (lcd->strbPin, 1) ; delayMicroseconds (1) ;
+    digitalWrite (lcd->strbPin, 0) ; delayMicroseconds (1) ;
+  }
+}
+
+
+/*
+ * waitBusy:
+ *	Read the busy flag (D7 with RS low and R/W high) until the display
+ *	is ready for more. In 4-bit mode each read is two nibbles, and we
+ *	have to clock out both. Gives up after 10mS, in case the R/W pin
+ *	isn't really connected.
+ *	The data pins must be safe to drive from the display: a 5v display
+ *	needs level shifting before it can be read.
+ *********************************************************************************
+ */
+
+static void waitBusy (const struct lcdDataStruct *lcd)
+{
+  unsigned int start = micros () ;
+  int i, busy, d7 = lcd->bits - 1 ;
+
+  for (i = 0 ; i < lcd->bits ; ++i)
+    pinMode (lcd->dataPins [i], INPUT) ;
+
+  digitalWrite (lcd->rsPin, 0) ;
+  digitalWrite (lcd->rwPin, 1) ;
+
+  do
+  {
+    digitalWrite (lcd->strbPin, 1) ; delayMicroseconds (1) ;
+    busy = digitalRead (lcd->dataPins [d7]) ;
+    digitalWrite (lcd->strbPin, 0) ; delayMicroseconds (1) ;
+
+    if (lcd->bits == 4)
+    {
+      digitalWrite (lcd->strbPin, 1) ; delayMicroseconds (1) ;
+      digitalWrite (lcd->strbPin, 0) ; delayMicroseconds (1) ;
+    }
+  } while (busy && ((micros () - start) < 10000)) ;
+
+  digitalWrite (lcd->rwPin, 0) ;
+
+  for (i = 0 ; i < lcd->bits ; ++i)
+    pinMode (lcd->dataPins [i], OUTPUT) ;
 }
 
 
 /*
  * sentDataCmd:
- *	Send an data or command byte to the display.
+ *	Send an data (rs 1) or command (rs 0) byte to the display.
  *********************************************************************************
  */
 
-static void sendDataCmd (const struct lcdDataStruct *lcd, unsigned char data)
+static void sendDataCmd (struct lcdDataStruct *lcd, int rs, unsigned char data)
 {
   register unsigned char myData = data ;
   unsigned char          i, d4 ;
 
+  if (lcd->i2cFd >= 0)
+  {
+    i2cNibble (lcd, rs, data >> 4) ;
+    i2cNibble (lcd, rs, data) ;
+    return ;
+  }
+
+  if (lcd->rwPin != -1)
+    waitBusy (lcd) ;
+
+  digitalWrite (lcd->rsPin, rs) ;
+
   if (lcd->bits == 4)
   {
     d4 = (myData >> 4) & 0x0F;
@@ -143,22 +264,60 @@ static void sendDataCmd (const struct lcdDataStruct *lcd, unsigned char data)
 
 /*
  * putCommand:
- *	Send a command byte to the display
+ *	Send a command byte to the display. Only clear and home take
+ *	longer than the strobe delay covers (1.52mS) - and with the busy
+ *	flag we don't need to wait at all.
  *********************************************************************************
  */
 
-static void putCommand (const struct lcdDataStruct *lcd, unsigned char command)
+static void putCommand (struct lcdDataStruct *lcd, unsigned char command)
 {
-  digitalWrite (lcd->rsPin,   0) ;
-  sendDataCmd  (lcd, command) ;
-  delay (2) ;
+  sendDataCmd (lcd, 0, command) ;
+
+  if ((lcd->rwPin == -1) && ((command == LCD_CLEAR) || ((command & 0xFE) == LCD_HOME)))
+  {
+    i2cFlush (lcd) ;
+    delay (2) ;
+  }
+}
+
+
+/*
+ * moveTo: syncCursor:
+ *	Point the display's address counter at x, y if it isn't already.
+ *	The logical cursor only gets sent to the display when a character
+ *	needs writing there - or when the cursor is visible.
+ *********************************************************************************
+ */
+
+static void moveTo (struct lcdDataStruct *lcd, int x, int y)
+{
+  if ((lcd->hx == x) && (lcd->hy == y))
+    return ;
+
+  putCommand (lcd, x + (LCD_DGRAM | rowOff [y])) ;
+  lcd->hx = x ;
+  lcd->hy = y ;
+}
+
+static void syncCursor (struct lcdDataStruct *lcd)
+{
+  if (lcdControl & (LCD_CURSOR_CTRL | LCD_BLINK_CTRL))
+    moveTo (lcd, lcd->cx, lcd->cy) ;
 }
 
-static void put4Command (const struct lcdDataStruct *lcd, unsigned char command)
+static void put4Command (struct lcdDataStruct *lcd, unsigned char command)
 {
   register unsigned char myCommand = command ;
   register unsigned char i ;
 
+  if (lcd->i2cFd >= 0)
+  {
+    i2cNibble (lcd, 0, command) ;
+    i2cFlush  (lcd) ;
+    return ;
+  }
+
   digitalWrite (lcd->rsPin,   0) ;
 
   for (i = 0 ; i < 4 ; ++i)
@@ -188,7 +347,9 @@ void lcdHome (const int fd)
 
   putCommand (lcd, LCD_HOME) ;
   lcd->cx = lcd->cy = 0 ;
-  delay (5) ;
+  lcd->hx = lcd->hy = 0 ;
+  if (lcd->rwPin == -1)
+    delay (5) ;
 }
 
 void lcdClear (const int fd)
@@ -198,7 +359,10 @@ void lcdClear (const int fd)
   putCommand (lcd, LCD_CLEAR) ;
   putCommand (lcd, LCD_HOME) ;
   lcd->cx = lcd->cy = 0 ;
-  delay (5) ;
+  lcd->hx = lcd->hy = 0 ;
+  memset (lcd->shadow, ' ', lcd->rows * lcd->cols) ;
+  if (lcd->rwPin == -1)
+    delay (5) ;
 }
 
 
@@ -218,6 +382,7 @@ void lcdDisplay (const int fd, int state)
     lcdControl &= ~LCD_DISPLAY_CTRL ;
 
   putCommand (lcd, LCD_CTRL | lcdControl) ; 
+  i2cFlush   (lcd) ;
 }
 
 void lcdCursor (const int fd, int state)
@@ -230,6 +395,8 @@ void lcdCursor (const int fd, int state)
     lcdControl &= ~LCD_CURSOR_CTRL ;
 
   putCommand (lcd, LCD_CTRL | lcdControl) ; 
+  syncCursor (lcd) ;
+  i2cFlush   (lcd) ;
 }
 
 void lcdCursorBlink (const int fd, int state)
@@ -242,19 +409,29 @@ void lcdCursorBlink (const int fd, int state)
     lcdControl &= ~LCD_BLINK_CTRL ;
 
   putCommand (lcd, LCD_CTRL | lcdControl) ; 
+  syncCursor (lcd) ;
+  i2cFlush   (lcd) ;
 }
 
 
 /*
  * lcdSendCommand:
- *	Send any arbitary command to the display
+ *	Send any arbitary command to the display. We can't tell where it
+ *	leaves the address counter, so we'll set it again next time.
  *********************************************************************************
  */
 
 void lcdSendCommand (const int fd, unsigned char command)
 {
   struct lcdDataStruct *lcd = lcds [fd] ;
+
   putCommand (lcd, command) ;
+
+  lcd->hx = -1 ;
+  if (command == LCD_CLEAR)
+    memset (lcd->shadow, ' ', lcd->rows * lcd->cols) ;
+
+  i2cFlush (lcd) ;
 }
 
 
@@ -269,15 +446,16 @@ void lcdPosition (const int fd, int x, int y)
 {
   struct lcdDataStruct *lcd = lcds [fd] ;
 
-  if ((x > lcd->cols) || (x < 0))
+  if ((x >= lcd->cols) || (x < 0))
     return ;
-  if ((y > lcd->rows) || (y < 0))
+  if ((y >= lcd->rows) || (y < 0))
     return ;
 
-  putCommand (lcd, x + (LCD_DGRAM | rowOff [y])) ;
-
   lcd->cx = x ;
   lcd->cy = y ;
+
+  syncCursor (lcd) ;
+  i2cFlush   (lcd) ;
 }
 
 
@@ -294,47 +472,120 @@ void lcdCharDef (const int fd, int index, unsigned char data [8])
 
   putCommand (lcd, LCD_CGRAM | ((index & 7) << 3)) ;
 
-  digitalWrite (lcd->rsPin, 1) ;
   for (i = 0 ; i < 8 ; ++i)
-    sendDataCmd (lcd, data [i]) ;
+    sendDataCmd (lcd, 1, data [i]) ;
+
+  lcd->hx = -1 ;	// Address counter is in CGRAM now
+  syncCursor (lcd) ;
+  i2cFlush   (lcd) ;
 }
 
 
 /*
- * lcdPutchar:
- *	Send a data byte to be displayed on the display. We implement a very
- *	simple terminal here - with line wrapping, but no scrolling. Yet.
+ * putChar:
+ *	Put a character at the cursor and move it on, but only send it if
+ *	the display doesn't already show it there. The display moves its
+ *	address counter on after a write, but the next row isn't the next
+ *	address, so we lose track of it at the end of a row.
  *********************************************************************************
  */
 
-void lcdPutchar (const int fd, unsigned char data)
+static void putChar (struct lcdDataStruct *lcd, unsigned char data)
 {
-  struct lcdDataStruct *lcd = lcds [fd] ;
+  unsigned char *shadow = &lcd->shadow [lcd->cy * lcd->cols + lcd->cx] ;
 
-  digitalWrite (lcd->rsPin, 1) ;
-  sendDataCmd  (lcd, data) ;
+  if (*shadow != data)
+  {
+    moveTo      (lcd, lcd->cx, lcd->cy) ;
+    sendDataCmd (lcd, 1, data) ;
+    *shadow = data ;
+
+    if (++lcd->hx == lcd->cols)
+      lcd->hx = -1 ;
+  }
 
   if (++lcd->cx == lcd->cols)
   {
     lcd->cx = 0 ;
     if (++lcd->cy == lcd->rows)
       lcd->cy = 0 ;
-    
-    putCommand (lcd, lcd->cx + (LCD_DGRAM | rowOff [lcd->cy])) ;
   }
 }
 
 
+/*
+ * lcdPutchar:
+ *	Send a data byte to be displayed on the display. We implement a very
+ *	simple terminal here - with line wrapping, but no scrolling. Yet.
+ *********************************************************************************
+ */
+
+void lcdPutchar (const int fd, unsigned char data)
+{
+  struct lcdDataStruct *lcd = lcds [fd] ;
+
+  putChar    (lcd, data) ;
+  syncCursor (lcd) ;
+  i2cFlush   (lcd) ;
+}
+
+
 /*
  * lcdPuts:
- *	Send a string to be displayed on the display
+ *	Send a string to be displayed on the display. On an I2C backpack
+ *	the whole string goes in one bus write.
  *********************************************************************************
  */
 
 void lcdPuts (const int fd, const char *string)
 {
+  struct lcdDataStruct *lcd = lcds [fd] ;
+
   while (*string)
-    lcdPutchar (fd, *string++) ;
+    putChar (lcd, *string++) ;
+
+  syncCursor (lcd) ;
+  i2cFlush   (lcd) ;
+}
+
+
+/*
+ * lcdSetRWPin:
+ *	Tell us the display's R/W line is connected to a pin, so we can
+ *	wait on its busy flag rather than allowing for the worst case
+ *	after everything we send.
+ *********************************************************************************
+ */
+
+void lcdSetRWPin (const int fd, const int rwPin)
+{
+  struct lcdDataStruct *lcd = lcds [fd] ;
+
+  if (lcd->i2cFd >= 0)		// Backpacks hold R/W low
+    return ;
+
+  digitalWrite (rwPin, 0) ;
+  pinMode      (rwPin, OUTPUT) ;
+
+  lcd->rwPin = rwPin ;
+}
+
+
+/*
+ * lcdBacklight:
+ *	Turn the backlight on or off - I2C backpacks only.
+ *********************************************************************************
+ */
+
+void lcdBacklight (const int fd, int state)
+{
+  struct lcdDataStruct *lcd = lcds [fd] ;
+
+  if (lcd->i2cFd < 0)
+    return ;
+
+  lcd->backlight = state ? LCD_I2C_BL : 0 ;
+  wiringPiI2CWrite (lcd->i2cFd, lcd->backlight) ;
 }
 
 
@@ -358,20 +609,16 @@ void lcdPrintf (const int fd, const char *message, ...)
 
 
 /*
- * lcdInit:
- *	Take a lot of parameters and initialise the LCD, and return a handle to
- *	that LCD, or -1 if any error.
+ * newLcd:
+ *	Find a free handle and set up the parts of an LCD common to the
+ *	GPIO and I2C versions. Returns the handle or -1.
  *********************************************************************************
  */
 
-int lcdInit (const int rows, const int cols, const int bits,
-	const int rs, const int strb,
-	const int d0, const int d1, const int d2, const int d3, const int d4,
-	const int d5, const int d6, const int d7)
+static int newLcd (const int rows, const int cols)
 {
   static int initialised = 0 ;
 
-  unsigned char func ;
   int i ;
   int lcdFd = -1 ;
   struct lcdDataStruct *lcd ;
@@ -383,11 +630,6 @@ int lcdInit (const int rows, const int cols, const int bits,
       lcds [i] = NULL ;
   }
 
-// Simple sanity checks
-
-  if (! ((bits == 4) || (bits == 8)))
-    return -1 ;
-
   if ((rows < 0) || (rows > 20))
     return -1 ;
 
@@ -412,35 +654,43 @@ int lcdInit (const int rows, const int cols, const int bits,
   if (lcd == NULL)
     return -1 ;
 
-  lcd->rsPin   = rs ;
-  lcd->strbPin = strb ;
-  lcd->bits    = 8 ;		// For now - we'll set it properly later.
-  lcd->rows    = rows ;
-  lcd->cols    = cols ;
-  lcd->cx      = 0 ;
-  lcd->cy      = 0 ;
+  if ((lcd->shadow = (unsigned char *)malloc (rows * cols)) == NULL)
+  {
+    free (lcd) ;
+    return -1 ;
+  }
 
-  lcd->dataPins [0] = d0 ;
-  lcd->dataPins [1] = d1 ;
-  lcd->dataPins [2] = d2 ;
-  lcd->dataPins [3] = d3 ;
-  lcd->dataPins [4] = d4 ;
-  lcd->dataPins [5] = d5 ;
-  lcd->dataPins [6] = d6 ;
-  lcd->dataPins [7] = d7 ;
+  lcd->rsPin     = -1 ;
+  lcd->strbPin   = -1 ;
+  lcd->rwPin     = -1 ;
+  lcd->bits      = 8 ;		// For now - we'll set it properly later.
+  lcd->rows      = rows ;
+  lcd->cols      = cols ;
+  lcd->cx        = 0 ;
+  lcd->cy        = 0 ;
+  lcd->hx        = -1 ;
+  lcd->hy        = 0 ;
+  lcd->i2cFd     = -1 ;
+  lcd->backlight = 0 ;
+  lcd->i2cBuf    = NULL ;
+  lcd->i2cLen    = 0 ;
 
   lcds [lcdFd] = lcd ;
 
-  digitalWrite (lcd->rsPin,   0) ; pinMode (lcd->rsPin,   OUTPUT) ;
-  digitalWrite (lcd->strbPin, 0) ; pinMode (lcd->strbPin, OUTPUT) ;
+  return lcdFd ;
+}
 
-  for (i = 0 ; i < bits ; ++i)
-  {
-    digitalWrite (lcd->dataPins [i], 0) ;
-    pinMode      (lcd->dataPins [i], OUTPUT) ;
-  }
-  delay (35) ; // mS
 
+/*
+ * initDisplay:
+ *	Run the controller's power-on sequence
+ *********************************************************************************
+ */
+
+static void initDisplay (const int lcdFd, const int bits)
+{
+  struct lcdDataStruct *lcd = lcds [lcdFd] ;
+  unsigned char func ;
 
 // 4-bit mode?
 //	OK. This is a PIG and it's not at all obvious from the documentation I had,
@@ -478,7 +728,7 @@ int lcdInit (const int rows, const int cols, const int bits,
   if (lcd->rows > 1)
   {
     func |= LCD_FUNC_N ;
-    putCommand (lcd, func) ; delay (35) ;
+    putCommand (lcd, func) ; i2cFlush (lcd) ; delay (35) ;
   }
 
 // Rest of the initialisation sequence
@@ -490,6 +740,104 @@ int lcdInit (const int rows, const int cols, const int bits,
 
   putCommand (lcd, LCD_ENTRY   | LCD_ENTRY_ID) ;
   putCommand (lcd, LCD_CDSHIFT | LCD_CDSHIFT_RL) ;
+  i2cFlush   (lcd) ;
+}
+
+
+/*
+ * lcdInit:
+ *	Take a lot of parameters and initialise the LCD, and return a handle to
+ *	that LCD, or -1 if any error.
+ *********************************************************************************
+ */
+
+int lcdInit (const int rows, const int cols, const int bits,
+	const int rs, const int strb,
+	const int d0, const int d1, const int d2, const int d3, const int d4,
+	const int d5, const int d6, const int d7)
+{
+  int i ;
+  int lcdFd ;
+  struct lcdDataStruct *lcd ;
+
+// Simple sanity checks
+
+  if (! ((bits == 4) || (bits == 8)))
+    return -1 ;
+
+  if ((lcdFd = newLcd (rows, cols)) == -1)
+    return -1 ;
+
+  lcd = lcds [lcdFd] ;
+
+  lcd->rsPin   = rs ;
+  lcd->strbPin = strb ;
+
+  lcd->dataPins [0] = d0 ;
+  lcd->dataPins [1] = d1 ;
+  lcd->dataPins [2] = d2 ;
+  lcd->dataPins [3] = d3 ;
+  lcd->dataPins [4] = d4 ;
+  lcd->dataPins [5] = d5 ;
+  lcd->dataPins [6] = d6 ;
+  lcd->dataPins [7] = d7 ;
+
+  digitalWrite (lcd->rsPin,   0) ; pinMode (lcd->rsPin,   OUTPUT) ;
+  digitalWrite (lcd->strbPin, 0) ; pinMode (lcd->strbPin, OUTPUT) ;
+
+  for (i = 0 ; i < bits ; ++i)
+  {
+    digitalWrite (lcd->dataPins [i], 0) ;
+    pinMode      (lcd->dataPins [i], OUTPUT) ;
+  }
+  delay (35) ; // mS
+
+  initDisplay (lcdFd, bits) ;
+
+  return lcdFd ;
+}
+
+
+/*
+ * lcdInitI2C:
+ *	Initialise an LCD on a PCF8574 I2C backpack at the given address
+ *	(usually 0x27 or 0x3F). These are always 4-bit. Returns a handle
+ *	or -1 if any error.
+ *********************************************************************************
+ */
+
+int lcdInitI2C (const int rows, const int cols, const int i2cAddress)
+{
+  int fd, lcdFd ;
+  struct lcdDataStruct *lcd ;
+
+  if ((fd = wiringPiI2CSetupShared (i2cAddress)) < 0)
+    return -1 ;
+
+  if ((lcdFd = newLcd (rows, cols)) == -1)
+  {
+    wiringPiI2CClose (fd) ;
+    return -1 ;
+  }
+
+  lcd = lcds [lcdFd] ;
+
+  if ((lcd->i2cBuf = (unsigned char *)malloc (LCD_I2C_BUF)) == NULL)
+  {
+    free (lcd->shadow) ;
+    free (lcd) ;
+    lcds [lcdFd] = NULL ;
+    wiringPiI2CClose (fd) ;
+    return -1 ;
+  }
+
+  lcd->i2cFd     = fd ;
+  lcd->backlight = LCD_I2C_BL ;
+
+  wiringPiI2CWrite (fd, lcd->backlight) ;	// E low, backlight on
+  delay (35) ; // mS
+
+  initDisplay (lcdFd, 4) ;
 
   return lcdFd ;
 }
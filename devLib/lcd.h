@@ -41,11 +41,14 @@ extern void lcdCharDef     (const int fd, int index, unsigned char data [8]) ;
 extern void lcdPutchar     (const int fd, unsigned char data) ;
 extern void lcdPuts        (const int fd, const char *string) ;
 extern void lcdPrintf      (const int fd, const char *message, ...) ;
+extern void lcdSetRWPin    (const int fd, const int rwPin) ;
+extern void lcdBacklight   (const int fd, int state) ;
 
 extern int  lcdInit (const int rows, const int cols, const int bits,
 	const int rs, const int strb,
 	const int d0, const int d1, const int d2, const int d3, const int d4,
 	const int d5, const int d6, const int d7) ;
+extern int  lcdInitI2C (const int rows, const int cols, const int i2cAddress) ;
 
 #ifdef __cplusplus
 }
@@ -7,8 +7,8 @@
  *	There are many variations on these chips, however they all mostly
  *	seem to be similar.
  *	This implementation has the Pins from the Pi hard-wired into it,
- *	in particular wiringPi pins 0-7 so that we can use
- *	digitalWriteByete() to speed things up somewhat.
+ *	in particular wiringPi pins 0-7 as the data bus. When we can get at
+ *	the GPIO registers the bus is written a bank at a time.
  *
  * Copyright (c) 2013 Gordon Henderson.
  ***********************************************************************
@@ -35,9 +35,14 @@
 
 #include <wiringPi.h>
 
-#include "font.h"
+#include "canvas.h"
 #include "lcd128x64.h"
 
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
 // Size
 
 #define	LCD_WIDTH	128
@@ -51,15 +56,122 @@
 #define	STROBE		12
 #define	RS		13
 
+#define	LCD_PINS	14
+
 // Software copy of the framebuffer
-//	it's 8-bit deep although the display itself is only 1-bit deep.
+//	A canvas, which is already in the controller's own layout. Its
+//	device X is our framebuffer X, and its device Y is the controller's
+//	row, so framebuffer row 63 is row 0.
+
+#define	LCD_PAGES	(LCD_HEIGHT / 8)
+
+static struct canvas screen ;
+
+// GPIO banks the pins live in, when we can write them directly
+
+static int          bankMode ;
+static int          pinBank  [LCD_PINS] ;
+static unsigned int pinMask  [LCD_PINS] ;
+static int          dataBanks ;
+static int          dataBank [8] ;
+static unsigned int dataMask [8] ;
+static unsigned int dataBits [8][256] ;	// Bank bits for each data byte
+
+/*
+ * setupBanks:
+ *	Find the GPIO bank and bit for each of our pins, and build a table
+ *	of the bank bits for every data byte so writing the bus is one
+ *	register write per bank. If any pin can't be resolved we fall back
+ *	to digitalWrite for everything.
+ *********************************************************************************
+ */
+
+static void setupBanks (void)
+{
+  int pin, i, bank, value ;
+
+  bankMode  = FALSE ;
+  dataBanks = 0 ;
+
+  for (pin = 0 ; pin < LCD_PINS ; ++pin)
+  {
+    if ((pin == 8) || (pin == 9))
+      continue ;
+    if (wiringPiPinToBank (pin, &pinBank [pin], &pinMask [pin]) != 0)
+      return ;
+  }
+
+  for (pin = 0 ; pin < 8 ; ++pin)
+  {
+    for (bank = 0 ; bank < dataBanks ; ++bank)
+      if (dataBank [bank] == pinBank [pin])
+	break ;
+    if (bank == dataBanks)
+    {
+      dataBank [bank] = pinBank [pin] ;
+      dataMask [bank] = 0 ;
+      ++dataBanks ;
+    }
+    dataMask [bank] |= pinMask [pin] ;
+  }
+
+  for (bank = 0 ; bank < dataBanks ; ++bank)
+    for (value = 0 ; value < 256 ; ++value)
+    {
+      dataBits [bank][value] = 0 ;
+      for (i = 0 ; i < 8 ; ++i)
+	if ((pinBank [i] == dataBank [bank]) && ((value & (1 << i)) != 0))
+	  dataBits [bank][value] |= pinMask [i] ;
+    }
+
+  bankMode = TRUE ;
+}
+
+
+/*
+ * syncBanks:
+ *	All our writes go through the bank shadows, so bring them up to
+ *	date with anything else that's been changing pins in those banks.
+ *********************************************************************************
+ */
+
+static void syncBanks (void)
+{
+  int pin ;
 
-static unsigned char frameBuffer [LCD_WIDTH * LCD_HEIGHT] ;
+  if (bankMode)
+    for (pin = 0 ; pin < LCD_PINS ; ++pin)
+      if ((pin != 8) && (pin != 9))
+	(void)digitalReadBank (pinBank [pin]) ;
+}
+
+
+/*
+ * setPin: writeBus:
+ *	Set one of our control pins, or the 8-bit data bus
+ *********************************************************************************
+ */
+
+static void setPin (const int pin, const int value)
+{
+  if (bankMode)
+    digitalWriteBank (pinBank [pin], value ? pinMask [pin] : 0, pinMask [pin]) ;
+  else
+    digitalWrite (pin, value) ;
+}
+
+static void writeBus (const int data)
+{
+  int i ;
+
+  if (bankMode)
+    for (i = 0 ; i < dataBanks ; ++i)
+      digitalWriteBank (dataBank [i], dataBits [i][data & 0xFF], dataMask [i]) ;
+  else
+    for (i = 0 ; i < 8 ; ++i)
+      digitalWrite (i, (data >> i) & 1) ;
+}
 
-static int maxX,    maxY ;
-static int lastX,   lastY ;
-static int xOrigin, yOrigin ;
-static int lcdOrientation = 0 ;
 
 /*
  * strobe:
@@ -70,8 +182,8 @@ static int lcdOrientation = 0 ;
 
 static void strobe (void)
 {
-  digitalWrite (STROBE, 1) ; delayMicroseconds (1) ;
-  digitalWrite (STROBE, 0) ; delayMicroseconds (5) ;
+  setPin (STROBE, 1) ; delayMicroseconds (1) ;
+  setPin (STROBE, 0) ; delayMicroseconds (5) ;
 }
 
 
@@ -83,10 +195,10 @@ static void strobe (void)
 
 static void sendData (const int data, const int chip)
 {
-  digitalWrite     (chip, 0) ;
-  digitalWriteByte (data) ;
-  strobe           () ;
-  digitalWrite     (chip, 1) ;
+  setPin   (chip, 0) ;
+  writeBus (data) ;
+  strobe   () ;
+  setPin   (chip, 1) ;
 }
 
 
@@ -98,9 +210,9 @@ static void sendData (const int data, const int chip)
 
 static void sendCommand (const int command, const int chip)
 {
-  digitalWrite (RS, 0) ;
-  sendData     (command, chip) ;
-  digitalWrite (RS, 1) ;
+  setPin   (RS, 0) ;
+  sendData (command, chip) ;
+  setPin   (RS, 1) ;
 }
 
 
@@ -118,54 +230,51 @@ static void setLine (int line, const int chip)
 
 
 /*
- * lcd128x64update:
- *	Copy our software version to the real display
+ * sendSpan:
+ *	Send columns lo to hi of a page to one of the two controllers.
+ *	Their columns run right to left across our X axis and the column
+ *	address moves on by itself after each byte.
  *********************************************************************************
  */
 
-void lcd128x64update (void)
+static void sendSpan (const int page, const int lo, const int hi, const int chip, const int right)
 {
-  int line, x, y, fbLoc ;
-  unsigned char byte ;
+  int x ;
 
-// Left side 
+  setLine (page, chip) ;
+  setCol  (right - hi, chip) ;
 
-  for (line = 0 ; line < 8 ; ++line)
-  {
-    setCol  (0,    CS1) ;
-    setLine (line, CS1) ;
+  for (x = hi ; x >= lo ; --x)
+    sendData (screen.buffer [page * LCD_WIDTH + x], chip) ;
+}
 
-    for (x = 63 ; x >= 0 ; --x)
-    {
-      byte = 0 ;
-      for (y = 0 ; y < 8 ; ++y)
-      {
-	fbLoc = x + (((7 - line) * 8) + (7 - y)) * LCD_WIDTH ;
-	if (frameBuffer [fbLoc] != 0)
-	  byte |= (1 << y) ;
-      }
-      sendData (byte, CS1) ;
-    }
-  }
 
-// Right side 
+/*
+ * lcd128x64update:
+ *	Copy our software version to the real display - only the columns
+ *	that have changed since last time.
+ *********************************************************************************
+ */
+
+void lcd128x64update (void)
+{
+  int page, lo, hi ;
 
-  for (line = 0 ; line < 8 ; ++line)
+  syncBanks () ;
+
+  for (page = 0 ; page < LCD_PAGES ; ++page)
   {
-    setCol  (0,    CS2) ;
-    setLine (line, CS2) ;
+    lo = screen.dirtyLo [page] ;
+    hi = screen.dirtyHi [page] ;
+    if (lo > hi)
+      continue ;
 
-    for (x = 127 ; x >= 64 ; --x)
-    {
-      byte = 0 ;
-      for (y = 0 ; y < 8 ; ++y)
-      {
-	fbLoc = x + (((7 - line) * 8) + (7 - y)) * LCD_WIDTH ;
-	if (frameBuffer [fbLoc] != 0)
-	  byte |= (1 << y) ;
-      }
-      sendData (byte, CS2) ;
-    }
+    if (lo < 64)
+      sendSpan (page, lo, (hi < 64) ? hi : 63, CS1, 63) ;
+    if (hi >= 64)
+      sendSpan (page, (lo >= 64) ? lo : 64, hi, CS2, 127) ;
+
+    canvasClean (&screen, page) ;
   }
 }
 
@@ -178,8 +287,7 @@ void lcd128x64update (void)
 
 void lcd128x64setOrigin (int x, int y)
 {
-  xOrigin = x ;
-  yOrigin = y ;
+  canvasSetOrigin (&screen, x, y) ;
 }
 
 
@@ -195,32 +303,7 @@ void lcd128x64setOrigin (int x, int y)
 
 void lcd128x64setOrientation (int orientation)
 {
-  lcdOrientation = orientation & 3 ;
-
-  lcd128x64setOrigin (0,0) ;
-
-  switch (lcdOrientation)
-  {
-    case 0:
-      maxX = LCD_WIDTH ;
-      maxY = LCD_HEIGHT ;
-      break ;
-
-    case 1:
-      maxX = LCD_HEIGHT ;
-      maxY = LCD_WIDTH ;
-      break ;
-
-    case 2:
-      maxX = LCD_WIDTH ;
-      maxY = LCD_HEIGHT ;
-      break ;
-
-    case 3:
-      maxX = LCD_HEIGHT ;
-      maxY = LCD_WIDTH ;
-      break ;
-  }
+  canvasSetOrientation (&screen, orientation) ;
 }
 
 
@@ -232,35 +315,8 @@ void lcd128x64setOrientation (int orientation)
 
 void lcd128x64orientCoordinates (int *x, int *y)
 {
-  register int tmp ;
-
-  *x += xOrigin ;
-  *y += yOrigin ;
-  *y  = maxY - *y - 1 ;
-
-  switch (lcdOrientation)
-  {
-    case 0:
-      break;
-
-    case 1:
-      tmp = maxY - *y - 1 ;
-      *y = *x ;
-      *x = tmp ;
-      break;
-
-    case 2:
-      *x = maxX - *x - 1 ;
-      *y = maxY - *y - 1 ;
-      break;
-
-    case 3:
-      *x = maxX - *x - 1 ;
-      tmp = *y ;
-      *y = *x ;
-      *x = tmp ;
-      break ;
-  }
+  canvasOrient (&screen, x, y) ;
+  *y = LCD_HEIGHT - *y - 1 ;
 }
 
 
@@ -273,367 +329,43 @@ void lcd128x64orientCoordinates (int *x, int *y)
 
 void lcd128x64getScreenSize (int *x, int *y)
 {
-  *x = maxX ;
-  *y = maxY ;
+  canvasGetSize (&screen, x, y) ;
 }
 
 
 /*
  *********************************************************************************
  * Standard Graphical Functions
- *********************************************************************************
- */
-
-
-/*
- * lcd128x64point:
- *	Plot a pixel.
+ *	These are all done by the canvas
  *********************************************************************************
  */
 
 void lcd128x64point (int x, int y, int colour)
-{
-  lastX = x ;
-  lastY = y ;
-
-  lcd128x64orientCoordinates (&x, &y) ;
-
-  if ((x < 0) || (x >= LCD_WIDTH) || (y < 0) || (y >= LCD_HEIGHT))
-    return ;
-
-  frameBuffer [x + y * LCD_WIDTH] = colour ;
-}
-
-
-/*
- * lcd128x64line: lcd128x64lineTo:
- *	Classic Bressenham Line code
- *********************************************************************************
- */
+  { canvasPoint (&screen, x, y, colour) ; }
 
 void lcd128x64line (int x0, int y0, int x1, int y1, int colour)
-{
-  int dx, dy ;
-  int sx, sy ;
-  int err, e2 ;
-
-  lastX = x1 ;
-  lastY = y1 ;
-
-  dx = abs (x1 - x0) ;
-  dy = abs (y1 - y0) ;
-
-  sx = (x0 < x1) ? 1 : -1 ;
-  sy = (y0 < y1) ? 1 : -1 ;
-
-  err = dx - dy ;
- 
-  for (;;)
-  {
-    lcd128x64point (x0, y0, colour) ;
-
-    if ((x0 == x1) && (y0 == y1))
-      break ;
-
-    e2 = 2 * err ;
-
-    if (e2 > -dy)
-    {
-      err -= dy ;
-      x0  += sx ;
-    }
-
-    if (e2 < dx)
-    {
-      err += dx ;
-      y0  += sy ;
-    }
-  }
-
-}
+  { canvasLine (&screen, x0, y0, x1, y1, colour) ; }
 
 void lcd128x64lineTo (int x, int y, int colour)
-{
-  lcd128x64line (lastX, lastY, x, y, colour) ;
-}
-
-
-/*
- * lcd128x64rectangle:
- *	A rectangle is a spoilt days fishing
- *********************************************************************************
- */
+  { canvasLineTo (&screen, x, y, colour) ; }
 
 void lcd128x64rectangle (int x1, int y1, int x2, int y2, int colour, int filled)
-{
-  register int x ;
-
-  if (filled)
-  {
-    /**/ if (x1 == x2)
-      lcd128x64line (x1, y1, x2, y2, colour) ;
-    else if (x1 < x2)
-      for (x = x1 ; x <= x2 ; ++x)
-	lcd128x64line (x, y1, x, y2, colour) ;
-    else
-      for (x = x2 ; x <= x1 ; ++x)
-	lcd128x64line (x, y1, x, y2, colour) ;
-  }
-  else
-  {
-    lcd128x64line   (x1, y1, x2, y1, colour) ;
-    lcd128x64lineTo (x2, y2, colour) ;
-    lcd128x64lineTo (x1, y2, colour) ;
-    lcd128x64lineTo (x1, y1, colour) ;
-  }
-}
-
-
-/*
- * lcd128x64circle:
- *      This is the midpoint circle algorithm.
- *********************************************************************************
- */
+  { canvasRectangle (&screen, x1, y1, x2, y2, colour, filled) ; }
 
 void lcd128x64circle (int x, int y, int r, int colour, int filled)
-{
-  int ddF_x = 1 ;
-  int ddF_y = -2 * r ;
-
-  int f = 1 - r ;
-  int x1 = 0 ;
-  int y1 = r ;
-
-  if (filled)
-  {
-    lcd128x64line (x, y + r, x, y - r, colour) ;
-    lcd128x64line (x + r, y, x - r, y, colour) ;
-  }
-  else
-  {
-    lcd128x64point (x, y + r, colour) ;
-    lcd128x64point (x, y - r, colour) ;
-    lcd128x64point (x + r, y, colour) ;
-    lcd128x64point (x - r, y, colour) ;
-  }
-
-  while (x1 < y1)
-  {
-    if (f >= 0)
-    {
-      y1-- ;
-      ddF_y += 2 ;
-      f += ddF_y ;
-    }
-    x1++ ;
-    ddF_x += 2 ;
-    f += ddF_x ;
-    if (filled)
-    {
-      lcd128x64line (x + x1, y + y1, x - x1, y + y1, colour) ;
-      lcd128x64line (x + x1, y - y1, x - x1, y - y1, colour) ;
-      lcd128x64line (x + y1, y + x1, x - y1, y + x1, colour) ;
-      lcd128x64line (x + y1, y - x1, x - y1, y - x1, colour) ;
-    }
-    else
-    {
-      lcd128x64point (x + x1, y + y1, colour) ; lcd128x64point (x - x1, y + y1, colour) ;
-      lcd128x64point (x + x1, y - y1, colour) ; lcd128x64point (x - x1, y - y1, colour) ;
-      lcd128x64point (x + y1, y + x1, colour) ; lcd128x64point (x - y1, y + x1, colour) ;
-      lcd128x64point (x + y1, y - x1, colour) ; lcd128x64point (x - y1, y - x1, colour) ;
-    }
-  }
-}
-
-
-/*
- * lcd128x64ellipse:
- *	Fast ellipse drawing algorithm by 
- *      John Kennedy
- *	Mathematics Department
- *	Santa Monica College
- *	1900 Pico Blvd.
- *	Santa Monica, CA 90405
- *	jrkennedy6@gmail.com
- *	-Confirned in email this algorithm is in the public domain -GH-
- *********************************************************************************
- */
-
-static void plot4ellipsePoints (int cx, int cy, int x, int y, int colour, int filled)
-{
-  if (filled)
-  {
-    lcd128x64line (cx + x, cy + y, cx - x, cy + y, colour) ;
-    lcd128x64line (cx - x, cy - y, cx + x, cy - y, colour) ;
-  }
-  else
-  {
-    lcd128x64point (cx + x, cy + y, colour) ;
-    lcd128x64point (cx - x, cy + y, colour) ;
-    lcd128x64point (cx - x, cy - y, colour) ;
-    lcd128x64point (cx + x, cy - y, colour) ;
-  }
-}
+  { canvasCircle (&screen, x, y, r, colour, filled) ; }
 
 void lcd128x64ellipse (int cx, int cy, int xRadius, int yRadius, int colour, int filled)
-{
-  int x, y ;
-  int xChange, yChange, ellipseError ;
-  int twoAsquare, twoBsquare ;
-  int stoppingX, stoppingY ;
-
-  twoAsquare = 2 * xRadius * xRadius ;
-  twoBsquare = 2 * yRadius * yRadius ;
-
-  x = xRadius ;
-  y = 0 ;
-
-  xChange = yRadius * yRadius * (1 - 2 * xRadius) ;
-  yChange = xRadius * xRadius ;
-
-  ellipseError = 0 ;
-  stoppingX    = twoBsquare * xRadius ;
-  stoppingY    = 0 ;
-
-  while (stoppingX >= stoppingY)	// 1st set of points
-  {
-    plot4ellipsePoints (cx, cy, x, y, colour, filled) ;
-    ++y ;
-    stoppingY    += twoAsquare ;
-    ellipseError += yChange ;
-    yChange      += twoAsquare ;
-
-    if ((2 * ellipseError + xChange) > 0 )
-    {
-      --x ;
-      stoppingX    -= twoBsquare ;
-      ellipseError += xChange ;
-      xChange      += twoBsquare ;
-    }
-  }
-
-  x = 0 ;
-  y = yRadius ;
-
-  xChange = yRadius * yRadius ;
-  yChange = xRadius * xRadius * (1 - 2 * yRadius) ;
-
-  ellipseError = 0 ;
-  stoppingX    = 0 ;
-  stoppingY    = twoAsquare * yRadius ;
-
-  while (stoppingX <= stoppingY)	//2nd set of points
-  {
-    plot4ellipsePoints (cx, cy, x, y, colour, filled) ;
-    ++x ;
-    stoppingX    += twoBsquare ;
-    ellipseError += xChange ;
-    xChange      += twoBsquare ;
-
-    if ((2 * ellipseError + yChange) > 0 )
-    {
-      --y ;
-      stoppingY -= twoAsquare ;
-      ellipseError += yChange ;
-      yChange += twoAsquare ;
-    }
-  }
-}
-
-
-/*
- * lcd128x64putchar:
- *	Print a single character to the screen
- *********************************************************************************
- */
+  { canvasEllipse (&screen, cx, cy, xRadius, yRadius, colour, filled) ; }
 
 void lcd128x64putchar (int x, int y, int c, int bgCol, int fgCol)
-{
-  int y1, y2 ;
-
-  unsigned char line ;
-  unsigned char *fontPtr ;
-
-// Can't print if we're offscreen
-
-//if ((x < 0) || (x >= (maxX - fontWidth)) || (y < 0) || (y >= (maxY - fontHeight)))
-//  return ;
-
-  fontPtr = font + c * fontHeight ;
-
-  for (y1 = fontHeight - 1 ; y1 >= 0 ; --y1)
-  {
-    y2 = y + y1 ;
-    line = *fontPtr++ ;
-    lcd128x64point (x + 0, y2, (line & 0x80) == 0 ? bgCol : fgCol) ;
-    lcd128x64point (x + 1, y2, (line & 0x40) == 0 ? bgCol : fgCol) ;
-    lcd128x64point (x + 2, y2, (line & 0x20) == 0 ? bgCol : fgCol) ;
-    lcd128x64point (x + 3, y2, (line & 0x10) == 0 ? bgCol : fgCol) ;
-    lcd128x64point (x + 4, y2, (line & 0x08) == 0 ? bgCol : fgCol) ;
-    lcd128x64point (x + 5, y2, (line & 0x04) == 0 ? bgCol : fgCol) ;
-    lcd128x64point (x + 6, y2, (line & 0x02) == 0 ? bgCol : fgCol) ;
-    lcd128x64point (x + 7, y2, (line & 0x01) == 0 ? bgCol : fgCol) ;
-  }
-}
-
-
-/*
- * lcd128x64puts:
- *	Send a string to the display. Obeys \n and \r formatting
- *********************************************************************************
- */
+  { canvasPutchar (&screen, x, y, c, bgCol, fgCol) ; }
 
 void lcd128x64puts (int x, int y, const char *str, int bgCol, int fgCol)
-{
-  int c, mx, my ;
-
-  mx = x ; my = y ;
-
-  while (*str)
-  {
-    c = *str++ ;
-
-    if (c == '\r')
-    {
-      mx = x ;
-      continue ;
-    }
-
-    if (c == '\n')
-    {
-      mx  = x ;
-      my -= fontHeight ;
-      continue ;
-    }
-
-    lcd128x64putchar (mx, my, c, bgCol, fgCol) ;
-
-    mx += fontWidth ;
-    if (mx >= (maxX - fontWidth))
-    {
-      mx  = 0 ;
-      my -= fontHeight ;
-    }
-  }
-}
-
-
-/*
- * lcd128x64clear:
- *	Clear the display to the given colour.
- *********************************************************************************
- */
+  { canvasPuts (&screen, x, y, str, bgCol, fgCol) ; }
 
 void lcd128x64clear (int colour)
-{
-  register int i ;
-  register unsigned char *ptr = frameBuffer ;
-
-  for (i = 0 ; i < (maxX * maxY) ; ++i)
-    *ptr++ = colour ;
-}
-
-
+  { canvasClear (&screen, colour) ; }
 
 
 /*
@@ -646,6 +378,11 @@ int lcd128x64setup (void)
 {
   int i ;
 
+  if ((screen.buffer == NULL) && (canvasInit (&screen, LCD_WIDTH, LCD_HEIGHT) != 0))
+    return -1 ;
+
+  setupBanks () ;
+
   for (i = 0 ; i < 8 ; ++i)
     pinMode (i, OUTPUT) ;
 
@@ -659,6 +396,8 @@ int lcd128x64setup (void)
   pinMode (STROBE, OUTPUT) ;
   pinMode (RS,     OUTPUT) ;
 
+  syncBanks () ;
+
   sendCommand (0x3F, CS1) ;	// Display ON
   sendCommand (0xC0, CS1) ;	// Set display start line to 0
 
@@ -26,6 +26,8 @@
 //#include <stdlib.h>
 //#include <unistd.h>
 
+#include <pthread.h>
+
 #include <wiringPi.h>
 
 #include "maxdetect.h"
@@ -35,6 +37,23 @@
 #  define	FALSE	(1==2)
 #endif
 
+// Last reading for each sensor, so we can rate limit them separately
+
+#define	RHT03_MAX	8
+
+struct rht03State
+{
+  int          pin ;
+  unsigned int nextTime ;
+  int          lastTemp ;
+  int          lastRh ;
+  int          lastResult ;
+} ;
+
+static struct rht03State rht03 [RHT03_MAX] ;
+static int               rht03Count = 0 ;
+static pthread_mutex_t   rht03Lock  = PTHREAD_MUTEX_INITIALIZER ;
+
 
 /*
  * maxDetectLowHighWait:
@@ -127,39 +146,56 @@ int maxDetectRead (const int pin, unsigned char buffer [4])
 
 /*
  * readRHT03:
- *	Read the Temperature & Humidity from an RHT03 sensor
+ *	Read the Temperature & Humidity from an RHT03 sensor.
+ *	The sensor can't be read more than once every 2 seconds, so in
+ *	between we hand back the last reading. Safe to call from several
+ *	threads - the lock also stops two of them driving the bus at once.
  *********************************************************************************
  */
 
 int readRHT03 (const int pin, int *temp, int *rh)
 {
-  static unsigned int nextTime   = 0 ;
-  static          int lastTemp   = 0 ;
-  static          int lastRh     = 0 ;
-  static          int lastResult = TRUE ;
-
+  struct rht03State *state = NULL ;
   unsigned char buffer [4] ;
+  int i, result ;
+
+  pthread_mutex_lock (&rht03Lock) ;
 
-// Don't read more than once a second
+  for (i = 0 ; i < rht03Count ; ++i)
+    if (rht03 [i].pin == pin)
+    {
+      state = &rht03 [i] ;
+      break ;
+    }
 
-  if (millis () < nextTime)
+  if (state == NULL)
   {
-    *temp = lastTemp ;
-    *rh   = lastRh ;
-    return lastResult ;
+    if (rht03Count == RHT03_MAX)
+    {
+      pthread_mutex_unlock (&rht03Lock) ;
+      return FALSE ;
+    }
+    state             = &rht03 [rht03Count++] ;
+    state->pin        = pin ;
+    state->nextTime   = millis () ;
+    state->lastResult = FALSE ;
   }
-  
-  lastResult = maxDetectRead (pin, buffer) ;
 
-  if (lastResult)
+  if ((int)(millis () - state->nextTime) < 0)
   {
-    *temp      = lastTemp   = (buffer [2] * 256 + buffer [3]) ;
-    *rh        = lastRh     = (buffer [0] * 256 + buffer [1]) ;
-    nextTime   = millis () + 2000 ;
-    return TRUE ;
+    *temp  = state->lastTemp ;
+    *rh    = state->lastRh ;
+    result = state->lastResult ;
   }
-  else
+  else if ((result = maxDetectRead (pin, buffer)))
   {
-    return FALSE ;
+    *temp = state->lastTemp = (buffer [2] * 256 + buffer [3]) ;
+    *rh   = state->lastRh   = (buffer [0] * 256 + buffer [1]) ;
+    state->lastResult = TRUE ;
+    state->nextTime   = millis () + 2000 ;
   }
+
+  pthread_mutex_unlock (&rht03Lock) ;
+
+  return result ;
 }
@@ -63,6 +63,26 @@ int myDigitalRead (struct wiringPiNodeStruct *node, int pin)
 }
 
 
+/*
+ * myDigitalReadPort: myDigitalWritePort:
+ *	All 16 pins in one mcp23s17 transaction. The inputs are on port B and
+ *	the output latch on port A, so the two bytes swap over on a read.
+ *********************************************************************************
+ */
+
+unsigned int myDigitalReadPort (struct wiringPiNodeStruct *node)
+{
+  unsigned int value = digitalReadPort (node->pinBase + 16) ;
+
+  return ((value >> 8) & 0xFF) | ((value & 0xFF) << 8) ;
+}
+
+void myDigitalWritePort (struct wiringPiNodeStruct *node, unsigned int value, unsigned int mask)
+{
+  digitalWritePort (node->pinBase + 16, value, mask) ;
+}
+
+
 /*
  * myPullUpDnControl:
  *	Perform the pullUpDnControl function on the PiFace board
@@ -104,9 +124,13 @@ int piFaceSetup (const int pinBase)
   }
 
   node = wiringPiNewNode (pinBase, 16) ;
-  node->digitalRead     = myDigitalRead ;
-  node->digitalWrite    = myDigitalWrite ;
-  node->pullUpDnControl = myPullUpDnControl ;
+  node->digitalRead       = myDigitalRead ;
+  node->digitalWrite      = myDigitalWrite ;
+  node->pullUpDnControl   = myPullUpDnControl ;
+  node->digitalReadPort   = myDigitalReadPort ;
+  node->digitalWritePort  = myDigitalWritePort ;
+  node->digitalReadMulti  = wiringPiNodeReadMultiPort ;
+  node->digitalWriteMulti = wiringPiNodeWriteMultiPort ;
 
   return 0 ;
 }
@@ -22,6 +22,9 @@
  ***********************************************************************
  */
 
+#include <time.h>
+#include <errno.h>
+
 #include <wiringPi.h>
 #include <sn3218.h>
 
@@ -67,6 +70,7 @@ void piGlowLeg (const int leg, const int intensity)
 {
   int  i ;
   int *legLeds ;
+  int  pins [6], values [6] ;
 
   if ((leg < 0) || (leg > 2))
     return ;
@@ -79,7 +83,12 @@ void piGlowLeg (const int leg, const int intensity)
     legLeds = leg2 ;
 
   for (i = 0 ; i < 6 ; ++i)
-    analogWrite (PIGLOW_BASE + legLeds [i], intensity) ;
+  {
+    pins   [i] = PIGLOW_BASE + legLeds [i] ;
+    values [i] = intensity ;
+  }
+
+  analogWriteMulti (pins, values, 6) ;	// One burst for the 6
 }
 
 
@@ -91,12 +100,75 @@ void piGlowLeg (const int leg, const int intensity)
 
 void piGlowRing (const int ring, const int intensity)
 {
+  int pins   [3] ;
+  int values [3] = { intensity, intensity, intensity } ;
+
   if ((ring < 0) || (ring > 5))
     return ;
 
-  analogWrite (PIGLOW_BASE + leg0 [ring], intensity) ;
-  analogWrite (PIGLOW_BASE + leg1 [ring], intensity) ;
-  analogWrite (PIGLOW_BASE + leg2 [ring], intensity) ;
+  pins [0] = PIGLOW_BASE + leg0 [ring] ;
+  pins [1] = PIGLOW_BASE + leg1 [ring] ;
+  pins [2] = PIGLOW_BASE + leg2 [ring] ;
+
+  analogWriteMulti (pins, values, 3) ;
+}
+
+
+/*
+ * piGlowAnimate:
+ *	Run an animation at fps frames a second. frame () is called with
+ *	the frame number to draw it with the other piGlow functions; the
+ *	drawing only goes to the driver's frame buffer, and the whole frame
+ *	is sent to the board in one burst at the next frame time, so each
+ *	frame appears at once. Stops when frame () returns 0, and returns
+ *	the number of frame times we missed because drawing ran late.
+ *********************************************************************************
+ */
+
+int piGlowAnimate (int fps, int (*frame)(int frameNo, void *userData), void *userData)
+{
+  struct timespec next, now ;
+  long long period, ns, behind ;
+  int frameNo, more, late = 0 ;
+
+  if (fps < 1)
+    return 0 ;
+
+  period = 1000000000LL / fps ;
+  clock_gettime (CLOCK_MONOTONIC, &next) ;
+
+  for (frameNo = 0 ;; ++frameNo)
+  {
+    wiringPiBegin (PIGLOW_BASE) ;
+      more = frame (frameNo, userData) ;
+
+// Wait for the frame time, then show it
+
+      ns            = next.tv_nsec + period ;
+      next.tv_sec  += ns / 1000000000LL ;
+      next.tv_nsec  = ns % 1000000000LL ;
+      while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+	;
+    wiringPiCommit (PIGLOW_BASE) ;
+
+    if (!more)
+      break ;
+
+// Drop frame times rather than rushing to catch up
+
+    clock_gettime (CLOCK_MONOTONIC, &now) ;
+    ns = (now.tv_sec - next.tv_sec) * 1000000000LL + (now.tv_nsec - next.tv_nsec) ;
+    if (ns > period)
+    {
+      behind        = ns / period ;
+      late         += behind ;
+      ns            = next.tv_nsec + behind * period ;
+      next.tv_sec  += ns / 1000000000LL ;
+      next.tv_nsec  = ns % 1000000000LL ;
+    }
+  }
+
+  return late ;
 }
 
 /*
@@ -111,8 +183,10 @@ void piGlowSetup (int clear)
 
   if (clear)
   {
-    piGlowLeg (0, 0) ;
-    piGlowLeg (1, 0) ;
-    piGlowLeg (2, 0) ;
+    wiringPiBegin (PIGLOW_BASE) ;
+      piGlowLeg (0, 0) ;
+      piGlowLeg (1, 0) ;
+      piGlowLeg (2, 0) ;
+    wiringPiCommit (PIGLOW_BASE) ;
   }
 }
@@ -22,7 +22,10 @@
  ***********************************************************************
  */
 
+#include <stdint.h>
+
 #include <wiringPi.h>
+#include <wiringShift.h>
 
 #include "piNes.h"
 
@@ -39,6 +42,7 @@
 
 
 #define	PULSE_TIME	25
+#define	NES_CLOCK	(1000000 / (2 * PULSE_TIME))
 
 // Data to store the pins for each controller
 
@@ -87,7 +91,7 @@ int setupNesJoystick (int dPin, int cPin, int lPin)
 unsigned int readNesJoystick (int joystick)
 {
   unsigned int value = 0 ;
-  int  i ;
+  uint8_t byte ;
 
   struct nesPinsStruct *pins = &nesPins [joystick] ;
  
@@ -96,18 +100,10 @@ unsigned int readNesJoystick (int joystick)
   digitalWrite (pins->lPin, HIGH) ; delayMicroseconds (PULSE_TIME) ;
   digitalWrite (pins->lPin, LOW)  ; delayMicroseconds (PULSE_TIME) ;
 
-// Read first bit
-
-  value = digitalRead (pins->dPin) ;
-
-// Now get the next 7 bits with the clock
+// The first bit is presented by the latch, the rest are clocked out
 
-  for (i = 0 ; i < 7 ; ++i)
-  {
-    digitalWrite (pins->cPin, HIGH) ; delayMicroseconds (PULSE_TIME) ;
-    digitalWrite (pins->cPin, LOW)  ; delayMicroseconds (PULSE_TIME) ;
-    value = (value << 1) | digitalRead (pins->dPin) ;
-  }
+  shiftInBuf (pins->dPin, pins->cPin, MSBFIRST, &byte, 1, NES_CLOCK) ;
+  value = byte ;
 
   return value ^ 0xFF ;
 }
@@ -0,0 +1,450 @@
+/*
+ * ssd1306.c:
+ *	Driver for 128x64 SSD1306 and SH1106 OLED displays on I2C or SPI.
+ *	We keep the framebuffer in a canvas, which is already in the
+ *	controller's page layout, and send just the changed part of it in
+ *	one block write.
+ *
+ *	At 400KHz I2C a full screen is a little over 1KB, or about 23mS,
+ *	so 30+ frames/sec is possible - if only part of the screen changes
+ *	it's a lot quicker. SPI is quicker still.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wiringPi.h>
+#include <wiringPiI2C.h>
+#include <wiringPiSPI.h>
+
+#include "canvas.h"
+#include "ssd1306.h"
+
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
+// Size
+
+#define	OLED_WIDTH	128
+#define	OLED_HEIGHT	 64
+#define	OLED_PAGES	(OLED_HEIGHT / 8)
+
+// The SH1106 has 132 columns of RAM with the display in the middle
+
+#define	SH1106_OFFSET	2
+
+// I2C control bytes: what follows is all commands, or all data
+
+#define	OLED_I2C_CMD	0x00
+#define	OLED_I2C_DATA	0x40
+
+struct ssd1306
+{
+  int type ;
+  int i2cFd ;			// -1 when on SPI
+  int spiChannel ;
+  int dcPin ;
+
+  struct canvas canvas ;
+
+// Room for the I2C control byte then a whole screen
+
+  unsigned char buf [1 + OLED_PAGES * OLED_WIDTH] ;
+} ;
+
+static struct ssd1306 *displays [MAX_SSD1306] ;
+
+// Initialisation sequences. We scan the rows bottom to top so the
+//	canvas's device row 0 is at the bottom and its Y runs up the screen,
+//	as it does on the lcd128x64.
+
+static const unsigned char ssd1306Init [] =
+{
+  0xAE,			// Display off
+  0xD5, 0x80,		// Clock divide
+  0xA8, 0x3F,		// Multiplex: 64 rows
+  0xD3, 0x00,		// No display offset
+  0x40,			// Start line 0
+  0x8D, 0x14,		// Charge pump on
+  0x20, 0x00,		// Horizontal addressing
+  0xA1,			// Column 0 on the left of the usual modules
+  0xC0,			// Scan from row 0
+  0xDA, 0x12,		// Alternate COM pins
+  0x81, 0xCF,		// Contrast
+  0xD9, 0xF1,		// Pre-charge
+  0xDB, 0x40,		// VCOMH
+  0xA4,			// Display the RAM
+  0xA6,			// Not inverted
+} ;
+
+static const unsigned char sh1106Init [] =
+{
+  0xAE,			// Display off
+  0xD5, 0x80,		// Clock divide
+  0xA8, 0x3F,		// Multiplex: 64 rows
+  0xD3, 0x00,		// No display offset
+  0x40,			// Start line 0
+  0xAD, 0x8B,		// DC-DC on
+  0xA1,			// Column 0 on the left of the usual modules
+  0xC0,			// Scan from row 0
+  0xDA, 0x12,		// Alternate COM pins
+  0x81, 0x80,		// Contrast
+  0xD9, 0x22,		// Pre-charge
+  0xDB, 0x35,		// VCOMH
+  0xA4,			// Display the RAM
+  0xA6,			// Not inverted
+} ;
+
+
+/*
+ * sendCommands: sendData:
+ *	Send a list of commands, or len bytes of data from buf [1]. On SPI
+ *	the D/C pin says which it is, and on I2C the control byte does.
+ *********************************************************************************
+ */
+
+static void sendCommands (struct ssd1306 *d, const unsigned char *commands, int len)
+{
+  if (d->i2cFd >= 0)
+  {
+    d->buf [0] = OLED_I2C_CMD ;
+    memcpy (&d->buf [1], commands, len) ;
+    wiringPiI2CWriteRaw (d->i2cFd, d->buf, len + 1) ;
+  }
+  else
+  {
+    digitalWrite (d->dcPin, 0) ;
+    memcpy (d->buf, commands, len) ;
+    wiringPiSPIDataRW (d->spiChannel, d->buf, len) ;
+  }
+}
+
+static void sendData (struct ssd1306 *d, int len)
+{
+  if (d->i2cFd >= 0)
+  {
+    d->buf [0] = OLED_I2C_DATA ;
+    wiringPiI2CWriteRaw (d->i2cFd, d->buf, len + 1) ;
+  }
+  else
+  {
+    digitalWrite (d->dcPin, 1) ;
+    wiringPiSPIDataRW (d->spiChannel, &d->buf [1], len) ;
+  }
+}
+
+
+/*
+ * updateSSD1306: updateSH1106:
+ *	The SSD1306 can set a window of columns and pages and then take all
+ *	of it in one go, so we send the box round everything that's changed.
+ *	The SH1106 can only write within a page, so we send each page's
+ *	changes in turn.
+ *********************************************************************************
+ */
+
+static void updateSSD1306 (struct ssd1306 *d)
+{
+  struct canvas *c = &d->canvas ;
+  unsigned char window [6] ;
+  int page, first = -1, last = -1, lo = c->width, hi = -1, width, len ;
+
+  for (page = 0 ; page < c->pages ; ++page)
+  {
+    if (c->dirtyLo [page] > c->dirtyHi [page])
+      continue ;
+
+    if (first == -1)
+      first = page ;
+    last = page ;
+
+    if (c->dirtyLo [page] < lo) lo = c->dirtyLo [page] ;
+    if (c->dirtyHi [page] > hi) hi = c->dirtyHi [page] ;
+  }
+
+  if (first == -1)
+    return ;
+
+  window [0] = 0x21 ; window [1] = lo ;    window [2] = hi ;
+  window [3] = 0x22 ; window [4] = first ; window [5] = last ;
+  sendCommands (d, window, 6) ;
+
+  width = hi - lo + 1 ;
+  len   = 0 ;
+  for (page = first ; page <= last ; ++page)
+  {
+    memcpy (&d->buf [1 + len], &c->buffer [page * c->width + lo], width) ;
+    len += width ;
+    canvasClean (c, page) ;
+  }
+
+  sendData (d, len) ;
+}
+
+static void updateSH1106 (struct ssd1306 *d)
+{
+  struct canvas *c = &d->canvas ;
+  unsigned char address [3] ;
+  int page, lo, hi, col ;
+
+  for (page = 0 ; page < c->pages ; ++page)
+  {
+    lo = c->dirtyLo [page] ;
+    hi = c->dirtyHi [page] ;
+    if (lo > hi)
+      continue ;
+
+    col = lo + SH1106_OFFSET ;
+    address [0] = 0xB0 | page ;
+    address [1] = 0x00 | (col & 0x0F) ;
+    address [2] = 0x10 | (col >> 4) ;
+    sendCommands (d, address, 3) ;
+
+    memcpy (&d->buf [1], &c->buffer [page * c->width + lo], hi - lo + 1) ;
+    sendData (d, hi - lo + 1) ;
+
+    canvasClean (c, page) ;
+  }
+}
+
+
+/*
+ * ssd1306Update:
+ *	Copy the changes in the canvas to the display
+ *********************************************************************************
+ */
+
+void ssd1306Update (const int fd)
+{
+  struct ssd1306 *d = displays [fd] ;
+
+  if (d->type == SH1106)
+    updateSH1106 (d) ;
+  else
+    updateSSD1306 (d) ;
+}
+
+
+/*
+ * ssd1306Canvas:
+ *	Return the canvas to draw on with the canvas functions
+ *********************************************************************************
+ */
+
+struct canvas *ssd1306Canvas (const int fd)
+{
+  return &displays [fd]->canvas ;
+}
+
+
+/*
+ * ssd1306Contrast: ssd1306Display: ssd1306Invert:
+ *	Set the contrast (0-255), turn the display on or off, or invert it.
+ *********************************************************************************
+ */
+
+void ssd1306Contrast (const int fd, int contrast)
+{
+  unsigned char command [2] ;
+
+  command [0] = 0x81 ;
+  command [1] = contrast & 0xFF ;
+  sendCommands (displays [fd], command, 2) ;
+}
+
+void ssd1306Display (const int fd, int state)
+{
+  unsigned char command = state ? 0xAF : 0xAE ;
+
+  sendCommands (displays [fd], &command, 1) ;
+}
+
+void ssd1306Invert (const int fd, int state)
+{
+  unsigned char command = state ? 0xA7 : 0xA6 ;
+
+  sendCommands (displays [fd], &command, 1) ;
+}
+
+
+/*
+ * clearEdges:
+ *	The SH1106's RAM is wider than the screen and the canvas doesn't
+ *	cover the columns either side of it, so clear them once.
+ *********************************************************************************
+ */
+
+static void clearEdges (struct ssd1306 *d)
+{
+  unsigned char address [3] ;
+  int page, side, col ;
+
+  for (page = 0 ; page < OLED_PAGES ; ++page)
+    for (side = 0 ; side < 2 ; ++side)
+    {
+      col = side ? (OLED_WIDTH + SH1106_OFFSET) : 0 ;
+      address [0] = 0xB0 | page ;
+      address [1] = 0x00 | (col & 0x0F) ;
+      address [2] = 0x10 | (col >> 4) ;
+      sendCommands (d, address, 3) ;
+
+      memset   (&d->buf [1], 0, SH1106_OFFSET) ;
+      sendData (d, SH1106_OFFSET) ;
+    }
+}
+
+
+/*
+ * newDisplay: initDisplay:
+ *	Find a free handle and allocate a display, then once we know how to
+ *	talk to it, initialise it and clear the screen.
+ *********************************************************************************
+ */
+
+static int newDisplay (const int type)
+{
+  struct ssd1306 *d ;
+  int fd ;
+
+  if ((type != SSD1306) && (type != SH1106))
+    return -1 ;
+
+  for (fd = 0 ; fd < MAX_SSD1306 ; ++fd)
+    if (displays [fd] == NULL)
+      break ;
+
+  if (fd == MAX_SSD1306)
+    return -1 ;
+
+  if ((d = (struct ssd1306 *)calloc (1, sizeof (struct ssd1306))) == NULL)
+    return -1 ;
+
+  if (canvasInit (&d->canvas, OLED_WIDTH, OLED_HEIGHT) != 0)
+  {
+    free (d) ;
+    return -1 ;
+  }
+
+  d->type       = type ;
+  d->i2cFd      = -1 ;
+  d->spiChannel = -1 ;
+  d->dcPin      = -1 ;
+
+  displays [fd] = d ;
+
+  return fd ;
+}
+
+static void freeDisplay (const int fd)
+{
+  canvasFree (&displays [fd]->canvas) ;
+  free (displays [fd]) ;
+  displays [fd] = NULL ;
+}
+
+static void initDisplay (const int fd)
+{
+  struct ssd1306 *d = displays [fd] ;
+
+  if (d->type == SH1106)
+    sendCommands (d, sh1106Init,  sizeof (sh1106Init)) ;
+  else
+    sendCommands (d, ssd1306Init, sizeof (ssd1306Init)) ;
+
+  if (d->type == SH1106)
+    clearEdges (d) ;
+
+  canvasClear    (&d->canvas, 0) ;
+  ssd1306Update  (fd) ;
+  ssd1306Display (fd, TRUE) ;
+}
+
+
+/*
+ * ssd1306SetupI2C:
+ *	Set up a display on the I2C bus - usually at 0x3C or 0x3D. Returns a
+ *	handle or -1 if any error.
+ *********************************************************************************
+ */
+
+int ssd1306SetupI2C (const int type, const int i2cAddress)
+{
+  int fd, i2cFd ;
+
+  if ((fd = newDisplay (type)) == -1)
+    return -1 ;
+
+  if ((i2cFd = wiringPiI2CSetupShared (i2cAddress)) < 0)
+  {
+    freeDisplay (fd) ;
+    return -1 ;
+  }
+
+  displays [fd]->i2cFd = i2cFd ;
+
+  initDisplay (fd) ;
+
+  return fd ;
+}
+
+
+/*
+ * ssd1306SetupSPI:
+ *	Set up a display on the SPI bus. dcPin is the data/command pin, and
+ *	resetPin the display's reset, or -1 if it's not connected. Returns a
+ *	handle or -1 if any error.
+ *********************************************************************************
+ */
+
+int ssd1306SetupSPI (const int type, const int channel, const int speed,
+	const int dcPin, const int resetPin)
+{
+  int fd ;
+
+  if ((fd = newDisplay (type)) == -1)
+    return -1 ;
+
+  if (wiringPiSPISetup (channel, speed) < 0)
+  {
+    freeDisplay (fd) ;
+    return -1 ;
+  }
+
+  displays [fd]->spiChannel = channel ;
+  displays [fd]->dcPin      = dcPin ;
+
+  digitalWrite (dcPin, 0) ;
+  pinMode      (dcPin, OUTPUT) ;
+
+  if (resetPin != -1)
+  {
+    digitalWrite (resetPin, 1) ; pinMode (resetPin, OUTPUT) ;
+    delay (1) ;
+    digitalWrite (resetPin, 0) ; delay (10) ;
+    digitalWrite (resetPin, 1) ; delay (10) ;
+  }
+
+  initDisplay (fd) ;
+
+  return fd ;
+}
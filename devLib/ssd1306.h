@@ -0,0 +1,46 @@
+/*
+ * ssd1306.h:
+ *	Driver for 128x64 SSD1306 and SH1106 OLED displays on I2C or SPI
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#define	MAX_SSD1306	4
+
+// Controller types
+
+#define	SSD1306		0
+#define	SH1106		1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int            ssd1306SetupI2C (const int type, const int i2cAddress) ;
+extern int            ssd1306SetupSPI (const int type, const int channel, const int speed,
+					const int dcPin, const int resetPin) ;
+
+extern struct canvas *ssd1306Canvas   (const int fd) ;
+extern void           ssd1306Update   (const int fd) ;
+extern void           ssd1306Contrast (const int fd, int contrast) ;
+extern void           ssd1306Display  (const int fd, int state) ;
+extern void           ssd1306Invert   (const int fd, int state) ;
+
+#ifdef __cplusplus
+}
+#endif
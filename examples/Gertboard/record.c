@@ -10,14 +10,19 @@
 #include <sys/time.h>
 
 #include <wiringPi.h>
+#include <analogStream.h>
 #include <gertboard.h>
 
 #define	B_SIZE	40000
+#define	RATE	20000
 
 int main ()
 {
-  int i ;
+  int i, n, got, stream ;
+  int pin = 100 ;
   struct timeval tStart, tEnd, tTaken ;
+  struct analogScan scans [256] ;
+  struct analogStreamStats stats ;
   unsigned char buffer [B_SIZE] ;
 
   printf ("\n") ;
@@ -33,27 +38,72 @@ int main ()
 
   gertboardAnalogSetup (100) ;
 
+// Sample at a fixed rate from a background thread and drain the buffer
+
   gettimeofday (&tStart, NULL) ;
 
-  for (i = 0 ; i < B_SIZE ; ++i)
-    buffer [i] = analogRead (100) >> 2 ;
+  if ((stream = analogStreamStart (&pin, 1, RATE, 4096)) < 0)
+  {
+    fprintf (stderr, "Unable to start the analog stream\n") ;
+    return 1 ;
+  }
+
+  for (got = 0 ; got < B_SIZE ; )
+  {
+    if ((n = analogStreamRead (stream, scans, 256)) == 0)
+    {
+      delay (1) ;
+      continue ;
+    }
+    for (i = 0 ; (i < n) && (got < B_SIZE) ; ++i)
+      buffer [got++] = scans [i].values [0] >> 2 ;
+  }
+
+  analogStreamStats (stream, &stats) ;
+  analogStreamStop  (stream) ;
 
   gettimeofday (&tEnd, NULL) ;
   
   timersub (&tEnd, &tStart, &tTaken) ;
 
   printf ("Time taken for %d  reads: %ld.%ld\n", B_SIZE, tTaken.tv_sec, tTaken.tv_usec) ;
+  printf ("  %.1f samples/sec, %lu overruns, %lu late\n", stats.rate, stats.overruns, stats.late) ;
+
+// Play it back at the same rate, keeping the stream's buffer topped up
 
   gettimeofday (&tStart, NULL) ;
 
-  for (i = 0 ; i < B_SIZE ; ++i)
-   analogWrite (100, buffer [i]) ;
+  if ((stream = analogStreamStartOut (&pin, 1, RATE, 4096)) < 0)
+  {
+    fprintf (stderr, "Unable to start the analog output stream\n") ;
+    return 1 ;
+  }
+
+  for (got = 0 ; got < B_SIZE ; )
+  {
+    for (n = 0 ; (n < 256) && (got + n < B_SIZE) ; ++n)
+      scans [n].values [0] = buffer [got + n] ;
+
+    if ((i = analogStreamWrite (stream, scans, n)) == 0)
+      delay (1) ;
+    got += i ;
+  }
+
+  do
+  {
+    delay (1) ;
+    analogStreamStats (stream, &stats) ;
+  } while (stats.scans < B_SIZE) ;
+
+  analogStreamStop (stream) ;
 
   gettimeofday (&tEnd, NULL) ;
   
   timersub (&tEnd, &tStart, &tTaken) ;
 
   printf ("Time taken for %d writes: %ld.%ld\n", B_SIZE, tTaken.tv_sec, tTaken.tv_usec) ;
+  printf ("  %.1f samples/sec, %lu underruns, timing error %.1f uS mean, %.1f uS max\n",
+	stats.rate, stats.underruns, stats.meanError, stats.maxError) ;
 
   return 0 ;
 }
@@ -0,0 +1,144 @@
+/*
+ * asyncSpeed.c:
+ *	Compare sustained transfers per second of the blocking SPI/I2C
+ *	calls with the asynchronous executor.
+ *
+ *	asyncSpeed i2c <address> <register>
+ *	asyncSpeed spi <channel>
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wiringPi.h>
+#include <wiringPiSPI.h>
+#include <wiringPiI2C.h>
+#include <wiringPiAsync.h>
+
+#define	COUNT	10000
+#define	DEPTH	   64
+#define	SPI_LEN	    4
+
+static struct wiringPiAsyncOp ops [DEPTH] ;
+static unsigned char          spiBuf [DEPTH][SPI_LEN] ;
+
+static void report (const char *what, unsigned int start, unsigned int end)
+{
+  unsigned int uS = end - start ;
+
+  if (uS == 0)
+    uS = 1 ;
+
+  printf ("%-10s %8d transfers in %8u uS: %8.0f/sec\n", what, COUNT, uS,
+	(double)COUNT * 1000000.0 / (double)uS) ;
+}
+
+int main (int argc, char *argv [])
+{
+  int spi, fd = -1, reg = 0, i, bus ;
+  unsigned int start, end, submitTime ;
+  unsigned char buf [SPI_LEN] ;
+
+  if (argc < 3)
+  {
+    fprintf (stderr, "Usage: %s i2c <address> <register> | spi <channel>\n", argv [0]) ;
+    return 1 ;
+  }
+
+  wiringPiSetupSys () ;
+
+  spi = (strcmp (argv [1], "spi") == 0) ;
+
+  if (spi)
+  {
+    fd = atoi (argv [2]) ;
+    if (wiringPiSPISetup (fd, 1000000) < 0)
+      return 1 ;
+  }
+  else
+  {
+    if (argc < 4)
+    {
+      fprintf (stderr, "Usage: %s i2c <address> <register>\n", argv [0]) ;
+      return 1 ;
+    }
+    if ((fd = wiringPiI2CSetup ((int)strtol (argv [2], NULL, 0))) < 0)
+      return 1 ;
+    reg = (int)strtol (argv [3], NULL, 0) ;
+  }
+
+// Blocking
+
+  start = micros () ;
+  for (i = 0 ; i < COUNT ; ++i)
+    if (spi)
+    {
+      memset (buf, 0, SPI_LEN) ;
+      wiringPiSPIDataRW (fd, buf, SPI_LEN) ;
+    }
+    else
+      wiringPiI2CReadReg8 (fd, reg) ;
+  end = micros () ;
+  report ("Blocking:", start, end) ;
+
+// Async. Keep DEPTH transfers in flight, re-using the op slots in turn
+
+  if ((bus = wiringPiAsyncCreate (DEPTH)) < 0)
+    return 1 ;
+
+  submitTime = 0 ;
+  start = micros () ;
+  for (i = 0 ; i < COUNT ; ++i)
+  {
+    struct wiringPiAsyncOp *op = &ops [i % DEPTH] ;
+    unsigned int t ;
+
+    if (i >= DEPTH)
+      wiringPiAsyncWait (bus, op, -1) ;
+
+    memset (op, 0, sizeof (*op)) ;
+    op->fd = fd ;
+    if (spi)
+    {
+      op->type = WPI_ASYNC_SPI ;
+      op->data = spiBuf [i % DEPTH] ;
+      op->len  = SPI_LEN ;
+    }
+    else
+    {
+      op->type = WPI_ASYNC_I2C_READ_REG8 ;
+      op->reg  = reg ;
+    }
+
+    t = micros () ;
+    wiringPiAsyncSubmit (bus, op) ;
+    submitTime += micros () - t ;
+  }
+  wiringPiAsyncDrain (bus) ;
+  end = micros () ;
+  report ("Async:", start, end) ;
+
+  printf ("Average time the caller spent submitting: %.2f uS\n", (double)submitTime / (double)COUNT) ;
+
+  wiringPiAsyncClose (bus) ;
+
+  return 0 ;
+}
@@ -0,0 +1,158 @@
+/*
+ * canvasSpeed.c:
+ *	Compare drawing a point at a time - the way the graphics drivers
+ *	used to - with the canvas's rectangle fills and glyph blits. This
+ *	just draws into memory, so needs no display attached.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#define	_GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <canvas.h>
+
+#define	WIDTH	128
+#define	HEIGHT	 64
+#define	PASSES	2000
+
+static struct canvas screen ;
+
+
+/*
+ * elapsed:
+ *********************************************************************************
+ */
+
+static double elapsed (struct timeval *start)
+{
+  struct timeval now, taken ;
+
+  gettimeofday (&now, NULL) ;
+  timersub (&now, start, &taken) ;
+  return taken.tv_sec + taken.tv_usec / 1000000.0 ;
+}
+
+
+/*
+ * fillPoints: fillRects:
+ *	Fill the screen with alternate colours, a pass at a time
+ *********************************************************************************
+ */
+
+static void fillPoints (int pass)
+{
+  int x, y ;
+
+  for (y = 0 ; y < screen.maxY ; ++y)
+    for (x = 0 ; x < screen.maxX ; ++x)
+      canvasPoint (&screen, x, y, pass & 1) ;
+}
+
+static void fillRects (int pass)
+{
+  canvasFillRect (&screen, 0, 0, screen.maxX - 1, screen.maxY - 1, pass & 1) ;
+}
+
+
+/*
+ * textPoints: textGlyphs:
+ *	Fill the screen with text - the first by plotting each bit of the
+ *	font as lcd128x64putchar () used to.
+ *********************************************************************************
+ */
+
+static void textPoints (int pass)
+{
+  static const unsigned char glyph [8] = { 0x7e, 0x81, 0xa5, 0x81, 0xbd, 0x99, 0x81, 0x7e } ;
+  int x, y, y1, bit ;
+
+  for (y = 0 ; y < screen.maxY ; y += 8)
+    for (x = 0 ; x < screen.maxX ; x += 8)
+      for (y1 = 0 ; y1 < 8 ; ++y1)
+	for (bit = 0 ; bit < 8 ; ++bit)
+	  canvasPoint (&screen, x + bit, y + 7 - y1, ((glyph [y1] ^ pass) & (0x80 >> bit)) != 0) ;
+}
+
+static void textGlyphs (int pass)
+{
+  int x, y ;
+
+  for (y = 0 ; y < screen.maxY ; y += 8)
+    for (x = 0 ; x < screen.maxX ; x += 8)
+      canvasPutchar (&screen, x, y, 1 + (pass & 1), 0, 1) ;
+}
+
+
+/*
+ * run:
+ *	Time a test in each orientation and print pixels/sec
+ *********************************************************************************
+ */
+
+static double run (const char *name, void (*test)(int pass))
+{
+  struct timeval start ;
+  double taken, rate ;
+  int orientation, pass ;
+
+  gettimeofday (&start, NULL) ;
+
+  for (orientation = 0 ; orientation < 4 ; ++orientation)
+  {
+    canvasSetOrientation (&screen, orientation) ;
+    for (pass = 0 ; pass < PASSES ; ++pass)
+      test (pass) ;
+  }
+
+  taken = elapsed (&start) ;
+  rate  = 4.0 * PASSES * WIDTH * HEIGHT / taken ;
+
+  printf ("  %-12s %8.3f sec, %12.0f pixels/sec\n", name, taken, rate) ;
+
+  return rate ;
+}
+
+
+int main (void)
+{
+  double points, fast ;
+
+  if (canvasInit (&screen, WIDTH, HEIGHT) != 0)
+  {
+    fprintf (stderr, "canvasSpeed: Out of memory\n") ;
+    return 1 ;
+  }
+
+  printf ("%dx%d canvas, %d full screens in each orientation:\n", WIDTH, HEIGHT, PASSES) ;
+
+  points = run ("fill points", fillPoints) ;
+  fast   = run ("fill rects",  fillRects) ;
+  printf ("    %.1f times faster\n", fast / points) ;
+
+  points = run ("text points", textPoints) ;
+  fast   = run ("text glyphs", textGlyphs) ;
+  printf ("    %.1f times faster\n", fast / points) ;
+
+  canvasFree (&screen) ;
+
+  return 0 ;
+}
@@ -0,0 +1,183 @@
+/*
+ * drcSpeed.c:
+ *	Time remote pin operations over the DRC serial protocol, one at a
+ *	time and pipelined. The remote end is a stand-in device on the
+ *	other side of a pseudo-terminal, so no hardware is needed; it
+ *	answers with values derived from the pin number so we can check
+ *	that the pipelined replies come back in the right order.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#define	_GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <wiringPi.h>
+#include <drcSerial.h>
+
+#define	BASE	100
+#define	PINS	 20
+#define	COUNT	2000
+
+
+/*
+ * fakeDrc:
+ *	Enough of the DRC firmware to answer the library
+ *********************************************************************************
+ */
+
+static void fakeDrc (int fd)
+{
+  unsigned char in [256], out [512] ;
+  int n, i, o, pin ;
+  int need = 0, cmd = 0 ;
+
+  for (;;)
+  {
+    if ((n = read (fd, in, sizeof (in))) <= 0)
+      exit (0) ;
+
+    for (i = o = 0 ; i < n ; ++i)
+    {
+      if (need == 0)
+      {
+	cmd = in [i] ;
+	/**/ if (cmd == '@') out [o++] = '@' ;
+	else if (cmd == 'v') need = 2 ;
+	else                 need = 1 ;
+	continue ;
+      }
+
+      if (--need > 0)		// pwm: pin then value
+	continue ;
+
+      pin = in [i] ;
+      if (cmd == 'a')
+      {
+	out [o++] = (pin * 37) >> 8 ;
+	out [o++] = (pin * 37) & 0xFF ;
+      }
+      else if (cmd == 'r')
+	out [o++] = (pin & 1) ? '1' : '0' ;
+    }
+
+    if (o > 0)
+      write (fd, out, o) ;
+  }
+}
+
+
+/*
+ * elapsed:
+ *********************************************************************************
+ */
+
+static double elapsed (struct timeval *start)
+{
+  struct timeval now, taken ;
+
+  gettimeofday (&now, NULL) ;
+  timersub (&now, start, &taken) ;
+  return taken.tv_sec + taken.tv_usec / 1000000.0 ;
+}
+
+
+int main (void)
+{
+  int master, i, errors = 0 ;
+  pid_t pid ;
+  int pins [COUNT], values [COUNT] ;
+  struct timeval start ;
+  double t ;
+
+  if (((master = posix_openpt (O_RDWR | O_NOCTTY)) < 0) || (grantpt (master) < 0) || (unlockpt (master) < 0))
+  {
+    perror ("pty") ;
+    return 1 ;
+  }
+
+  if ((pid = fork ()) == 0)
+    fakeDrc (master) ;
+
+  if (drcSetupSerial (BASE, PINS, ptsname (master), 115200) != 0)
+  {
+    fprintf (stderr, "drcSetupSerial failed\n") ;
+    return 1 ;
+  }
+
+  for (i = 0 ; i < COUNT ; ++i)
+    pins [i] = BASE + (i % PINS) ;
+
+// One at a time - a round trip each
+
+  gettimeofday (&start, NULL) ;
+  for (i = 0 ; i < COUNT ; ++i)
+    if (analogRead (pins [i]) != (i % PINS) * 37)
+      ++errors ;
+  t = elapsed (&start) ;
+  printf ("analogRead:       %8.0f reads/sec\n", COUNT / t) ;
+
+// Pipelined
+
+  gettimeofday (&start, NULL) ;
+  analogReadMulti (pins, values, COUNT) ;
+  t = elapsed (&start) ;
+  for (i = 0 ; i < COUNT ; ++i)
+    if (values [i] != (i % PINS) * 37)
+      ++errors ;
+  printf ("analogReadMulti:  %8.0f reads/sec\n", COUNT / t) ;
+
+  gettimeofday (&start, NULL) ;
+  digitalReadMulti (pins, values, COUNT) ;
+  t = elapsed (&start) ;
+  for (i = 0 ; i < COUNT ; ++i)
+    if (values [i] != (i % PINS) % 2)
+      ++errors ;
+  printf ("digitalReadMulti: %8.0f reads/sec\n", COUNT / t) ;
+
+// Writes: one write () per call, then batched
+
+  gettimeofday (&start, NULL) ;
+  for (i = 0 ; i < COUNT ; ++i)
+    digitalWrite (pins [i], i & 1) ;
+  t = elapsed (&start) ;
+  printf ("digitalWrite:     %8.0f writes/sec\n", COUNT / t) ;
+
+  gettimeofday (&start, NULL) ;
+  wiringPiBegin (BASE) ;
+    for (i = 0 ; i < COUNT ; ++i)
+      digitalWrite (pins [i], i & 1) ;
+  wiringPiCommit (BASE) ;
+  t = elapsed (&start) ;
+  printf ("  ... buffered:   %8.0f writes/sec\n", COUNT / t) ;
+
+  printf ("%d errors\n", errors) ;
+
+  kill (pid, SIGTERM) ;
+  waitpid (pid, NULL, 0) ;
+
+  return errors != 0 ;
+}
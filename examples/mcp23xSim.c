@@ -0,0 +1,317 @@
+/*
+ * mcp23xSim.c:
+ *	Check the MCP23x17 interrupt dispatch against a simulated chip: a
+ *	register file behind the mcp23x register access functions that
+ *	captures INTF/INTCAP and clears them when read, as the real one does.
+ *	A second chip stands in for an MCP23S17 at a non-zero address to
+ *	check IOCON.HAEN survives setting up interrupts. Needs no hardware.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wiringPi.h>
+#include <mcp23x.h>
+
+#define	BASE	100
+#define	BASE2	200
+
+// MCP23x17 registers with IOCON.BANK = 0: A and B interleaved
+
+#define	GPINTENA	0x04
+#define	INTCONA		0x08
+#define	INTFA		0x0E
+#define	INTCAPA		0x10
+#define	GPIOA		0x12
+#define	IOCON		0x0A
+
+#define	IOCON_HAEN	0x08
+#define	IOCON_MIRROR	0x40
+
+static unsigned char regs [22] ;
+static int failReads ;		// Make the next n burst reads fail
+static int errors ;
+
+static int callbacks [16][2] ;	// Count of each value seen per pin
+
+
+/*
+ * The simulated chip
+ *********************************************************************************
+ */
+
+static int simRead (int reg)
+{
+  int value = regs [reg] ;
+
+// Reading INTCAP or GPIO clears the interrupt for that bank
+
+  if ((reg >= INTCAPA) && (reg <= GPIOA + 1))
+    regs [INTFA + (reg & 1)] = 0 ;
+
+  return value ;
+}
+
+static int readReg (struct wiringPiNodeStruct *node, int reg)
+{
+  return simRead (reg) ;
+}
+
+static void writeReg (struct wiringPiNodeStruct *node, int reg, int value)
+{
+  if ((reg != INTFA) && (reg != INTFA + 1) && (reg != INTCAPA) && (reg != INTCAPA + 1))
+    regs [reg] = value ;
+}
+
+static int readRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  int i ;
+
+  if (failReads > 0)
+  {
+    --failReads ;
+    return -1 ;
+  }
+
+  for (i = 0 ; i < len ; ++i)
+    data [i] = simRead (reg + i) ;
+
+  return len ;
+}
+
+static int writeRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  int i ;
+
+  for (i = 0 ; i < len ; ++i)
+    writeReg (node, reg + i, data [i]) ;
+
+  return len ;
+}
+
+
+/*
+ * The addressed 23S17:
+ *	Sharing a chip select, it only sees transfers to its address (3)
+ *	while IOCON.HAEN is set - otherwise it answers to 0 and we lose it.
+ *********************************************************************************
+ */
+
+static unsigned char s17 [22] ;
+static int s17Lost ;		// Transfers the chip never saw
+
+static int s17Read (struct wiringPiNodeStruct *node, int reg)
+{
+  if ((s17 [IOCON] & IOCON_HAEN) == 0)
+  {
+    ++s17Lost ;
+    return 0xFF ;
+  }
+  return s17 [reg] ;
+}
+
+static void s17Write (struct wiringPiNodeStruct *node, int reg, int value)
+{
+  if ((s17 [IOCON] & IOCON_HAEN) == 0)
+    ++s17Lost ;
+  else if ((reg != INTFA) && (reg != INTFA + 1) && (reg != INTCAPA) && (reg != INTCAPA + 1))
+    s17 [reg] = value ;
+}
+
+static int s17ReadRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  int i ;
+
+  for (i = 0 ; i < len ; ++i)
+    data [i] = s17Read (node, reg + i) ;
+
+  return len ;
+}
+
+static int s17WriteRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  int i ;
+
+  for (i = 0 ; i < len ; ++i)
+    s17Write (node, reg + i, data [i]) ;
+
+  return len ;
+}
+
+
+/*
+ * setInput:
+ *	Change an input on the simulated chip. With interrupt-on-change
+ *	enabled, the first change latches INTF and a copy of the port into
+ *	INTCAP; later ones just add to INTF until it's cleared.
+ *********************************************************************************
+ */
+
+static void setInput (int pin, int value)
+{
+  int bank = pin >> 3 ;
+  int bit  = 1 << (pin & 7) ;
+  int old  = regs [GPIOA + bank] ;
+
+  regs [GPIOA + bank] = value ? (old | bit) : (old & ~bit) ;
+
+  if ((regs [GPIOA + bank] == old) || ((regs [GPINTENA + bank] & bit) == 0) || ((regs [INTCONA + bank] & bit) != 0))
+    return ;
+
+  if (regs [INTFA + bank] == 0)
+    regs [INTCAPA + bank] = regs [GPIOA + bank] ;
+  regs [INTFA + bank] |= bit ;
+}
+
+
+/*
+ * check:
+ *********************************************************************************
+ */
+
+static void check (const char *what, int ok)
+{
+  printf ("  %-50s %s\n", what, ok ? "OK" : "FAIL") ;
+  if (!ok)
+    ++errors ;
+}
+
+static void callback (int pin, int value, void *userData)
+{
+  ++callbacks [pin - BASE][value] ;
+  if (userData != (void *)callbacks)
+    ++errors ;
+}
+
+static int pending (void)
+{
+  struct mcp23xEvent event ;
+  int n = 0 ;
+
+  while (mcp23xGetEvent (BASE, &event, 0) == 1)
+    ++n ;
+
+  return n ;
+}
+
+
+int main (void)
+{
+  struct wiringPiNodeStruct *node ;
+  struct mcp23xState *state ;
+  struct mcp23xEvent event ;
+  int i, n, ok ;
+
+  node = wiringPiNewNode (BASE, 16) ;
+  (void)mcp23xNew (node, 2, readReg, writeReg, readRegs, writeRegs) ;
+
+  printf ("Simulated MCP23x17 at pin %d:\n", BASE) ;
+
+// Edge filters: 0 rising, 1 falling, 2 both - all by callback
+
+  mcp23xPinInterrupt (BASE + 0, INT_EDGE_RISING,  callback, callbacks) ;
+  mcp23xPinInterrupt (BASE + 1, INT_EDGE_FALLING, callback, callbacks) ;
+  mcp23xPinInterrupt (BASE + 2, INT_EDGE_BOTH,    callback, callbacks) ;
+
+  check ("GPINTEN set for the enabled pins", regs [GPINTENA] == 0x07) ;
+
+  for (i = 0 ; i < 6 ; ++i)
+  {
+    setInput (0, !(i & 1)) ; mcp23xServiceInterrupt (BASE) ;
+    setInput (1, !(i & 1)) ; mcp23xServiceInterrupt (BASE) ;
+    setInput (2, !(i & 1)) ; mcp23xServiceInterrupt (BASE) ;
+  }
+
+  check ("rising filter: 3 highs, no lows",  (callbacks [0][1] == 3) && (callbacks [0][0] == 0)) ;
+  check ("falling filter: 3 lows, no highs", (callbacks [1][0] == 3) && (callbacks [1][1] == 0)) ;
+  check ("both edges: 3 of each",            (callbacks [2][0] == 3) && (callbacks [2][1] == 3)) ;
+  check ("INTF cleared after service",       (regs [INTFA] == 0) && (regs [INTFA + 1] == 0)) ;
+
+// Bank B through the queue, and the value comes from INTCAP not GPIO
+
+  mcp23xPinInterrupt (BASE + 9, INT_EDGE_BOTH, NULL, NULL) ;
+  setInput (9, 1) ;
+  setInput (9, 0) ;	// Changed back before we got there
+  mcp23xServiceInterrupt (BASE) ;
+  ok = (mcp23xGetEvent (BASE, &event, 0) == 1) && (event.pin == BASE + 9) && (event.value == 1) ;
+  check ("bank B event queued with the INTCAP value", ok) ;
+  check ("nothing else queued", pending () == 0) ;
+
+// A failed read is retried rather than leaving INT asserted
+
+  setInput (9, 1) ;
+  failReads = 2 ;
+  mcp23xServiceInterrupt (BASE) ;
+  check ("serviced after 2 failed reads", (pending () == 1) && (regs [INTFA + 1] == 0)) ;
+
+// A resync doesn't touch INTCAP or GPIO, so a pending change survives it
+
+  setInput (9, 0) ;
+  mcp23xResync (BASE) ;
+  check ("resync leaves the interrupt pending", regs [INTFA + 1] != 0) ;
+  mcp23xServiceInterrupt (BASE) ;
+  check ("and it's then delivered", pending () == 1) ;
+
+// Overflow: the queue keeps the newest MCP23X_EVENTS - 1 changes
+
+  n = MCP23X_EVENTS + 10 ;
+  for (i = 0 ; i < n ; ++i)
+  {
+    setInput (9, i & 1) ;
+    mcp23xServiceInterrupt (BASE) ;
+  }
+
+  ok = 1 ;
+  for (i = n - (MCP23X_EVENTS - 1) ; i < n ; ++i)
+    if ((mcp23xGetEvent (BASE, &event, 0) != 1) || (event.value != (i & 1)))
+      ok = 0 ;
+  check ("overflow keeps the newest events in order", ok && (pending () == 0)) ;
+
+// Disabling a pin stops its events
+
+  mcp23xPinInterrupt (BASE + 9, INT_EDGE_SETUP, NULL, NULL) ;
+  setInput (9, 1) ;
+  mcp23xServiceInterrupt (BASE) ;
+  check ("disabled pin reports nothing", pending () == 0) ;
+
+// The 23S17 at address 3: set up as mcp23s17Setup () does, with HAEN
+
+  printf ("Simulated MCP23S17 at pin %d, address 3:\n", BASE2) ;
+
+  s17 [IOCON]  = IOCON_HAEN ;
+  node         = wiringPiNewNode (BASE2, 16) ;
+  node->data1  = 3 ;
+  state        = mcp23xNew (node, 2, s17Read, s17Write, s17ReadRegs, s17WriteRegs) ;
+  state->iocon = IOCON_HAEN ;
+
+  mcp23xSetupInterrupt (BASE2, -1) ;
+  check ("HAEN kept and MIRROR set by the interrupt setup", s17 [IOCON] == (IOCON_HAEN | IOCON_MIRROR)) ;
+
+  mcp23xPinInterrupt (BASE2 + 3, INT_EDGE_BOTH, NULL, NULL) ;
+  check ("and the chip still hears us", (s17 [GPINTENA] == 0x08) && (s17Lost == 0)) ;
+
+  mcp23xStopInterrupt (BASE2) ;
+  check ("stopping puts IOCON back", s17 [IOCON] == IOCON_HAEN) ;
+
+  printf ("%d errors\n", errors) ;
+
+  return errors != 0 ;
+}
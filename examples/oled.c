@@ -0,0 +1,90 @@
+/*
+ * oled.c:
+ *	Simple test of an SSD1306 or SH1106 128x64 OLED display, reporting
+ *	the frame rate for full screen and partial updates.
+ *
+ *	oled [sh1106] [i2c address]	- default SSD1306 at 0x3C
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wiringPi.h>
+#include <canvas.h>
+#include <ssd1306.h>
+
+#define	FRAMES	200
+
+
+int main (int argc, char *argv [])
+{
+  struct canvas *c ;
+  int type = SSD1306, address = 0x3C ;
+  int fd, frame, maxX, maxY ;
+  unsigned int start ;
+  char buf [16] ;
+
+  if ((argc > 1) && (strcmp (argv [1], "sh1106") == 0))
+  {
+    type = SH1106 ;
+    --argc ; ++argv ;
+  }
+  if (argc > 1)
+    address = strtol (argv [1], NULL, 0) ;
+
+  wiringPiSetup () ;
+
+  if ((fd = ssd1306SetupI2C (type, address)) == -1)
+  {
+    fprintf (stderr, "oled: Unable to initialise the display at 0x%02X\n", address) ;
+    return 1 ;
+  }
+
+  c = ssd1306Canvas (fd) ;
+  canvasGetSize (c, &maxX, &maxY) ;
+
+// Full screen: a bouncing filled circle on an inverting background
+
+  start = millis () ;
+  for (frame = 0 ; frame < FRAMES ; ++frame)
+  {
+    canvasClear  (c, frame & 1) ;
+    canvasCircle (c, frame % maxX, maxY / 2, 20, !(frame & 1), 1) ;
+    ssd1306Update (fd) ;
+  }
+  printf ("Full screen: %.1f frames/sec\n", FRAMES * 1000.0 / (millis () - start)) ;
+
+// Just a counter changing
+
+  canvasClear (c, 0) ;
+  canvasPuts  (c, 0, maxY - 8, "wiringPi OLED", 0, 1) ;
+
+  start = millis () ;
+  for (frame = 0 ; frame < FRAMES ; ++frame)
+  {
+    sprintf (buf, "%5d", frame) ;
+    canvasPuts (c, 0, 0, buf, 0, 1) ;
+    ssd1306Update (fd) ;
+  }
+  printf ("Counter:     %.1f frames/sec\n", FRAMES * 1000.0 / (millis () - start)) ;
+
+  return 0 ;
+}
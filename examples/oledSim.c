@@ -0,0 +1,262 @@
+/*
+ * oledSim.c:
+ *	Check the SSD1306/SH1106 driver against simulated controllers on
+ *	both I2C and SPI: after every update the controller's RAM must
+ *	match the canvas. Also reports the bus bytes each update costs.
+ *	Needs no hardware - the I2C and SPI calls below stand in for the
+ *	ones in wiringPi, and the D/C line is a pretend pin.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <wiringPi.h>
+#include <wiringPiI2C.h>
+#include <wiringPiSPI.h>
+#include <canvas.h>
+#include <ssd1306.h>
+
+#define	DC_PIN		200	// The pretend one
+#define	FRAMES		60
+
+#define	RAM_WIDTH	132	// The SH1106 has 132 columns, the 128 shown start at 2
+#define	RAM_PAGES	8
+
+// The simulated controller
+
+static int           simType ;
+static unsigned char ram [RAM_PAGES][RAM_WIDTH] ;
+static int           page, col ;
+static int           colLo = 0, colHi = 127, pageLo = 0, pageHi = 7 ;	// SSD1306 window
+static unsigned char cmd [3] ;
+static int           cmdLen ;
+static int           dc ;
+static long          busBytes ;
+
+
+/*
+ * command: data:
+ *	Feed a byte to the controller. Only the addressing commands do
+ *	anything; the rest just need their arguments skipping.
+ *********************************************************************************
+ */
+
+static int argBytes (int c)
+{
+  if (simType == SSD1306)
+  {
+    if ((c == 0x21) || (c == 0x22))
+      return 2 ;
+    if ((c == 0x8D) || (c == 0x20))
+      return 1 ;
+  }
+  else if (c == 0xAD)
+    return 1 ;
+
+  switch (c)
+  {
+    case 0x81: case 0xD5: case 0xA8: case 0xD3: case 0xDA: case 0xD9: case 0xDB:
+      return 1 ;
+  }
+
+  return 0 ;
+}
+
+static void command (unsigned char b)
+{
+  int c ;
+
+  cmd [cmdLen++] = b ;
+  c = cmd [0] ;
+  if (cmdLen <= argBytes (c))
+    return ;
+  cmdLen = 0 ;
+
+  if (simType == SSD1306)
+  {
+    /**/ if (c == 0x21) { colLo  = cmd [1] ; colHi  = cmd [2] ; col  = colLo  ; }
+    else if (c == 0x22) { pageLo = cmd [1] ; pageHi = cmd [2] ; page = pageLo ; }
+  }
+  else
+  {
+    /**/ if ((c & 0xF0) == 0xB0) page = c & 7 ;
+    else if ((c & 0xF0) == 0x00) col  = (col & 0xF0) | (c & 0x0F) ;
+    else if ((c & 0xF0) == 0x10) col  = (col & 0x0F) | ((c & 0x0F) << 4) ;
+  }
+}
+
+static void data (unsigned char b)
+{
+  if (simType == SSD1306)	// Horizontal addressing inside the window
+  {
+    ram [page][col] = b ;
+    if (++col > colHi)
+    {
+      col = colLo ;
+      if (++page > pageHi)
+	page = pageLo ;
+    }
+  }
+  else				// Page addressing, column stops at the end
+  {
+    if (col < RAM_WIDTH)
+      ram [page][col] = b ;
+    ++col ;
+  }
+}
+
+
+/*
+ * The bus: stand-ins for the wiringPi I2C and SPI calls the driver makes
+ *********************************************************************************
+ */
+
+int wiringPiI2CSetupShared (const int devId)
+{
+  return 1000 + devId ;
+}
+
+int wiringPiI2CWriteRaw (int fd, const uint8_t *buf, int len)
+{
+  int i ;
+
+  busBytes += len + 1 ;		// And the address
+  for (i = 1 ; i < len ; ++i)
+    if (buf [0] == 0x40)
+      data (buf [i]) ;
+    else
+      command (buf [i]) ;
+
+  return len ;
+}
+
+int wiringPiSPISetup (int channel, int speed)
+{
+  return 0 ;
+}
+
+int wiringPiSPIDataRW (int channel, unsigned char *buf, int len)
+{
+  int i ;
+
+  busBytes += len ;
+  for (i = 0 ; i < len ; ++i)
+    if (dc)
+      data (buf [i]) ;
+    else
+      command (buf [i]) ;
+
+  return len ;
+}
+
+static void dcWrite (struct wiringPiNodeStruct *node, int pin, int value)
+{
+  dc = value ;
+}
+
+
+/*
+ * compare:
+ *	Count the bytes where the controller's RAM doesn't match the
+ *	canvas, and check the SH1106's 2 hidden columns each side got
+ *	cleared.
+ *********************************************************************************
+ */
+
+static int compare (struct canvas *c)
+{
+  int offset = (simType == SH1106) ? 2 : 0 ;
+  int p, x, bad = 0 ;
+
+  for (p = 0 ; p < RAM_PAGES ; ++p)
+  {
+    for (x = 0 ; x < 128 ; ++x)
+      if (ram [p][x + offset] != c->buffer [p * 128 + x])
+	++bad ;
+
+    if ((simType == SH1106) && (ram [p][0] | ram [p][1] | ram [p][130] | ram [p][131]))
+      ++bad ;
+  }
+
+  return bad ;
+}
+
+
+int main (void)
+{
+  struct wiringPiNodeStruct *node ;
+  struct canvas *c ;
+  char buf [16] ;
+  long start ;
+  int spi, fd, frame, bad, errors = 0 ;
+
+  node = wiringPiNewNode (DC_PIN, 1) ;
+  node->digitalWrite = dcWrite ;
+
+  for (simType = SSD1306 ; simType <= SH1106 ; ++simType)
+    for (spi = 0 ; spi < 2 ; ++spi)
+    {
+      memset (ram, 0x55, sizeof (ram)) ;	// Power up rubbish
+      page = col = cmdLen = 0 ;
+
+      fd = spi ? ssd1306SetupSPI (simType, 0, 8000000, DC_PIN, -1) : ssd1306SetupI2C (simType, 0x3C) ;
+      if (fd == -1)
+      {
+	fprintf (stderr, "oledSim: Unable to set up the display\n") ;
+	return 1 ;
+      }
+      c   = ssd1306Canvas (fd) ;
+      bad = compare (c) ;
+
+      printf ("%s on %s:\n", (simType == SH1106) ? "SH1106" : "SSD1306", spi ? "SPI" : "I2C") ;
+
+// Full screen changes
+
+      start = busBytes ;
+      for (frame = 0 ; frame < FRAMES ; ++frame)
+      {
+	canvasClear  (c, frame & 1) ;
+	canvasCircle (c, 64, 32, 20 + frame % 10, !(frame & 1), 1) ;
+	canvasPuts   (c, 0, 0, "Hello", frame & 1, !(frame & 1)) ;
+	ssd1306Update (fd) ;
+	bad += compare (c) ;
+      }
+      printf ("  full screen: %5ld bus bytes/update\n", (busBytes - start) / FRAMES) ;
+
+// Just a counter
+
+      start = busBytes ;
+      for (frame = 0 ; frame < FRAMES ; ++frame)
+      {
+	sprintf (buf, "%5d", frame) ;
+	canvasPuts (c, 80, 56, buf, 0, 1) ;
+	ssd1306Update (fd) ;
+	bad += compare (c) ;
+      }
+      printf ("  counter:     %5ld bus bytes/update\n", (busBytes - start) / FRAMES) ;
+      printf ("  %d mismatches\n", bad) ;
+
+      errors += bad ;
+    }
+
+  return errors != 0 ;
+}
@@ -0,0 +1,250 @@
+/*
+ * rs485Speed.c:
+ *	Time RS-485 request/response transactions and the driver enable
+ *	turnaround. The far end is a stand-in device on the other side of
+ *	a pseudo-terminal, and the driver enable is a pretend pin on a
+ *	device node that just notes when it changes, so this runs without
+ *	any hardware. On a real port pass the device and a real DE pin, or
+ *	-1 to have the kernel drive RTS:
+ *
+ *	rs485Speed [device baud dePin]
+ *
+ *	With a real port we can't see the last stop bit, so it's taken as
+ *	the frame's time on the wire after the write started.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#define	_GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include <wiringPi.h>
+#include <wiringSerial.h>
+
+#define	COUNT		1000
+#define	FRAME		8
+#define	DE_PIN		200	// The pretend one
+
+static unsigned long long deRise, deFall ;
+static int pretend ;
+
+
+/*
+ * nowNs:
+ *********************************************************************************
+ */
+
+static unsigned long long nowNs (void)
+{
+  struct timespec ts ;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts) ;
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec ;
+}
+
+
+/*
+ * deWrite:
+ *	The pretend driver enable pin
+ *********************************************************************************
+ */
+
+static void deWrite (struct wiringPiNodeStruct *node, int pin, int value)
+{
+  if (value)
+    deRise = nowNs () ;
+  else
+    deFall = nowNs () ;
+}
+
+
+/*
+ * slave:
+ *	Answer each request with the same frame, first byte inverted
+ *********************************************************************************
+ */
+
+static void slave (int fd)
+{
+  unsigned char buf [FRAME] ;
+  int n, got = 0 ;
+
+  while ((n = read (fd, buf + got, FRAME - got)) > 0)
+    if ((got += n) == FRAME)
+    {
+      buf [0] ^= 0xFF ;
+      write (fd, buf, FRAME) ;
+      got = 0 ;
+    }
+
+  exit (0) ;
+}
+
+
+/*
+ * turnaround:
+ *	Send a frame and time the three points between the last stop bit
+ *	going and the first byte of the reply coming back. Returns 0 if
+ *	the reply is wrong.
+ *********************************************************************************
+ */
+
+static int turnaround (int fd, int seq, unsigned long long wire, long long *stopToDe, long long *deToReply)
+{
+  char request [FRAME + 1] ;
+  unsigned char reply [FRAME] ;
+  unsigned long long start, lastStop, deLow, first ;
+
+  memset (request, 'A' + seq % 26, FRAME) ;
+  request [FRAME] = 0 ;
+
+  start = nowNs () ;
+  serialPuts (fd, request) ;		// DE is down again when this returns
+  deLow = pretend ? deFall : nowNs () ;
+
+  if (serialRead (fd, reply, 1, 100) != 1)
+    return 0 ;
+  first = nowNs () ;
+
+  if (serialRead (fd, reply + 1, FRAME - 1, 100) != FRAME - 1)
+    return 0 ;
+
+  lastStop   = pretend ? deRise : start + wire ;	// A pty has no wire
+  *stopToDe  = (long long)(deLow - lastStop) ;
+  *deToReply = (long long)(first - deLow) ;
+
+  return (reply [0] == ((unsigned char)request [0] ^ 0xFF)) && (memcmp (reply + 1, request + 1, FRAME - 1) == 0) ;
+}
+
+
+int main (int argc, char *argv [])
+{
+  unsigned char request [FRAME], reply [FRAME] ;
+  unsigned long long start, end, total = 0, worst = 0, deTotal = 0, deWorst = 0, t, wire ;
+  long long stopToDe, deToReply, sdTotal = 0, sdWorst = 0, drTotal = 0, drWorst = 0 ;
+  int fd, master = -1, dePin = DE_PIN, baud = 115200, i, n, errors = 0, good = 0 ;
+  const char *device ;
+  pid_t pid = 0 ;
+
+  if (argc == 4)
+  {
+    device = argv [1] ;
+    baud   = atoi (argv [2]) ;
+    dePin  = atoi (argv [3]) ;
+    wiringPiSetup () ;
+  }
+  else
+  {
+    struct wiringPiNodeStruct *node = wiringPiNewNode (DE_PIN, 1) ;
+    node->digitalWrite = deWrite ;
+    pretend = 1 ;
+
+    if (((master = posix_openpt (O_RDWR | O_NOCTTY)) < 0) || (grantpt (master) < 0) || (unlockpt (master) < 0))
+    {
+      perror ("pty") ;
+      return 1 ;
+    }
+    device = ptsname (master) ;
+  }
+
+  if ((fd = serialOpen (device, baud)) < 0)
+  {
+    fprintf (stderr, "Unable to open %s\n", device) ;
+    return 1 ;
+  }
+
+  if ((master >= 0) && ((pid = fork ()) == 0))
+    slave (master) ;
+
+  if (serialSetRS485 (fd, dePin, 0) != 0)
+  {
+    perror ("serialSetRS485") ;
+    return 1 ;
+  }
+
+  for (i = 0 ; i < COUNT ; ++i)
+  {
+    memset (request, i, FRAME) ;
+
+    start = nowNs () ;
+    n     = serialTransaction (fd, request, FRAME, reply, FRAME, 100) ;
+    end   = nowNs () ;
+
+    if ((n != FRAME) || (reply [0] != (request [0] ^ 0xFF)) || (memcmp (reply + 1, request + 1, FRAME - 1) != 0))
+      ++errors ;
+
+// Total time includes the inter-frame gap we wait before sending
+
+    t = end - start ;
+    total += t ;
+    if (t > worst) worst = t ;
+
+    t = deFall - deRise ;
+    deTotal += t ;
+    if (t > deWorst) deWorst = t ;
+  }
+
+// Turnaround: last stop bit to DE low, then DE low to the first reply byte
+
+  wire = (unsigned long long)FRAME * 10 * 1000000000ULL / baud ;
+
+  for (i = 0 ; i < COUNT ; ++i)
+  {
+    if (!turnaround (fd, i, wire, &stopToDe, &deToReply))
+    {
+      ++errors ;
+      serialFlush (fd) ;
+      continue ;
+    }
+
+    ++good ;
+    sdTotal += stopToDe ;
+    if (stopToDe > sdWorst) sdWorst = stopToDe ;
+    drTotal += deToReply ;
+    if (deToReply > drWorst) drWorst = deToReply ;
+  }
+
+  printf ("%d transactions of %d bytes: %.0f/sec\n", COUNT, FRAME, COUNT * 1.0e9 / total) ;
+  printf ("  transaction: %8.1f uS mean, %8.1f uS worst\n", total / 1000.0 / COUNT, worst / 1000.0) ;
+  if (master >= 0)
+    printf ("  DE held:     %8.1f uS mean, %8.1f uS worst\n", deTotal / 1000.0 / COUNT, deWorst / 1000.0) ;
+  if (good > 0)
+  {
+    printf ("Turnaround:\n") ;
+    printf ("  stop to DE:  %8.1f uS mean, %8.1f uS worst\n", sdTotal / 1000.0 / good, sdWorst / 1000.0) ;
+    printf ("  DE to reply: %8.1f uS mean, %8.1f uS worst\n", drTotal / 1000.0 / good, drWorst / 1000.0) ;
+  }
+  printf ("  %d errors\n", errors) ;
+
+  serialClose (fd) ;
+  if (pid > 0)
+  {
+    kill (pid, SIGTERM) ;
+    waitpid (pid, NULL, 0) ;
+  }
+
+  return errors != 0 ;
+}
@@ -0,0 +1,159 @@
+/*
+ * serialSpeed.c:
+ *	Compare byte at a time serial I/O with the buffered port over a
+ *	pseudo-terminal looped back on itself, counting the system calls.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with wiringPi.  If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#define	_GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <wiringSerial.h>
+
+#define	COUNT	100000
+#define	LINE	64
+
+
+/*
+ * loopback:
+ *	Send everything straight back
+ *********************************************************************************
+ */
+
+static void loopback (int fd)
+{
+  char buf [4096] ;
+  int n ;
+
+  while ((n = read (fd, buf, sizeof (buf))) > 0)
+    write (fd, buf, n) ;
+
+  exit (0) ;
+}
+
+
+/*
+ * elapsed:
+ *********************************************************************************
+ */
+
+static double elapsed (struct timeval *start)
+{
+  struct timeval now, taken ;
+
+  gettimeofday (&now, NULL) ;
+  timersub (&now, start, &taken) ;
+  return taken.tv_sec + taken.tv_usec / 1000000.0 ;
+}
+
+
+/*
+ * run:
+ *	Send COUNT bytes as lines of LINE and read them back as we go, so
+ *	we never get far ahead of the pty's buffer.
+ *********************************************************************************
+ */
+
+static void run (const char *name, int fd, int buffered)
+{
+  struct timeval start ;
+  struct serialStats stats ;
+  char line [LINE + 1] ;
+  int i, j, c, errors = 0 ;
+  double t ;
+
+  memset (line, 'x', LINE - 1) ;
+  line [LINE - 1] = '\n' ;
+  line [LINE]     = 0 ;
+
+  gettimeofday (&start, NULL) ;
+
+  for (i = 0 ; i < COUNT ; i += LINE)
+  {
+    for (j = 0 ; j < LINE ; ++j)
+      serialPutchar (fd, line [j]) ;
+
+    if (buffered)
+    {
+      if (serialReadUntil (fd, line, LINE, '\n', 1000) != LINE)
+	++errors ;
+    }
+    else
+    {
+      for (j = 0 ; j < LINE ; ++j)
+	if ((c = serialGetchar (fd)) != line [j])
+	  ++errors ;
+    }
+  }
+
+  t = elapsed (&start) ;
+
+  printf ("%-10s %10.0f bytes/sec", name, COUNT / t) ;
+  if (buffered && (serialGetStats (fd, &stats) == 0))
+    printf (", %lu writes, %lu reads", stats.txCalls, stats.rxCalls) ;
+  else
+    printf (", %d writes, %d reads", COUNT, COUNT) ;
+  printf (", %d errors\n", errors) ;
+}
+
+
+int main (void)
+{
+  int master, fd ;
+  pid_t pid ;
+
+  if (((master = posix_openpt (O_RDWR | O_NOCTTY)) < 0) || (grantpt (master) < 0) || (unlockpt (master) < 0))
+  {
+    perror ("pty") ;
+    return 1 ;
+  }
+
+  if ((fd = serialOpen (ptsname (master), 115200)) < 0)
+  {
+    fprintf (stderr, "Unable to open %s\n", ptsname (master)) ;
+    return 1 ;
+  }
+
+  if ((pid = fork ()) == 0)
+    loopback (master) ;
+
+  run ("unbuffered", fd, 0) ;
+
+  if (serialSetBuffered (fd, LINE, 4096) != 0)
+  {
+    perror ("serialSetBuffered") ;
+    return 1 ;
+  }
+
+  run ("buffered", fd, 1) ;
+
+  serialClose (fd) ;
+  kill (pid, SIGTERM) ;
+  waitpid (pid, NULL, 0) ;
+
+  return 0 ;
+}
@@ -323,6 +323,39 @@ static int doExtensionSr595 (char *progName, int pinBase, char *params)
 }
 
 
+/*
+ * doExtensionSr595Spi:
+ *	Shift Register 74x595 chain on the SPI bus, latched by the chip select
+ *	sr595spi:base:pins:spi
+ *********************************************************************************
+ */
+
+static int doExtensionSr595Spi (char *progName, int pinBase, char *params)
+{
+  int pins, spi ;
+
+  if ((params = extractInt (progName, params, &pins)) == NULL)
+    return FALSE ;
+
+  if (pins < 8)
+  {
+    fprintf (stderr, "%s: pin count (%d) out of range - 8 or more expected.\n", progName, pins) ;
+    return FALSE ;
+  }
+
+  if ((params = extractInt (progName, params, &spi)) == NULL)
+    return FALSE ;
+
+  if ((spi < 0) || (spi > 1))
+  {
+    fprintf (stderr, "%s: SPI address (%d) out of range\n", progName, spi) ;
+    return FALSE ;
+  }
+
+  return sr595SpiSetup (pinBase, pins, spi, 4000000, -1) == 0 ;
+}
+
+
 /*
  * doExtensionPcf8574:
  *	Digital IO (Crude!)
@@ -621,6 +654,7 @@ struct extensionFunctionStruct extensionFunctions [] =
   { "mcp23s08",		&doExtensionMcp23s08 	},
   { "mcp23s17",		&doExtensionMcp23s17 	},
   { "sr595",		&doExtensionSr595	},
+  { "sr595spi",		&doExtensionSr595Spi	},
   { "pcf8574",		&doExtensionPcf8574	},
   { "pcf8591",		&doExtensionPcf8591	},
   { "mcp3002",		&doExtensionMcp3002	},
@@ -0,0 +1,329 @@
+/*
+ * analogCache.c:
+ *	Keep the latest value of slow analog pins fresh in the background.
+ *	Each registered pin has a refresh period; one worker thread reads
+ *	whatever is due - all the pins due together go through a single
+ *	analogReadMulti () - and publishes the results under a seqlock, so
+ *	any number of threads can read them without touching the bus.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with wiringPi.
+ *    If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "wiringPi.h"
+
+#include "analogCache.h"
+
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
+// analogCacheEntry:
+//	value and time are written by the worker, and reset along with pin
+//	when a slot is reused, always inside writeBegin/writeEnd with
+//	cacheLock held. seq is odd while that happens.
+
+struct analogCacheEntry
+{
+  volatile int       pin ;		// -1 when the slot is free
+  long long          period ;		// nS
+  unsigned long long due ;		// Next refresh, CLOCK_MONOTONIC nS
+
+  unsigned int       seq ;
+  int                value ;
+  unsigned long long time ;		// 0 until the first read
+} ;
+
+static struct analogCacheEntry cache [ANALOG_CACHE_MAX] ;
+static int cacheInit = FALSE ;
+
+static pthread_t       cacheThread ;
+static int             cacheRunning = FALSE ;
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t  cacheCond ;
+
+
+/*
+ * nowNs:
+ *********************************************************************************
+ */
+
+static unsigned long long nowNs (void)
+{
+  struct timespec ts ;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts) ;
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec ;
+}
+
+
+/*
+ * findEntry:
+ *	Lock-free, so readers never wait on the worker
+ *********************************************************************************
+ */
+
+static struct analogCacheEntry *findEntry (int pin)
+{
+  int i ;
+
+  for (i = 0 ; i < ANALOG_CACHE_MAX ; ++i)
+    if (cache [i].pin == pin)
+      return &cache [i] ;
+
+  return NULL ;
+}
+
+
+/*
+ * writeBegin: writeEnd:
+ *	The seqlock writer side, so readers never see a half updated entry
+ *********************************************************************************
+ */
+
+static void writeBegin (struct analogCacheEntry *entry)
+{
+  __atomic_store_n (&entry->seq, entry->seq + 1, __ATOMIC_RELAXED) ;
+  __atomic_thread_fence (__ATOMIC_RELEASE) ;
+}
+
+static void writeEnd (struct analogCacheEntry *entry)
+{
+  __atomic_store_n (&entry->seq, entry->seq + 1, __ATOMIC_RELEASE) ;
+}
+
+
+/*
+ * cacheWorker:
+ *	Sleep until the earliest due time, then read every pin that's due
+ *	in one go and step each one on by its period. Due times stay on
+ *	the period grid, but if we fall a whole period behind we don't try
+ *	to catch up.
+ *********************************************************************************
+ */
+
+static void *cacheWorker (void *arg)
+{
+  int pins [ANALOG_CACHE_MAX], values [ANALOG_CACHE_MAX] ;
+  struct analogCacheEntry *due [ANALOG_CACHE_MAX] ;
+  unsigned long long now, next ;
+  struct timespec ts ;
+  int i, n ;
+
+  pthread_mutex_lock (&cacheLock) ;
+
+  while (cacheRunning)
+  {
+    now  = nowNs () ;
+    next = 0 ;
+    n    = 0 ;
+
+    for (i = 0 ; i < ANALOG_CACHE_MAX ; ++i)
+    {
+      if (cache [i].pin < 0)
+	continue ;
+
+      if (cache [i].due <= now)
+      {
+	due  [n]   = &cache [i] ;
+	pins [n++] = cache [i].pin ;
+      }
+      else if ((next == 0) || (cache [i].due < next))
+	next = cache [i].due ;
+    }
+
+    if (n == 0)
+    {
+      if (next == 0)
+	pthread_cond_wait (&cacheCond, &cacheLock) ;
+      else
+      {
+	ts.tv_sec  = next / 1000000000ULL ;
+	ts.tv_nsec = next % 1000000000ULL ;
+	pthread_cond_timedwait (&cacheCond, &cacheLock, &ts) ;
+      }
+      continue ;
+    }
+
+// Drop the lock for the bus access so registering doesn't wait on it
+
+    pthread_mutex_unlock (&cacheLock) ;
+      analogReadMulti (pins, values, n) ;
+      now = nowNs () ;
+    pthread_mutex_lock (&cacheLock) ;
+
+    for (i = 0 ; i < n ; ++i)
+    {
+      if (due [i]->pin != pins [i])	// Removed while we were reading it
+	continue ;
+
+      writeBegin (due [i]) ;
+	due [i]->value = values [i] ;
+	due [i]->time  = now ;
+      writeEnd (due [i]) ;
+
+      due [i]->due += due [i]->period ;
+      if (due [i]->due <= now)
+	due [i]->due = now + due [i]->period ;
+    }
+  }
+
+  pthread_mutex_unlock (&cacheLock) ;
+
+  return NULL ;
+}
+
+
+/*
+ * analogCacheAdd:
+ *	Register pin to be read every periodMs, or change its period if
+ *	it's already registered. The first read happens straight away.
+ *	Returns 0 or -1.
+ *********************************************************************************
+ */
+
+int analogCacheAdd (int pin, int periodMs)
+{
+  struct analogCacheEntry *entry ;
+  pthread_condattr_t attr ;
+  int i ;
+
+  if (periodMs < 1)
+    return -1 ;
+
+  pthread_mutex_lock (&cacheLock) ;
+
+  if (!cacheInit)
+  {
+    for (i = 0 ; i < ANALOG_CACHE_MAX ; ++i)
+      cache [i].pin = -1 ;
+
+    pthread_condattr_init     (&attr) ;
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC) ;
+    pthread_cond_init         (&cacheCond, &attr) ;
+    pthread_condattr_destroy  (&attr) ;
+
+    cacheInit = TRUE ;
+  }
+
+  if ((entry = findEntry (pin)) == NULL)
+  {
+    if ((entry = findEntry (-1)) == NULL)
+    {
+      pthread_mutex_unlock (&cacheLock) ;
+      return wiringPiFailure (WPI_ALMOST, "analogCacheAdd: No free slots\n") ;
+    }
+
+    writeBegin (entry) ;
+      entry->value = 0 ;
+      entry->time  = 0 ;
+      __atomic_store_n (&entry->pin, pin, __ATOMIC_RELAXED) ;
+    writeEnd (entry) ;
+  }
+
+  entry->period = (long long)periodMs * 1000000LL ;
+  entry->due    = nowNs () ;
+
+  if (!cacheRunning)
+  {
+    cacheRunning = TRUE ;
+    if (pthread_create (&cacheThread, NULL, cacheWorker, NULL) != 0)
+    {
+      cacheRunning = FALSE ;
+      entry->pin   = -1 ;
+      pthread_mutex_unlock (&cacheLock) ;
+      return wiringPiFailure (WPI_ALMOST, "analogCacheAdd: Unable to start thread: %s\n", strerror (errno)) ;
+    }
+  }
+  else
+    pthread_cond_signal (&cacheCond) ;
+
+  pthread_mutex_unlock (&cacheLock) ;
+
+  return 0 ;
+}
+
+
+/*
+ * analogCacheRemove:
+ *	Stop refreshing pin. The worker keeps running, idle, for the next
+ *	one to be added.
+ *********************************************************************************
+ */
+
+void analogCacheRemove (int pin)
+{
+  struct analogCacheEntry *entry ;
+
+  if (!cacheInit)
+    return ;
+
+  pthread_mutex_lock (&cacheLock) ;
+    if ((entry = findEntry (pin)) != NULL)
+      __atomic_store_n (&entry->pin, -1, __ATOMIC_RELEASE) ;
+  pthread_mutex_unlock (&cacheLock) ;
+}
+
+
+/*
+ * analogCacheRead:
+ *	Get the latest value for pin, and optionally when it was read
+ *	(CLOCK_MONOTONIC, nS), without waiting on the bus or the worker.
+ *	Returns 0, or -1 if the pin isn't registered or hasn't been read yet.
+ *********************************************************************************
+ */
+
+int analogCacheRead (int pin, int *value, unsigned long long *time)
+{
+  struct analogCacheEntry *entry ;
+  unsigned int seq ;
+  unsigned long long t ;
+  int v, p ;
+
+  if (!cacheInit || ((entry = findEntry (pin)) == NULL))
+    return -1 ;
+
+// The slot may be handed to another pin after we found it, so check
+//	the pin again in the same snapshot as the value
+
+  do
+  {
+    while ((seq = __atomic_load_n (&entry->seq, __ATOMIC_ACQUIRE)) & 1)
+      ;
+    p = __atomic_load_n (&entry->pin, __ATOMIC_RELAXED) ;
+    v = entry->value ;
+    t = entry->time ;
+    __atomic_thread_fence (__ATOMIC_ACQUIRE) ;
+  } while (__atomic_load_n (&entry->seq, __ATOMIC_RELAXED) != seq) ;
+
+  if ((p != pin) || (t == 0))
+    return -1 ;
+
+  *value = v ;
+  if (time != NULL)
+    *time = t ;
+
+  return 0 ;
+}
@@ -0,0 +1,36 @@
+/*
+ * analogCache.h:
+ *	Keep the latest value of slow analog pins fresh in the background
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with wiringPi.
+ *    If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#define	ANALOG_CACHE_MAX	64	// Pins registered at once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int  analogCacheAdd    (int pin, int periodMs) ;
+extern void analogCacheRemove (int pin) ;
+extern int  analogCacheRead   (int pin, int *value, unsigned long long *time) ;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,412 @@
+/*
+ * analogStream.c:
+ *	Sample a list of analog pins at a fixed rate from a real-time thread
+ *	into a lock-free ring buffer - or play one out to a list of DACs.
+ *	The pins are read with analogReadMulti and written with
+ *	analogWriteMulti, so the SPI ADC and DAC drivers (mcp3002, mcp3004,
+ *	mcp4802, max5322, Gertboard) do each scan as one chained SPI message.
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with wiringPi.
+ *    If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "wiringPi.h"
+
+#include "analogStream.h"
+
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
+struct analogStream
+{
+  int       inUse ;
+  int       output ;		// Playing out to DACs rather than sampling
+  pthread_t thread ;
+  volatile int running ;
+
+  int       pins [ANALOG_STREAM_MAX_CHANS] ;
+  int       chans ;
+  struct wiringPiNodeStruct *node ;	// Set if all the pins are on one node
+  long long period ;			// nS
+
+// Single producer / single consumer ring. When sampling the thread is
+//	the producer, when playing out it's the consumer.
+
+  struct analogScan *ring ;
+  unsigned long      mask ;
+  unsigned long      head ;	// Written by the producer
+  unsigned long      tail ;	// Written by the consumer
+
+  unsigned long      scans, overruns, underruns, late ;
+  unsigned long long start, last ;
+  unsigned long long errSum, errMax ;	// How long after each deadline we did the transfer
+} ;
+
+static struct analogStream streams [ANALOG_STREAM_MAX] ;
+static pthread_mutex_t streamLock = PTHREAD_MUTEX_INITIALIZER ;
+
+
+/*
+ * nowNs: addNs:
+ *********************************************************************************
+ */
+
+static unsigned long long nowNs (void)
+{
+  struct timespec ts ;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts) ;
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec ;
+}
+
+static void addNs (struct timespec *ts, long long ns)
+{
+  ns += ts->tv_nsec ;
+  ts->tv_sec  += ns / 1000000000LL ;
+  ts->tv_nsec  = ns % 1000000000LL ;
+}
+
+
+/*
+ * sampleScan: playScan:
+ *	One tick of the stream thread in each direction
+ *********************************************************************************
+ */
+
+static int sampleScan (struct analogStream *s)
+{
+  struct analogScan *scan, discard ;
+  unsigned long head ;
+  int full ;
+
+  head = s->head ;
+  full = (head - __atomic_load_n (&s->tail, __ATOMIC_ACQUIRE)) > s->mask ;
+
+// Still sample when the buffer is full, to keep the timing honest
+
+  scan = full ? &discard : &s->ring [head & s->mask] ;
+
+  scan->time = nowNs () ;
+  if (s->node != NULL)
+    s->node->analogReadMulti (s->node, s->pins, scan->values, s->chans) ;
+  else
+    analogReadMulti (s->pins, scan->values, s->chans) ;
+
+  if (full)
+    ++s->overruns ;
+  else
+    __atomic_store_n (&s->head, head + 1, __ATOMIC_RELEASE) ;
+
+  s->last = scan->time ;
+
+  return TRUE ;
+}
+
+static int playScan (struct analogStream *s)
+{
+  struct analogScan *scan ;
+  unsigned long head, tail ;
+
+// Nothing queued: leave the DACs where they are. It's only an underrun
+//	once the first scan has been queued.
+
+  tail = s->tail ;
+  head = __atomic_load_n (&s->head, __ATOMIC_ACQUIRE) ;
+  if (tail == head)
+  {
+    if (head != 0)
+      ++s->underruns ;
+    return FALSE ;
+  }
+
+  scan = &s->ring [tail & s->mask] ;
+
+  s->last = nowNs () ;
+  if (s->node != NULL)
+    s->node->analogWriteMulti (s->node, s->pins, scan->values, s->chans) ;
+  else
+    analogWriteMulti (s->pins, scan->values, s->chans) ;
+
+  __atomic_store_n (&s->tail, tail + 1, __ATOMIC_RELEASE) ;
+
+  return TRUE ;
+}
+
+
+/*
+ * streamThread:
+ *	Sleep to each absolute deadline in turn and do a scan. If we
+ *	fall behind by more than a period we skip ahead rather than
+ *	bunching scans up, and count the scan times missed.
+ *********************************************************************************
+ */
+
+static void *streamThread (void *arg)
+{
+  struct analogStream *s = (struct analogStream *)arg ;
+  struct timespec next ;
+  unsigned long long deadline, now, error ;
+  long long behind ;
+  int done ;
+
+  (void)piHiPri (50) ;	// Only effective if we run as root
+
+  clock_gettime (CLOCK_MONOTONIC, &next) ;
+  s->start = (unsigned long long)next.tv_sec * 1000000000ULL + next.tv_nsec ;
+  deadline = s->start ;
+
+  while (s->running)
+  {
+    while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+      ;
+
+    done = s->output ? playScan (s) : sampleScan (s) ;
+
+    if (done && (s->scans++ == 0))
+      s->start = s->last ;		// Rate is from the first transfer
+    if (done && (s->last > deadline))
+    {
+      error      = s->last - deadline ;
+      s->errSum += error ;
+      if (error > s->errMax)
+	s->errMax = error ;
+    }
+
+    addNs (&next, s->period) ;
+
+    now      = nowNs () ;
+    deadline = (unsigned long long)next.tv_sec * 1000000000ULL + next.tv_nsec ;
+    if (now > deadline)
+    {
+      behind   = (now - deadline) / s->period + 1 ;
+      s->late += behind ;
+      addNs (&next, behind * s->period) ;
+      deadline = (unsigned long long)next.tv_sec * 1000000000ULL + next.tv_nsec ;
+    }
+  }
+
+  return NULL ;
+}
+
+
+/*
+ * startStream:
+ *	Set up a stream on the given pins running rateHz times a second.
+ *	depth is the number of scans the buffer holds (rounded up to a
+ *	power of 2). Returns the stream number or -1.
+ *********************************************************************************
+ */
+
+static int startStream (const int *pins, int chans, int rateHz, int depth, int output)
+{
+  struct analogStream *s = NULL ;
+  struct wiringPiNodeStruct *node ;
+  int i, stream ;
+  unsigned long size ;
+
+  if ((chans < 1) || (chans > ANALOG_STREAM_MAX_CHANS) || (rateHz < 1) || (depth < 1))
+    return -1 ;
+
+  pthread_mutex_lock (&streamLock) ;
+    for (stream = 0 ; stream < ANALOG_STREAM_MAX ; ++stream)
+      if (!streams [stream].inUse)
+      {
+	s = &streams [stream] ;
+	memset (s, 0, sizeof (*s)) ;
+	s->inUse = TRUE ;
+	break ;
+      }
+  pthread_mutex_unlock (&streamLock) ;
+
+  if (s == NULL)
+    return wiringPiFailure (WPI_ALMOST, "analogStreamStart: No free streams\n") ;
+
+  for (size = 1 ; size < (unsigned long)depth ; size <<= 1)
+    ;
+
+  if ((s->ring = (struct analogScan *)calloc (size, sizeof (struct analogScan))) == NULL)
+  {
+    s->inUse = FALSE ;
+    return wiringPiFailure (WPI_ALMOST, "analogStreamStart: Unable to allocate memory: %s\n", strerror (errno)) ;
+  }
+
+  s->output = output ;
+  s->mask   = size - 1 ;
+  s->chans  = chans ;
+  s->period = 1000000000LL / rateHz ;
+
+// Skip the node lookup on every scan when we can
+
+  node = wiringPiFindNode (pins [0]) ;
+  for (i = 0 ; i < chans ; ++i)
+  {
+    s->pins [i] = pins [i] ;
+    if ((node != NULL) && ((pins [i] < node->pinBase) || (pins [i] > node->pinMax)))
+      node = NULL ;
+  }
+  s->node = node ;
+
+  s->running = TRUE ;
+  if (pthread_create (&s->thread, NULL, streamThread, s) != 0)
+  {
+    free (s->ring) ;
+    s->inUse = FALSE ;
+    return -1 ;
+  }
+
+  return stream ;
+}
+
+
+/*
+ * analogStreamStart: analogStreamStartOut:
+ *	Start sampling the given pins, or playing out to them. Queue the
+ *	scans to play with analogStreamWrite (); playback starts on the
+ *	first sample time after the first scan is queued.
+ *********************************************************************************
+ */
+
+int analogStreamStart (const int *pins, int chans, int rateHz, int depth)
+{
+  return startStream (pins, chans, rateHz, depth, FALSE) ;
+}
+
+int analogStreamStartOut (const int *pins, int chans, int rateHz, int depth)
+{
+  return startStream (pins, chans, rateHz, depth, TRUE) ;
+}
+
+
+/*
+ * analogStreamRead:
+ *	Take up to max scans from the buffer without blocking. Returns the
+ *	number taken.
+ *********************************************************************************
+ */
+
+int analogStreamRead (int stream, struct analogScan *scans, int max)
+{
+  struct analogStream *s ;
+  unsigned long head, tail ;
+  int n = 0 ;
+
+  if ((stream < 0) || (stream >= ANALOG_STREAM_MAX) || !streams [stream].inUse || streams [stream].output)
+    return -1 ;
+
+  s    = &streams [stream] ;
+  head = __atomic_load_n (&s->head, __ATOMIC_ACQUIRE) ;
+  tail = s->tail ;
+
+  while ((tail != head) && (n < max))
+    scans [n++] = s->ring [tail++ & s->mask] ;
+
+  __atomic_store_n (&s->tail, tail, __ATOMIC_RELEASE) ;
+
+  return n ;
+}
+
+
+/*
+ * analogStreamWrite:
+ *	Queue up to count scans for an output stream without blocking - the
+ *	time field is ignored. Returns the number queued; the rest didn't fit.
+ *********************************************************************************
+ */
+
+int analogStreamWrite (int stream, const struct analogScan *scans, int count)
+{
+  struct analogStream *s ;
+  unsigned long head, tail ;
+  int n = 0 ;
+
+  if ((stream < 0) || (stream >= ANALOG_STREAM_MAX) || !streams [stream].inUse || !streams [stream].output)
+    return -1 ;
+
+  s    = &streams [stream] ;
+  tail = __atomic_load_n (&s->tail, __ATOMIC_ACQUIRE) ;
+  head = s->head ;
+
+  while (((head - tail) <= s->mask) && (n < count))
+    s->ring [head++ & s->mask] = scans [n++] ;
+
+  __atomic_store_n (&s->head, head, __ATOMIC_RELEASE) ;
+
+  return n ;
+}
+
+
+/*
+ * analogStreamStats:
+ *********************************************************************************
+ */
+
+int analogStreamStats (int stream, struct analogStreamStats *stats)
+{
+  struct analogStream *s ;
+
+  if ((stream < 0) || (stream >= ANALOG_STREAM_MAX) || !streams [stream].inUse)
+    return -1 ;
+
+  s = &streams [stream] ;
+
+  stats->scans     = s->scans ;
+  stats->overruns  = s->overruns ;
+  stats->underruns = s->underruns ;
+  stats->late      = s->late ;
+  stats->maxError  = (double)s->errMax / 1000.0 ;
+  stats->meanError = (s->scans > 0) ? (double)s->errSum / 1000.0 / (double)s->scans : 0.0 ;
+
+  if ((s->scans > 1) && (s->last > s->start))
+    stats->rate = (double)(s->scans - 1) * 1.0e9 / (double)(s->last - s->start) ;
+  else
+    stats->rate = 0.0 ;
+
+  return 0 ;
+}
+
+
+/*
+ * analogStreamStop:
+ *********************************************************************************
+ */
+
+void analogStreamStop (int stream)
+{
+  struct analogStream *s ;
+
+  if ((stream < 0) || (stream >= ANALOG_STREAM_MAX) || !streams [stream].inUse)
+    return ;
+
+  s = &streams [stream] ;
+
+  s->running = FALSE ;
+  pthread_join (s->thread, NULL) ;
+
+  free (s->ring) ;
+  s->ring  = NULL ;
+  s->inUse = FALSE ;
+}
@@ -0,0 +1,64 @@
+/*
+ * analogStream.h:
+ *	Sample a list of analog pins, or play out to them, at a fixed rate
+ *	from a real-time thread
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with wiringPi.
+ *    If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#define	ANALOG_STREAM_MAX		4	// Streams open at once
+#define	ANALOG_STREAM_MAX_CHANS		8	// Pins per stream
+
+// analogScan:
+//	One pass over the pin list. time is when it was sampled, and is
+//	ignored when playing out.
+
+struct analogScan
+{
+  unsigned long long time ;			// CLOCK_MONOTONIC, nS
+  int                values [ANALOG_STREAM_MAX_CHANS] ;
+} ;
+
+// analogStreamStats:
+
+struct analogStreamStats
+{
+  unsigned long scans ;		// Taken or played
+  unsigned long overruns ;	// Dropped because the buffer was full
+  unsigned long underruns ;	// Play times with nothing queued
+  unsigned long late ;		// Sample times missed because we ran late
+  double        rate ;		// Achieved scans/sec
+  double        meanError ;	// uS from each sample time to the transfer
+  double        maxError ;	//  ditto, worst case
+} ;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int  analogStreamStart    (const int *pins, int chans, int rateHz, int depth) ;
+extern int  analogStreamStartOut (const int *pins, int chans, int rateHz, int depth) ;
+extern int  analogStreamRead     (int stream, struct analogScan *scans, int max) ;
+extern int  analogStreamWrite    (int stream, const struct analogScan *scans, int count) ;
+extern int  analogStreamStats    (int stream, struct analogStreamStats *stats) ;
+extern void analogStreamStop     (int stream) ;
+
+#ifdef __cplusplus
+}
+#endif
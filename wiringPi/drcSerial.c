@@ -23,9 +23,13 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <time.h>
 #include <string.h>
 #include <errno.h>
+#include <poll.h>
+#include <termios.h>
 
 #include "wiringPi.h"
 #include "wiringSerial.h"
@@ -37,6 +41,126 @@
 #  define	FALSE	(1==2)
 #endif
 
+// How long to wait for a reply before giving up, mS
+
+#define	DRC_TIMEOUT	1000
+
+// Reads sent before we collect their replies. Each is a 2 byte command
+//	and an analog one has a 2 byte reply, so 16 keeps both directions
+//	at half the ATmega's 64 byte serial buffer.
+
+#define	DRC_PIPELINE	16
+
+// drcState:
+//	Hung off node->extra. Commands are built up here and sent with one
+//	write () - at the end of each call, before we wait for a reply, or
+//	at wiringPiCommit () when inside a wiringPiBegin ().
+
+struct drcState
+{
+  unsigned char tx [256] ;
+  int           txLen ;
+} ;
+
+
+/*
+ * drcFlush:
+ *	Send the queued commands
+ *********************************************************************************
+ */
+
+static void drcFlush (struct wiringPiNodeStruct *node)
+{
+  struct drcState *state = (struct drcState *)node->extra ;
+  unsigned char *ptr = state->tx ;
+  int left = state->txLen ;
+  int n ;
+
+  while (left > 0)
+  {
+    if ((n = write (node->fd, ptr, left)) < 0)
+    {
+      if (errno == EINTR)
+	continue ;
+      break ;
+    }
+    ptr  += n ;
+    left -= n ;
+  }
+
+  state->txLen = 0 ;
+  node->dirty  = FALSE ;
+}
+
+
+/*
+ * drcQueue: drcDone:
+ *	Add a command to the queue, and send it unless we're deferring
+ *********************************************************************************
+ */
+
+static void drcQueue (struct wiringPiNodeStruct *node, int cmd, int pin)
+{
+  struct drcState *state = (struct drcState *)node->extra ;
+
+  if (state->txLen > (int)sizeof (state->tx) - 3)
+    drcFlush (node) ;
+
+  state->tx [state->txLen++] = cmd ;
+  state->tx [state->txLen++] = pin - node->pinBase ;
+}
+
+static void drcDone (struct wiringPiNodeStruct *node)
+{
+  if (node->deferred)
+    node->dirty = TRUE ;
+  else
+    drcFlush (node) ;
+}
+
+
+/*
+ * drcReply:
+ *	Collect len bytes of reply. Returns FALSE if the device goes quiet,
+ *	throwing away anything partial so a late reply isn't taken as the
+ *	answer to the next request.
+ *********************************************************************************
+ */
+
+static int drcReply (struct wiringPiNodeStruct *node, unsigned char *buf, int len)
+{
+  struct pollfd pfd ;
+  int n ;
+
+  pfd.fd     = node->fd ;
+  pfd.events = POLLIN ;
+
+  while (len > 0)
+  {
+    if ((n = poll (&pfd, 1, DRC_TIMEOUT)) < 0)
+    {
+      if (errno == EINTR)
+	continue ;
+      return FALSE ;
+    }
+    if (n == 0)
+    {
+      tcflush (node->fd, TCIFLUSH) ;
+      return FALSE ;
+    }
+    if ((n = read (node->fd, buf, len)) <= 0)
+    {
+      if ((n < 0) && (errno == EINTR))
+	continue ;
+      return FALSE ;
+    }
+    buf += n ;
+    len -= n ;
+  }
+
+  return TRUE ;
+}
+
 
 /*
  * myPinMode:
@@ -47,13 +171,13 @@
 static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
 {
   /**/ if (mode == OUTPUT)
-    serialPutchar (node->fd, 'o') ;       // Input
+    drcQueue (node, 'o', pin) ;       // Output
   else if (mode == PWM_OUTPUT)
-    serialPutchar (node->fd, 'p') ;       // PWM
+    drcQueue (node, 'p', pin) ;       // PWM
   else
-    serialPutchar (node->fd, 'i') ;       // Default to input
+    drcQueue (node, 'i', pin) ;       // Default to input
 
-  serialPutchar (node->fd, pin - node->pinBase) ;
+  drcDone (node) ;
 }
 
 
@@ -68,31 +192,48 @@ static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mod
 
 // Force pin into input mode
 
-  serialPutchar (node->fd, 'i' ) ;
-  serialPutchar (node->fd, pin - node->pinBase) ;
+  drcQueue (node, 'i', pin) ;
 
   /**/ if (mode == PUD_UP)
-  {
-    serialPutchar (node->fd, '1') ;
-    serialPutchar (node->fd, pin - node->pinBase) ;
-  }
+    drcQueue (node, '1', pin) ;
   else if (mode == PUD_OFF)
-  {
-    serialPutchar (node->fd, '0') ;
-    serialPutchar (node->fd, pin - node->pinBase) ;
-  }
+    drcQueue (node, '0', pin) ;
+
+  drcDone (node) ;
 }
 
 
 /*
- * myDigitalWrite:
+ * myDigitalWrite: myDigitalWriteMulti: myDigitalWritePort:
+ *	The multi-pin versions send all their commands in one write ()
  *********************************************************************************
  */
 
 static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
 {
-  serialPutchar (node->fd, value == 0 ? '0' : '1') ;
-  serialPutchar (node->fd, pin - node->pinBase) ;
+  drcQueue (node, value == 0 ? '0' : '1', pin) ;
+  drcDone  (node) ;
+}
+
+static void myDigitalWriteMulti (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count)
+{
+  int i ;
+
+  for (i = 0 ; i < count ; ++i)
+    drcQueue (node, values [i] == 0 ? '0' : '1', pins [i]) ;
+
+  drcDone (node) ;
+}
+
+static void myDigitalWritePort (struct wiringPiNodeStruct *node, unsigned int value, unsigned int mask)
+{
+  int pin ;
+
+  for (pin = 0 ; (pin <= node->pinMax - node->pinBase) && (pin < 32) ; ++pin)
+    if (mask & (1 << pin))
+      drcQueue (node, (value & (1 << pin)) ? '1' : '0', node->pinBase + pin) ;
+
+  drcDone (node) ;
 }
 
 
@@ -103,40 +244,137 @@ static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
 
 static void myPwmWrite (struct wiringPiNodeStruct *node, int pin, int value)
 {
-  serialPutchar (node->fd, 'v') ;
-  serialPutchar (node->fd, pin - node->pinBase) ;
-  serialPutchar (node->fd, value & 0xFF) ;
+  struct drcState *state ;
+
+  drcQueue (node, 'v', pin) ;
+
+  state = (struct drcState *)node->extra ;
+  state->tx [state->txLen++] = value & 0xFF ;	// drcQueue leaves room
+
+  drcDone (node) ;
 }
 
 
 /*
- * myAnalogRead:
+ * myAnalogRead: myAnalogReadMulti:
+ *	The multi version pipelines the requests: it sends a batch in one
+ *	write () and then collects all their replies, in order, rather than
+ *	waiting a round trip for each.
  *********************************************************************************
  */
 
 static int myAnalogRead (struct wiringPiNodeStruct *node, int pin)
 {
-  int vHi, vLo ;
+  unsigned char reply [2] ;
 
-  serialPutchar (node->fd, 'a') ;
-  serialPutchar (node->fd, pin - node->pinBase) ;
-  vHi = serialGetchar (node->fd) ;
-  vLo = serialGetchar (node->fd) ;
+  drcQueue (node, 'a', pin) ;
+  drcFlush (node) ;
 
-  return (vHi << 8) | vLo ;
+  if (!drcReply (node, reply, 2))
+    return 0 ;
+
+  return (reply [0] << 8) | reply [1] ;
+}
+
+static void myAnalogReadMulti (struct wiringPiNodeStruct *node, const int *pins, int *values, int count)
+{
+  unsigned char reply [2 * DRC_PIPELINE] ;
+  int i, n, ok ;
+
+  while (count > 0)
+  {
+    n = (count > DRC_PIPELINE) ? DRC_PIPELINE : count ;
+
+    for (i = 0 ; i < n ; ++i)
+      drcQueue (node, 'a', pins [i]) ;
+    drcFlush (node) ;
+
+    ok = drcReply (node, reply, 2 * n) ;
+    for (i = 0 ; i < n ; ++i)
+      values [i] = ok ? ((reply [i * 2] << 8) | reply [i * 2 + 1]) : 0 ;
+
+    pins   += n ;
+    values += n ;
+    count  -= n ;
+  }
 }
 
 
 /*
- * myDigitalRead:
+ * myDigitalRead: myDigitalReadMulti: myDigitalReadPort:
+ *	As above
  *********************************************************************************
  */
 
 static int myDigitalRead (struct wiringPiNodeStruct *node, int pin)
 {
-  serialPutchar (node->fd, 'r') ; // Send read command
-  serialPutchar (node->fd, pin - node->pinBase) ;
-  return (serialGetchar (node->fd) == '0') ? 0 : 1 ;
+  unsigned char reply ;
+
+  drcQueue (node, 'r', pin) ;	// Send read command
+  drcFlush (node) ;
+
+  if (!drcReply (node, &reply, 1))
+    return 0 ;
+
+  return (reply == '0') ? 0 : 1 ;
+}
+
+static void myDigitalReadMulti (struct wiringPiNodeStruct *node, const int *pins, int *values, int count)
+{
+  unsigned char reply [DRC_PIPELINE] ;
+  int i, n, ok ;
+
+  while (count > 0)
+  {
+    n = (count > DRC_PIPELINE) ? DRC_PIPELINE : count ;
+
+    for (i = 0 ; i < n ; ++i)
+      drcQueue (node, 'r', pins [i]) ;
+    drcFlush (node) ;
+
+    ok = drcReply (node, reply, n) ;
+    for (i = 0 ; i < n ; ++i)
+      values [i] = (ok && (reply [i] != '0')) ? 1 : 0 ;
+
+    pins   += n ;
+    values += n ;
+    count  -= n ;
+  }
+}
+
+static unsigned int myDigitalReadPort (struct wiringPiNodeStruct *node)
+{
+  int pins [32], values [32] ;
+  unsigned int value = 0 ;
+  int i, n ;
+
+  if ((n = node->pinMax - node->pinBase + 1) > 32)
+    n = 32 ;
+  else if (n < 1)
+    return 0 ;
+
+  for (i = 0 ; i < n ; ++i)
+    pins [i] = node->pinBase + i ;
+
+  myDigitalReadMulti (node, pins, values, n) ;
+
+  for (i = 0 ; i < n ; ++i)
+    if (values [i])
+      value |= 1 << i ;
+
+  return value ;
+}
+
+
+/*
+ * myCommit:
+ *	Send what's been queued since wiringPiBegin ()
+ *********************************************************************************
+ */
+
+static void myCommit (struct wiringPiNodeStruct *node)
+{
+  drcFlush (node) ;
 }
 
 
@@ -154,6 +392,7 @@ int drcSetupSerial (const int pinBase, const int numPins, const char *device, co
   int ok, tries ;
   time_t then ;
   struct wiringPiNodeStruct *node ;
+  struct drcState *state ;
 
   if ((fd = serialOpen (device, baud)) < 0)
     return wiringPiFailure (WPI_ALMOST, "Unable to open DRC device (%s): %s", device, strerror (errno)) ;
@@ -187,15 +426,28 @@ int drcSetupSerial (const int pinBase, const int numPins, const char *device, co
     return wiringPiFailure (WPI_FATAL, "Unable to communicate with DRC serial device") ;
   }
 
+  if ((state = (struct drcState *)calloc (1, sizeof (struct drcState))) == NULL)
+  {
+    serialClose (fd) ;
+    return wiringPiFailure (WPI_ALMOST, "Unable to allocate memory: %s", strerror (errno)) ;
+  }
+
   node = wiringPiNewNode (pinBase, numPins) ;
 
-  node->fd              = fd ;
-  node->pinMode         = myPinMode ;
-  node->pullUpDnControl = myPullUpDnControl ;
-  node->analogRead      = myAnalogRead ;
-  node->digitalRead     = myDigitalRead ;
-  node->digitalWrite    = myDigitalWrite ;
-  node->pwmWrite        = myPwmWrite ;
+  node->fd                = fd ;
+  node->extra             = state ;
+  node->pinMode           = myPinMode ;
+  node->pullUpDnControl   = myPullUpDnControl ;
+  node->analogRead        = myAnalogRead ;
+  node->analogReadMulti   = myAnalogReadMulti ;
+  node->digitalRead       = myDigitalRead ;
+  node->digitalReadMulti  = myDigitalReadMulti ;
+  node->digitalReadPort   = myDigitalReadPort ;
+  node->digitalWrite      = myDigitalWrite ;
+  node->digitalWriteMulti = myDigitalWriteMulti ;
+  node->digitalWritePort  = myDigitalWritePort ;
+  node->pwmWrite          = myPwmWrite ;
+  node->commit            = myCommit ;
 
   return 0 ;
 }
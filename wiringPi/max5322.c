@@ -53,6 +53,36 @@ static void myAnalogWrite (struct wiringPiNodeStruct *node, int pin, int value)
   wiringPiSPIDataRW (node->fd, spiData, 2) ;
 }
 
+/*
+ * myAnalogWriteMulti:
+ *	Write a list of values, one chained SPI message per 16 - the DAC
+ *	latches each one as its chip select goes high.
+ *********************************************************************************
+ */
+
+static void myAnalogWriteMulti (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count)
+{
+  unsigned char spiData [2 * 16] ;
+  int i, n ;
+
+  while (count > 0)
+  {
+    n = (count > 16) ? 16 : count ;
+
+    for (i = 0 ; i < n ; ++i)
+    {
+      spiData [i * 2 + 0] = ((pins [i] == node->pinBase) ? 0b01000000 : 0b01010000) | ((values [i] >> 12) & 0x0F) ;
+      spiData [i * 2 + 1] = (values [i] & 0xFF) ;
+    }
+
+    wiringPiSPIDataRWChain (node->fd, spiData, 2, n) ;
+
+    pins   += n ;
+    values += n ;
+    count  -= n ;
+  }
+}
+
 /*
  * max5322Setup:
  *	Create a new wiringPi device node for an max5322 on the Pi's
@@ -71,7 +101,8 @@ int max5322Setup (const int pinBase, int spiChannel)
   node = wiringPiNewNode (pinBase, 2) ;
 
   node->fd          = spiChannel ;
-  node->analogWrite = myAnalogWrite ;
+  node->analogWrite      = myAnalogWrite ;
+  node->analogWriteMulti = myAnalogWriteMulti ;
 
 // Enable both DACs
 
@@ -28,52 +28,59 @@
 #include "wiringPi.h"
 #include "wiringPiI2C.h"
 #include "mcp23x0817.h"
+#include "mcp23x.h"
 
 #include "mcp23008.h"
 
 
 /*
- * myPinMode:
+ * readReg: writeReg:
+ *	Register access for the cache
  *********************************************************************************
  */
 
-static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
+static int readReg (struct wiringPiNodeStruct *node, int reg)
 {
-  int mask, old, reg ;
+  return wiringPiI2CReadReg8 (node->fd, reg) ;
+}
 
-  reg  = MCP23x08_IODIR ;
-  mask = 1 << (pin - node->pinBase) ;
-  old  = wiringPiI2CReadReg8 (node->fd, reg) ;
+static void writeReg (struct wiringPiNodeStruct *node, int reg, int value)
+{
+  wiringPiI2CWriteReg8 (node->fd, reg, value) ;
+}
 
-  if (mode == OUTPUT)
-    old &= (~mask) ;
-  else
-    old |=   mask ;
+static int readRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  return wiringPiI2CReadBlock (node->fd, reg, data, len) ;
+}
 
-  wiringPiI2CWriteReg8 (node->fd, reg, old) ;
+static int writeRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  return wiringPiI2CWriteBlock (node->fd, reg, data, len) ;
 }
 
 
 /*
- * myPullUpDnControl:
+ * myPinMode:
+ *	The direction, pull-up and output latch registers are all cached,
+ *	so each of these is a single write to the device.
  *********************************************************************************
  */
 
-static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mode)
+static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
 {
-  int mask, old, reg ;
-
-  reg  = MCP23x08_GPPU ;
-  mask = 1 << (pin - node->pinBase) ;
+  mcp23xUpdateBit (node, MCP23x08_IODIR, pin - node->pinBase, mode != OUTPUT) ;
+}
 
-  old  = wiringPiI2CReadReg8 (node->fd, reg) ;
 
-  if (mode == PUD_UP)
-    old |=   mask ;
-  else
-    old &= (~mask) ;
+/*
+ * myPullUpDnControl:
+ *********************************************************************************
+ */
 
-  wiringPiI2CWriteReg8 (node->fd, reg, old) ;
+static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mode)
+{
+  mcp23xUpdateBit (node, MCP23x08_GPPU, pin - node->pinBase, mode == PUD_UP) ;
 }
 
 
@@ -84,18 +91,7 @@ static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mod
 
 static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
 {
-  int bit, old ;
-
-  bit  = 1 << ((pin - node->pinBase) & 7) ;
-
-  old = node->data2 ;
-  if (value == LOW)
-    old &= (~bit) ;
-  else
-    old |=   bit ;
-
-  wiringPiI2CWriteReg8 (node->fd, MCP23x08_GPIO, old) ;
-  node->data2 = old ;
+  mcp23xUpdateBit (node, MCP23x08_OLAT, pin - node->pinBase, value != LOW) ;
 }
 
 
@@ -131,19 +127,25 @@ int mcp23008Setup (const int pinBase, const int i2cAddress)
   int fd ;
   struct wiringPiNodeStruct *node ;
 
-  if ((fd = wiringPiI2CSetup (i2cAddress)) < 0)
+  if ((fd = wiringPiI2CSetupShared (i2cAddress)) < 0)
     return fd ;
 
   wiringPiI2CWriteReg8 (fd, MCP23x08_IOCON, IOCON_INIT) ;
 
   node = wiringPiNewNode (pinBase, 8) ;
 
-  node->fd              = fd ;
-  node->pinMode         = myPinMode ;
-  node->pullUpDnControl = myPullUpDnControl ;
-  node->digitalRead     = myDigitalRead ;
-  node->digitalWrite    = myDigitalWrite ;
-  node->data2           = wiringPiI2CReadReg8 (fd, MCP23x08_OLAT) ;
+  node->fd                = fd ;
+  node->pinMode           = myPinMode ;
+  node->pullUpDnControl   = myPullUpDnControl ;
+  node->digitalRead       = myDigitalRead ;
+  node->digitalWrite      = myDigitalWrite ;
+  node->digitalReadPort   = mcp23xReadPort ;
+  node->digitalWritePort  = mcp23xWritePort ;
+  node->digitalReadMulti  = wiringPiNodeReadMultiPort ;
+  node->digitalWriteMulti = wiringPiNodeWriteMultiPort ;
+  node->commit            = mcp23xCommit ;
+
+  mcp23xNew (node, 1, readReg, writeReg, readRegs, writeRegs) ;
 
   return 0 ;
 }
@@ -28,38 +28,48 @@
 #include "wiringPi.h"
 #include "wiringPiI2C.h"
 #include "mcp23x0817.h"
+#include "mcp23x.h"
 
 #include "mcp23017.h"
 
 
 /*
- * myPinMode:
+ * readReg: writeReg:
+ *	Register access for the cache
  *********************************************************************************
  */
 
-static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
+static int readReg (struct wiringPiNodeStruct *node, int reg)
 {
-  int mask, old, reg ;
+  return wiringPiI2CReadReg8 (node->fd, reg) ;
+}
 
-  pin -= node->pinBase ;
+static void writeReg (struct wiringPiNodeStruct *node, int reg, int value)
+{
+  wiringPiI2CWriteReg8 (node->fd, reg, value) ;
+}
 
-  if (pin < 8)		// Bank A
-    reg  = MCP23x17_IODIRA ;
-  else
-  {
-    reg  = MCP23x17_IODIRB ;
-    pin &= 0x07 ;
-  }
+static int readRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  return wiringPiI2CReadBlock (node->fd, reg, data, len) ;
+}
 
-  mask = 1 << pin ;
-  old  = wiringPiI2CReadReg8 (node->fd, reg) ;
+static int writeRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  return wiringPiI2CWriteBlock (node->fd, reg, data, len) ;
+}
 
-  if (mode == OUTPUT)
-    old &= (~mask) ;
-  else
-    old |=   mask ;
 
-  wiringPiI2CWriteReg8 (node->fd, reg, old) ;
+/*
+ * myPinMode:
+ *	The direction, pull-up and output latch registers are all cached,
+ *	so each of these is a single write to the device.
+ *********************************************************************************
+ */
+
+static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
+{
+  mcp23xUpdateBit (node, MCP23x08_IODIR, pin - node->pinBase, mode != OUTPUT) ;
 }
 
 
@@ -70,27 +80,7 @@ static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
 
 static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mode)
 {
-  int mask, old, reg ;
-
-  pin -= node->pinBase ;
-
-  if (pin < 8)		// Bank A
-    reg  = MCP23x17_GPPUA ;
-  else
-  {
-    reg  = MCP23x17_GPPUB ;
-    pin &= 0x07 ;
-  }
-
-  mask = 1 << pin ;
-  old  = wiringPiI2CReadReg8 (node->fd, reg) ;
-
-  if (mode == PUD_UP)
-    old |=   mask ;
-  else
-    old &= (~mask) ;
-
-  wiringPiI2CWriteReg8 (node->fd, reg, old) ;
+  mcp23xUpdateBit (node, MCP23x08_GPPU, pin - node->pinBase, mode == PUD_UP) ;
 }
 
 
@@ -101,36 +91,7 @@ static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mod
 
 static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
 {
-  int bit, old ;
-
-  pin -= node->pinBase ;	// Pin now 0-15
-
-  bit = 1 << (pin & 7) ;
-
-  if (pin < 8)			// Bank A
-  {
-    old = node->data2 ;
-
-    if (value == LOW)
-      old &= (~bit) ;
-    else
-      old |=   bit ;
-
-    wiringPiI2CWriteReg8 (node->fd, MCP23x17_GPIOA, old) ;
-    node->data2 = old ;
-  }
-  else				// Bank B
-  {
-    old = node->data3 ;
-
-    if (value == LOW)
-      old &= (~bit) ;
-    else
-      old |=   bit ;
-
-    wiringPiI2CWriteReg8 (node->fd, MCP23x17_GPIOB, old) ;
-    node->data3 = old ;
-  }
+  mcp23xUpdateBit (node, MCP23x08_OLAT, pin - node->pinBase, value != LOW) ;
 }
 
 
@@ -176,20 +137,25 @@ int mcp23017Setup (const int pinBase, const int i2cAddress)
   int fd ;
   struct wiringPiNodeStruct *node ;
 
-  if ((fd = wiringPiI2CSetup (i2cAddress)) < 0)
+  if ((fd = wiringPiI2CSetupShared (i2cAddress)) < 0)
     return fd ;
 
   wiringPiI2CWriteReg8 (fd, MCP23x17_IOCON, IOCON_INIT) ;
 
   node = wiringPiNewNode (pinBase, 16) ;
 
-  node->fd              = fd ;
-  node->pinMode         = myPinMode ;
-  node->pullUpDnControl = myPullUpDnControl ;
-  node->digitalRead     = myDigitalRead ;
-  node->digitalWrite    = myDigitalWrite ;
-  node->data2           = wiringPiI2CReadReg8 (fd, MCP23x17_OLATA) ;
-  node->data3           = wiringPiI2CReadReg8 (fd, MCP23x17_OLATB) ;
+  node->fd                = fd ;
+  node->pinMode           = myPinMode ;
+  node->pullUpDnControl   = myPullUpDnControl ;
+  node->digitalRead       = myDigitalRead ;
+  node->digitalWrite      = myDigitalWrite ;
+  node->digitalReadPort   = mcp23xReadPort ;
+  node->digitalWritePort  = mcp23xWritePort ;
+  node->digitalReadMulti  = wiringPiNodeReadMultiPort ;
+  node->digitalWriteMulti = wiringPiNodeWriteMultiPort ;
+  node->commit            = mcp23xCommit ;
+
+  mcp23xNew (node, 2, readReg, writeReg, readRegs, writeRegs) ;
 
   return 0 ;
 }
@@ -24,10 +24,12 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "wiringPi.h"
 #include "wiringPiSPI.h"
 #include "mcp23x0817.h"
+#include "mcp23x.h"
 
 #include "mcp23s08.h"
 
@@ -72,69 +74,107 @@ static uint8_t readByte (uint8_t spiPort, uint8_t devId, uint8_t reg)
 
 
 /*
- * myPinMode:
+ * writeBytes: readBytes:
+ *	Transfer a run of consecutive registers in one SPI frame. Relies on
+ *	the chip's sequential addressing mode.
  *********************************************************************************
  */
 
-static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
+static int writeBytes (uint8_t spiPort, uint8_t devId, uint8_t reg, uint8_t *data, int len)
 {
-  int mask, old, reg ;
+  uint8_t spiData [2 + MCP23X_REGS * 2] ;
+
+  if (len > MCP23X_REGS * 2)
+    return -1 ;
 
-  reg  = MCP23x08_IODIR ;
-  mask = 1 << (pin - node->pinBase) ;
-  old  = readByte (node->data0, node->data1, reg) ;
+  spiData [0] = CMD_WRITE | ((devId & 7) << 1) ;
+  spiData [1] = reg ;
+  memcpy (&spiData [2], data, len) ;
 
-  if (mode == OUTPUT)
-    old &= (~mask) ;
-  else
-    old |=   mask ;
+  if (wiringPiSPIDataRW (spiPort, spiData, len + 2) < 0)
+    return -1 ;
 
-  writeByte (node->data0, node->data1, reg, old) ;
+  return len ;
+}
+
+static int readBytes (uint8_t spiPort, uint8_t devId, uint8_t reg, uint8_t *data, int len)
+{
+  uint8_t spiData [2 + MCP23X_REGS * 2] ;
+
+  if (len > MCP23X_REGS * 2)
+    return -1 ;
+
+  memset (spiData, 0, sizeof (spiData)) ;
+  spiData [0] = CMD_READ | ((devId & 7) << 1) ;
+  spiData [1] = reg ;
+
+  if (wiringPiSPIDataRW (spiPort, spiData, len + 2) < 0)
+    return -1 ;
+
+  memcpy (data, &spiData [2], len) ;
+  return len ;
 }
 
 
 /*
- * myPullUpDnControl:
+ * readReg: writeReg:
+ *	Register access for the cache
  *********************************************************************************
  */
 
-static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mode)
+static int readReg (struct wiringPiNodeStruct *node, int reg)
+{
+  return readByte (node->data0, node->data1, reg) ;
+}
+
+static void writeReg (struct wiringPiNodeStruct *node, int reg, int value)
+{
+  writeByte (node->data0, node->data1, reg, value) ;
+}
+
+static int readRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
 {
-  int mask, old, reg ;
+  return readBytes (node->data0, node->data1, reg, data, len) ;
+}
 
-  reg  = MCP23x08_GPPU ;
-  mask = 1 << (pin - node->pinBase) ;
+static int writeRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  return writeBytes (node->data0, node->data1, reg, data, len) ;
+}
 
-  old  = readByte (node->data0, node->data1, reg) ;
 
-  if (mode == PUD_UP)
-    old |=   mask ;
-  else
-    old &= (~mask) ;
+/*
+ * myPinMode:
+ *	The direction, pull-up and output latch registers are all cached,
+ *	so each of these is a single write to the device.
+ *********************************************************************************
+ */
 
-  writeByte (node->data0, node->data1, reg, old) ;
+static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
+{
+  mcp23xUpdateBit (node, MCP23x08_IODIR, pin - node->pinBase, mode != OUTPUT) ;
 }
 
 
 /*
- * myDigitalWrite:
+ * myPullUpDnControl:
  *********************************************************************************
  */
 
-static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
+static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mode)
 {
-  int bit, old ;
+  mcp23xUpdateBit (node, MCP23x08_GPPU, pin - node->pinBase, mode == PUD_UP) ;
+}
 
-  bit  = 1 << ((pin - node->pinBase) & 7) ;
 
-  old = node->data2 ;
-  if (value == LOW)
-    old &= (~bit) ;
-  else
-    old |=   bit ;
+/*
+ * myDigitalWrite:
+ *********************************************************************************
+ */
 
-  writeByte (node->data0, node->data1, MCP23x08_GPIO, old) ;
-  node->data2 = old ;
+static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
+{
+  mcp23xUpdateBit (node, MCP23x08_OLAT, pin - node->pinBase, value != LOW) ;
 }
 
 
@@ -177,13 +217,19 @@ int mcp23s08Setup (const int pinBase, const int spiPort, const int devId)
 
   node = wiringPiNewNode (pinBase, 8) ;
 
-  node->data0           = spiPort ;
-  node->data1           = devId ;
-  node->pinMode         = myPinMode ;
-  node->pullUpDnControl = myPullUpDnControl ;
-  node->digitalRead     = myDigitalRead ;
-  node->digitalWrite    = myDigitalWrite ;
-  node->data2           = readByte (spiPort, devId, MCP23x08_OLAT) ;
+  node->data0             = spiPort ;
+  node->data1             = devId ;
+  node->pinMode           = myPinMode ;
+  node->pullUpDnControl   = myPullUpDnControl ;
+  node->digitalRead       = myDigitalRead ;
+  node->digitalWrite      = myDigitalWrite ;
+  node->digitalReadPort   = mcp23xReadPort ;
+  node->digitalWritePort  = mcp23xWritePort ;
+  node->digitalReadMulti  = wiringPiNodeReadMultiPort ;
+  node->digitalWriteMulti = wiringPiNodeWriteMultiPort ;
+  node->commit            = mcp23xCommit ;
+
+  mcp23xNew (node, 1, readReg, writeReg, readRegs, writeRegs) ;
 
   return 0 ;
 }
@@ -24,10 +24,12 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "wiringPi.h"
 #include "wiringPiSPI.h"
 #include "mcp23x0817.h"
+#include "mcp23x.h"
 
 #include "mcp23s17.h"
 
@@ -72,104 +74,107 @@ static uint8_t readByte (uint8_t spiPort, uint8_t devId, uint8_t reg)
 
 
 /*
- * myPinMode:
+ * writeBytes: readBytes:
+ *	Transfer a run of consecutive registers in one SPI frame. Relies on
+ *	the chip's sequential addressing mode.
  *********************************************************************************
  */
 
-static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
+static int writeBytes (uint8_t spiPort, uint8_t devId, uint8_t reg, uint8_t *data, int len)
 {
-  int mask, old, reg ;
+  uint8_t spiData [2 + MCP23X_REGS * 2] ;
 
-  pin -= node->pinBase ;
+  if (len > MCP23X_REGS * 2)
+    return -1 ;
 
-  if (pin < 8)		// Bank A
-    reg  = MCP23x17_IODIRA ;
-  else
-  {
-    reg  = MCP23x17_IODIRB ;
-    pin &= 0x07 ;
-  }
+  spiData [0] = CMD_WRITE | ((devId & 7) << 1) ;
+  spiData [1] = reg ;
+  memcpy (&spiData [2], data, len) ;
 
-  mask = 1 << pin ;
-  old  = readByte (node->data0, node->data1, reg) ;
+  if (wiringPiSPIDataRW (spiPort, spiData, len + 2) < 0)
+    return -1 ;
 
-  if (mode == OUTPUT)
-    old &= (~mask) ;
-  else
-    old |=   mask ;
+  return len ;
+}
 
-  writeByte (node->data0, node->data1, reg, old) ;
+static int readBytes (uint8_t spiPort, uint8_t devId, uint8_t reg, uint8_t *data, int len)
+{
+  uint8_t spiData [2 + MCP23X_REGS * 2] ;
+
+  if (len > MCP23X_REGS * 2)
+    return -1 ;
+
+  memset (spiData, 0, sizeof (spiData)) ;
+  spiData [0] = CMD_READ | ((devId & 7) << 1) ;
+  spiData [1] = reg ;
+
+  if (wiringPiSPIDataRW (spiPort, spiData, len + 2) < 0)
+    return -1 ;
+
+  memcpy (data, &spiData [2], len) ;
+  return len ;
 }
 
 
 /*
- * myPullUpDnControl:
+ * readReg: writeReg:
+ *	Register access for the cache
  *********************************************************************************
  */
 
-static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mode)
+static int readReg (struct wiringPiNodeStruct *node, int reg)
 {
-  int mask, old, reg ;
-
-  pin -= node->pinBase ;
-
-  if (pin < 8)		// Bank A
-    reg  = MCP23x17_GPPUA ;
-  else
-  {
-    reg  = MCP23x17_GPPUB ;
-    pin &= 0x07 ;
-  }
+  return readByte (node->data0, node->data1, reg) ;
+}
 
-  mask = 1 << pin ;
-  old  = readByte (node->data0, node->data1, reg) ;
+static void writeReg (struct wiringPiNodeStruct *node, int reg, int value)
+{
+  writeByte (node->data0, node->data1, reg, value) ;
+}
 
-  if (mode == PUD_UP)
-    old |=   mask ;
-  else
-    old &= (~mask) ;
+static int readRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  return readBytes (node->data0, node->data1, reg, data, len) ;
+}
 
-  writeByte (node->data0, node->data1, reg, old) ;
+static int writeRegs (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)
+{
+  return writeBytes (node->data0, node->data1, reg, data, len) ;
 }
 
 
 /*
- * myDigitalWrite:
+ * myPinMode:
+ *	The direction, pull-up and output latch registers are all cached,
+ *	so each of these is a single write to the device.
  *********************************************************************************
  */
 
-static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
+static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
 {
-  int bit, old ;
-
-  pin -= node->pinBase ;	// Pin now 0-15
+  mcp23xUpdateBit (node, MCP23x08_IODIR, pin - node->pinBase, mode != OUTPUT) ;
+}
 
-  bit = 1 << (pin & 7) ;
 
-  if (pin < 8)			// Bank A
-  {
-    old = node->data2 ;
+/*
+ * myPullUpDnControl:
+ *********************************************************************************
+ */
 
-    if (value == LOW)
-      old &= (~bit) ;
-    else
-      old |=   bit ;
+static void myPullUpDnControl (struct wiringPiNodeStruct *node, int pin, int mode)
+{
+  mcp23xUpdateBit (node, MCP23x08_GPPU, pin - node->pinBase, mode == PUD_UP) ;
+}
 
-    writeByte (node->data0, node->data1, MCP23x17_GPIOA, old) ;
-    node->data2 = old ;
-  }
-  else				// Bank B
-  {
-    old = node->data3 ;
 
-    if (value == LOW)
-      old &= (~bit) ;
-    else
-      old |=   bit ;
+/*
+ * myDigitalWrite:
+ *********************************************************************************
+ */
 
-    writeByte (node->data0, node->data1, MCP23x17_GPIOB, old) ;
-    node->data3 = old ;
-  }
+static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
+{
+  mcp23xUpdateBit (node, MCP23x08_OLAT, pin - node->pinBase, value != LOW) ;
 }
 
 
@@ -214,6 +219,7 @@ int mcp23s17Setup (const int pinBase, const int spiPort, const int devId)
 {
   int    x ;
   struct wiringPiNodeStruct *node ;
+  struct mcp23xState *state ;
 
   if ((x = wiringPiSPISetup (spiPort, MCP_SPEED)) < 0)
     return x ;
@@ -223,14 +229,20 @@ int mcp23s17Setup (const int pinBase, const int spiPort, const int devId)
 
   node = wiringPiNewNode (pinBase, 16) ;
 
-  node->data0           = spiPort ;
-  node->data1           = devId ;
-  node->pinMode         = myPinMode ;
-  node->pullUpDnControl = myPullUpDnControl ;
-  node->digitalRead     = myDigitalRead ;
-  node->digitalWrite    = myDigitalWrite ;
-  node->data2           = readByte (spiPort, devId, MCP23x17_OLATA) ;
-  node->data3           = readByte (spiPort, devId, MCP23x17_OLATB) ;
+  node->data0             = spiPort ;
+  node->data1             = devId ;
+  node->pinMode           = myPinMode ;
+  node->pullUpDnControl   = myPullUpDnControl ;
+  node->digitalRead       = myDigitalRead ;
+  node->digitalWrite      = myDigitalWrite ;
+  node->digitalReadPort   = mcp23xReadPort ;
+  node->digitalWritePort  = mcp23xWritePort ;
+  node->digitalReadMulti  = wiringPiNodeReadMultiPort ;
+  node->digitalWriteMulti = wiringPiNodeWriteMultiPort ;
+  node->commit            = mcp23xCommit ;
+
+  state = mcp23xNew (node, 2, readReg, writeReg, readRegs, writeRegs) ;
+  state->iocon = IOCON_INIT | IOCON_HAEN ;	// Without HAEN only devId 0 answers
 
   return 0 ;
 }
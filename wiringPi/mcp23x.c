@@ -0,0 +1,832 @@
+/*
+ * mcp23x.c:
+ *	Common code for the MCP23008, MCP23017, MCP23S08 and MCP23S17
+ *	GPIO expanders: a write-through cache of the configuration registers
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with wiringPi.
+ *    If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+
+#include "wiringPi.h"
+#include "mcp23x0817.h"
+
+#include "mcp23x.h"
+
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
+#define	MCP23X_MAGIC	0x23017
+
+// mcp23xIntr:
+//	Interrupt dispatch for one expander. The chip's INT output (INTA
+//	with MIRROR set on the 23x17) is wired to an on-board GPIO which we
+//	watch through the sysfs edge interface.
+
+struct mcp23xIntr
+{
+  struct wiringPiNodeStruct *node ;
+  int       gpio ;
+  int       fd ;		// sysfs value file, -1 until set up
+  int       stopFd ;	// eventfd to wake the thread when we stop it
+  volatile int stop ;
+  pthread_t thread ;
+
+  int         edge     [16] ;
+  void      (*function [16]) (int pin, int value, void *userData) ;
+  void       *userData [16] ;
+
+  pthread_mutex_t    lock ;
+  pthread_cond_t     cond ;
+  struct mcp23xEvent events [MCP23X_EVENTS] ;
+  int                head, tail ;
+  unsigned long      dropped ;
+} ;
+
+// The registers we cache. The rest are either status (INTF, INTCAP,
+//	GPIO) or IOCON which the drivers set once at setup time.
+
+static const int cachedRegs [] =
+{
+  MCP23x08_IODIR, MCP23x08_IPOL, MCP23x08_GPINTEN, MCP23x08_DEFVAL,
+  MCP23x08_INTCON, MCP23x08_GPPU, MCP23x08_OLAT, -1
+} ;
+
+
+/*
+ * getState:
+ *	Return the cache for the expander a pin is on, or NULL
+ *********************************************************************************
+ */
+
+static struct mcp23xState *getState (int pin)
+{
+  struct wiringPiNodeStruct *node ;
+  struct mcp23xState *state ;
+
+  if ((node = wiringPiFindNode (pin)) == NULL)
+    return NULL ;
+
+  state = (struct mcp23xState *)node->extra ;
+
+  if ((state == NULL) || (state->magic != MCP23X_MAGIC))
+    return NULL ;
+
+  return state ;
+}
+
+
+/*
+ * mcp23xRegAddr:
+ *	Turn an MCP23x08_ register number and bank into a device address.
+ *	The 23x17 runs with IOCON.BANK = 0, so the A and B registers are
+ *	interleaved.
+ *********************************************************************************
+ */
+
+int mcp23xRegAddr (struct mcp23xState *state, int reg, int bank)
+{
+  if (state->banks == 1)
+    return reg ;
+  else
+    return reg * 2 + bank ;
+}
+
+
+/*
+ * resync:
+ *	Reload the cache from the device
+ *********************************************************************************
+ */
+
+static int resync (struct wiringPiNodeStruct *node, struct mcp23xState *state)
+{
+  unsigned char regs [MCP23X_REGS * 2] ;
+  int i, bank, x ;
+  int confLen = MCP23x08_INTF * state->banks ;
+  int olat    = mcp23xRegAddr (state, MCP23x08_OLAT, 0) ;
+
+  state->valid = FALSE ;
+
+// The configuration registers are all below INTF, so fetch them in one
+//	go, then OLAT. We mustn't touch INTCAP or GPIO: reading either
+//	clears a pending interrupt and the change would be lost.
+
+  if ((state->readRegs (node, 0,    regs,        confLen)      == confLen) &&
+      (state->readRegs (node, olat, regs + olat, state->banks) == state->banks))
+  {
+    for (i = 0 ; cachedRegs [i] != -1 ; ++i)
+      for (bank = 0 ; bank < state->banks ; ++bank)
+	state->cache [cachedRegs [i]][bank] = regs [mcp23xRegAddr (state, cachedRegs [i], bank)] ;
+
+    state->valid = TRUE ;
+    return 0 ;
+  }
+
+  for (i = 0 ; cachedRegs [i] != -1 ; ++i)
+    for (bank = 0 ; bank < state->banks ; ++bank)
+    {
+      if ((x = state->readReg (node, mcp23xRegAddr (state, cachedRegs [i], bank))) < 0)
+	return x ;
+      state->cache [cachedRegs [i]][bank] = x ;
+    }
+
+  state->valid = TRUE ;
+  return 0 ;
+}
+
+
+/*
+ * mcp23xNew:
+ *	Attach a new register cache to an expander node and load it
+ *********************************************************************************
+ */
+
+struct mcp23xState *mcp23xNew (struct wiringPiNodeStruct *node, int banks,
+	int  (*readReg)  (struct wiringPiNodeStruct *node, int reg),
+	void (*writeReg) (struct wiringPiNodeStruct *node, int reg, int value),
+	int  (*readRegs)  (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len),
+	int  (*writeRegs) (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len))
+{
+  struct mcp23xState *state ;
+
+  if ((state = (struct mcp23xState *)calloc (1, sizeof (struct mcp23xState))) == NULL)
+    (void)wiringPiFailure (WPI_FATAL, "mcp23xNew: Unable to allocate memory: %s\n", strerror (errno)) ;
+
+  state->magic    = MCP23X_MAGIC ;
+  state->banks    = banks ;
+  state->iocon    = IOCON_INIT ;
+  state->readReg  = readReg ;
+  state->writeReg = writeReg ;
+  state->readRegs  = readRegs ;
+  state->writeRegs = writeRegs ;
+
+  node->extra = state ;
+
+  (void)resync (node, state) ;
+
+  return state ;
+}
+
+
+/*
+ * mcp23xGetReg:
+ *	Return the cached value of a register, reloading the cache first
+ *	if it's been invalidated.
+ *********************************************************************************
+ */
+
+int mcp23xGetReg (struct wiringPiNodeStruct *node, int reg, int bank)
+{
+  struct mcp23xState *state = (struct mcp23xState *)node->extra ;
+
+  if (!state->valid)
+    (void)resync (node, state) ;
+
+  return state->cache [reg][bank] ;
+}
+
+
+/*
+ * mcp23xSetReg:
+ *	Write a register through the cache
+ *********************************************************************************
+ */
+
+void mcp23xSetReg (struct wiringPiNodeStruct *node, int reg, int bank, int value)
+{
+  struct mcp23xState *state = (struct mcp23xState *)node->extra ;
+
+  state->writeReg (node, mcp23xRegAddr (state, reg, bank), value) ;
+  state->cache [reg][bank] = value ;
+}
+
+
+/*
+ * mcp23xUpdateBit:
+ *	Set or clear the bit for a pin (0-15, relative to the node) in
+ *	one of the cached registers. This used to be a read-modify-write
+ *	over the bus; now it's a single write.
+ *********************************************************************************
+ */
+
+void mcp23xUpdateBit (struct wiringPiNodeStruct *node, int reg, int pin, int set)
+{
+  struct mcp23xState *state = (struct mcp23xState *)node->extra ;
+  int bank = pin >> 3 ;
+  int mask = 1 << (pin & 7) ;
+  int old ;
+
+  old = mcp23xGetReg (node, reg, bank) ;
+
+  if (set)
+    old |=   mask ;
+  else
+    old &= (~mask) ;
+
+  if ((reg == MCP23x08_OLAT) && node->deferred)	// Held for wiringPiCommit ()
+  {
+    state->cache [reg][bank] = old ;
+    state->dirtyOlat |= 1 << bank ;
+    node->dirty = TRUE ;
+    return ;
+  }
+
+  mcp23xSetReg (node, reg, bank, old) ;
+
+  if (reg != MCP23x08_OLAT)	// The output latch was always shadowed
+    ++state->saved ;
+}
+
+
+/*
+ * mcp23xReadPort:
+ *	Read all the pins at once. On the 23x17 GPIOA and GPIOB are adjacent
+ *	with BANK=0, so that's one 2-byte transaction rather than one per pin.
+ *********************************************************************************
+ */
+
+unsigned int mcp23xReadPort (struct wiringPiNodeStruct *node)
+{
+  struct mcp23xState *state = (struct mcp23xState *)node->extra ;
+  unsigned char data [2] ;
+
+  if (state->banks == 1)
+    return state->readReg (node, MCP23x08_GPIO) & 0xFF ;
+
+  if (state->readRegs (node, MCP23x17_GPIOA, data, 2) != 2)
+    return 0 ;
+
+  return data [0] | (data [1] << 8) ;
+}
+
+
+/*
+ * writeOlat:
+ *	Send the cached output latch for the given banks (bit mask) to the
+ *	chip; both banks of a 23x17 go out together in one transfer.
+ *********************************************************************************
+ */
+
+static void writeOlat (struct wiringPiNodeStruct *node, struct mcp23xState *state, int banks)
+{
+  int bank ;
+
+  if (banks == 3)
+    state->writeRegs (node, MCP23x17_OLATA, state->cache [MCP23x08_OLAT], 2) ;
+  else if (banks != 0)
+  {
+    bank = banks >> 1 ;
+    state->writeReg (node, mcp23xRegAddr (state, MCP23x08_OLAT, bank), state->cache [MCP23x08_OLAT][bank]) ;
+  }
+}
+
+
+/*
+ * mcp23xWritePort:
+ *	Change the outputs selected by mask. Only the banks whose latch
+ *	actually changes are written, and both banks of a 23x17 go out
+ *	together.
+ *********************************************************************************
+ */
+
+void mcp23xWritePort (struct wiringPiNodeStruct *node, unsigned int value, unsigned int mask)
+{
+  struct mcp23xState *state = (struct mcp23xState *)node->extra ;
+  int bank, old, new, changed = 0 ;
+
+  for (bank = 0 ; bank < state->banks ; ++bank)
+  {
+    int m = (mask  >> (bank * 8)) & 0xFF ;
+    int v = (value >> (bank * 8)) & 0xFF ;
+
+    if (m == 0)
+      continue ;
+
+    old = mcp23xGetReg (node, MCP23x08_OLAT, bank) ;
+    new = (old & ~m) | (v & m) ;
+    if (new == old)
+      continue ;
+
+    state->cache [MCP23x08_OLAT][bank] = new ;
+    changed |= 1 << bank ;
+  }
+
+  if (changed == 0)
+    return ;
+
+  if (node->deferred)
+  {
+    state->dirtyOlat |= changed ;
+    node->dirty = TRUE ;
+  }
+  else
+    writeOlat (node, state, changed) ;
+}
+
+
+/*
+ * mcp23xCommit:
+ *	Send the output changes held back since wiringPiBegin ()
+ *********************************************************************************
+ */
+
+void mcp23xCommit (struct wiringPiNodeStruct *node)
+{
+  struct mcp23xState *state = (struct mcp23xState *)node->extra ;
+
+  writeOlat (node, state, state->dirtyOlat) ;
+  state->dirtyOlat = 0 ;
+}
+
+
+/*
+ * getIntr:
+ *	Return the interrupt block for an expander, creating it if needed
+ *********************************************************************************
+ */
+
+static struct mcp23xIntr *getIntr (struct mcp23xState *state, struct wiringPiNodeStruct *node)
+{
+  struct mcp23xIntr *intr ;
+
+  if (state->intr != NULL)
+    return state->intr ;
+
+  if ((intr = (struct mcp23xIntr *)calloc (1, sizeof (struct mcp23xIntr))) == NULL)
+    (void)wiringPiFailure (WPI_FATAL, "mcp23xInterrupt: Unable to allocate memory: %s\n", strerror (errno)) ;
+
+  intr->node   = node ;
+  intr->fd     = -1 ;
+  intr->stopFd = -1 ;
+  pthread_mutex_init (&intr->lock, NULL) ;
+  pthread_cond_init  (&intr->cond, NULL) ;
+
+  return state->intr = intr ;
+}
+
+
+/*
+ * service:
+ *	The INT line has fired: read INTF and INTCAP in one burst (reading
+ *	INTCAP also clears the interrupt in the chip), then hand each flagged
+ *	pin to its callback or the event queue. A failed read is retried, as
+ *	until INTCAP is read the chip holds INT low and there'll be no more
+ *	edges. Returns FALSE if the chip couldn't be read.
+ *********************************************************************************
+ */
+
+#define	SERVICE_TRIES	3
+
+static int service (struct mcp23xState *state, struct mcp23xIntr *intr)
+{
+  struct wiringPiNodeStruct *node = intr->node ;
+  struct mcp23xEvent event ;
+  unsigned char regs [4] ;
+  unsigned int  flags, cap ;
+  unsigned int  now = micros () ;
+  int len = 2 * state->banks ;
+  int pin, edge, tries ;
+  void (*function)(int pin, int value, void *userData) ;
+  void *userData ;
+
+  for (tries = 0 ; tries < SERVICE_TRIES ; ++tries)
+    if (state->readRegs (node, mcp23xRegAddr (state, MCP23x08_INTF, 0), regs, len) == len)
+      break ;
+
+  if (tries == SERVICE_TRIES)
+    return FALSE ;
+
+  if (state->banks == 1)
+  {
+    flags = regs [0] ;
+    cap   = regs [1] ;
+  }
+  else
+  {
+    flags = regs [0] | (regs [1] << 8) ;
+    cap   = regs [2] | (regs [3] << 8) ;
+  }
+
+  for (pin = 0 ; pin < state->banks * 8 ; ++pin)
+  {
+    if ((flags & (1 << pin)) == 0)
+      continue ;
+
+    event.pin   = node->pinBase + pin ;
+    event.value = (cap >> pin) & 1 ;
+    event.time  = now ;
+
+// mcp23xPinInterrupt () can change these under us
+
+    pthread_mutex_lock (&intr->lock) ;
+      edge     = intr->edge     [pin] ;
+      function = intr->function [pin] ;
+      userData = intr->userData [pin] ;
+    pthread_mutex_unlock (&intr->lock) ;
+
+// The chip interrupts on any change; apply the edge filter here
+
+    if (edge == INT_EDGE_SETUP)
+      continue ;
+    if ((edge == INT_EDGE_FALLING) && (event.value != LOW))
+      continue ;
+    if ((edge == INT_EDGE_RISING)  && (event.value != HIGH))
+      continue ;
+
+    if (function != NULL)
+    {
+      function (event.pin, event.value, userData) ;
+      continue ;
+    }
+
+    pthread_mutex_lock (&intr->lock) ;
+      if (((intr->head + 1) % MCP23X_EVENTS) == intr->tail)	// Full - lose the oldest
+      {
+	intr->tail = (intr->tail + 1) % MCP23X_EVENTS ;
+	++intr->dropped ;
+      }
+      intr->events [intr->head] = event ;
+      intr->head = (intr->head + 1) % MCP23X_EVENTS ;
+      pthread_cond_signal (&intr->cond) ;
+    pthread_mutex_unlock (&intr->lock) ;
+  }
+
+  return TRUE ;
+}
+
+
+/*
+ * interruptThread:
+ *	Wait for edges on the INT line and service the chip. The edge is
+ *	only a hint: keep servicing for as long as the line is still low,
+ *	or a change that arrives while we're busy would leave INT asserted
+ *	with no new edge to wake us. mcp23xStopInterrupt () wakes us through
+ *	stopFd.
+ *********************************************************************************
+ */
+
+static void *interruptThread (void *arg)
+{
+  struct mcp23xState *state = (struct mcp23xState *)arg ;
+  struct mcp23xIntr  *intr  = state->intr ;
+  struct pollfd polls [2] ;
+  char c ;
+
+  (void)piHiPri (55) ;	// Only effective if we run as root
+
+  polls [0].fd     = intr->fd ;
+  polls [0].events = POLLPRI ;
+  polls [1].fd     = intr->stopFd ;
+  polls [1].events = POLLIN ;
+
+  while (!intr->stop)
+  {
+    if (poll (polls, 2, -1) < 0)
+    {
+      if (errno == EINTR)
+	continue ;
+      break ;
+    }
+
+    while (!intr->stop)
+    {
+      lseek (intr->fd, 0L, SEEK_SET) ;
+      if ((read (intr->fd, &c, 1) == 1) && (c != '0'))
+	break ;
+
+      if (!service (state, intr))
+	delay (1) ;		// Give a sick bus a moment
+    }
+  }
+
+  return NULL ;
+}
+
+
+/*
+ * mcp23xServiceInterrupt:
+ *	Check the chip for input changes and dispatch them now - for when
+ *	INT isn't wired to a GPIO and you'd rather poll, or you're watching
+ *	it yourself. mcp23xSetupInterrupt () isn't needed for this.
+ *	Returns 0, or -1 if the chip couldn't be read.
+ *********************************************************************************
+ */
+
+int mcp23xServiceInterrupt (int pin)
+{
+  struct wiringPiNodeStruct *node = wiringPiFindNode (pin) ;
+  struct mcp23xState *state = getState (pin) ;
+
+  if (state == NULL)
+    return -1 ;
+
+  return service (state, getIntr (state, node)) ? 0 : -1 ;
+}
+
+
+/*
+ * sysfsWrite:
+ *	Write a string to a sysfs gpio control file
+ *********************************************************************************
+ */
+
+static int sysfsWrite (const char *fName, const char *value)
+{
+  int fd, ok ;
+
+  if ((fd = open (fName, O_WRONLY)) < 0)
+    return -1 ;
+
+  ok = write (fd, value, strlen (value)) == (ssize_t)strlen (value) ;
+  close (fd) ;
+
+  return ok ? 0 : -1 ;
+}
+
+
+/*
+ * mcp23xSetupInterrupt:
+ *	Route the expander's interrupt output to an on-board GPIO (given as
+ *	the kernel GPIO number) and start the dispatch thread. On the 23x17
+ *	IOCON.MIRROR is set so INTA covers both banks and one wire will do;
+ *	the rest of IOCON stays as the driver set it (HAEN on the 23S17).
+ *	With a gpio of -1 only the chip is set up, for when you watch INT
+ *	yourself and call mcp23xServiceInterrupt ().
+ *	The pin should then be selected with mcp23xPinInterrupt ().
+ *********************************************************************************
+ */
+
+int mcp23xSetupInterrupt (int pin, int gpio)
+{
+  struct wiringPiNodeStruct *node = wiringPiFindNode (pin) ;
+  struct mcp23xState *state = getState (pin) ;
+  struct mcp23xIntr  *intr ;
+  char fName [64], value [16] ;
+  unsigned char regs [4] ;
+
+  if (state == NULL)
+    return -1 ;
+
+  intr = getIntr (state, node) ;
+  if (intr->fd != -1)
+    return 0 ;
+
+  state->writeReg (node, mcp23xRegAddr (state, MCP23x08_IOCON, 0),
+	state->iocon | ((state->banks == 2) ? IOCON_MIRROR : 0)) ;
+
+  if (gpio < 0)
+  {
+    (void)state->readRegs (node, mcp23xRegAddr (state, MCP23x08_INTF, 0), regs, 2 * state->banks) ;
+    return 0 ;
+  }
+
+// Export the GPIO and have the kernel report falling edges - INT is
+//	active low. Exporting an already exported pin fails harmlessly.
+
+  sprintf (value, "%d", gpio) ;
+  (void)sysfsWrite ("/sys/class/gpio/export", value) ;
+
+  sprintf (fName, "/sys/class/gpio/gpio%d/direction", gpio) ;
+  if (sysfsWrite (fName, "in") < 0)
+    return wiringPiFailure (WPI_ALMOST, "mcp23xSetupInterrupt: Unable to set GPIO %d as input: %s\n", gpio, strerror (errno)) ;
+
+  sprintf (fName, "/sys/class/gpio/gpio%d/edge", gpio) ;
+  if (sysfsWrite (fName, "falling") < 0)
+    return wiringPiFailure (WPI_ALMOST, "mcp23xSetupInterrupt: Unable to set the edge on GPIO %d: %s\n", gpio, strerror (errno)) ;
+
+  sprintf (fName, "/sys/class/gpio/gpio%d/value", gpio) ;
+  if ((intr->fd = open (fName, O_RDONLY)) < 0)
+    return wiringPiFailure (WPI_ALMOST, "mcp23xSetupInterrupt: Unable to open %s: %s\n", fName, strerror (errno)) ;
+
+  intr->gpio = gpio ;
+
+// Clear anything pending in the chip, and the initial sysfs event
+
+  (void)state->readRegs (node, mcp23xRegAddr (state, MCP23x08_INTF, 0), regs, 2 * state->banks) ;
+  lseek (intr->fd, 0L, SEEK_SET) ;
+  (void)read (intr->fd, value, sizeof (value)) ;
+
+  intr->stop = FALSE ;
+  if (((intr->stopFd = eventfd (0, EFD_CLOEXEC)) < 0) ||
+	(pthread_create (&intr->thread, NULL, interruptThread, state) != 0))
+  {
+    if (intr->stopFd >= 0)
+      close (intr->stopFd) ;
+    close (intr->fd) ;
+    intr->fd = intr->stopFd = -1 ;
+    return wiringPiFailure (WPI_ALMOST, "mcp23xSetupInterrupt: Unable to start the interrupt thread\n") ;
+  }
+
+  return 0 ;
+}
+
+
+/*
+ * mcp23xStopInterrupt:
+ *	Undo mcp23xSetupInterrupt (): stop the dispatch thread, release the
+ *	GPIO and put IOCON back as the driver had it. The pin interrupt
+ *	settings and any queued events are kept, so mcp23xServiceInterrupt ()
+ *	and mcp23xGetEvent () still work, and setting up again carries on.
+ *********************************************************************************
+ */
+
+void mcp23xStopInterrupt (int pin)
+{
+  struct wiringPiNodeStruct *node = wiringPiFindNode (pin) ;
+  struct mcp23xState *state = getState (pin) ;
+  struct mcp23xIntr  *intr ;
+  uint64_t one = 1 ;
+  char value [16] ;
+
+  if ((state == NULL) || ((intr = state->intr) == NULL))
+    return ;
+
+  if (intr->fd != -1)
+  {
+    intr->stop = TRUE ;
+    (void)write (intr->stopFd, &one, sizeof (one)) ;
+    pthread_join (intr->thread, NULL) ;
+
+    close (intr->fd) ;
+    close (intr->stopFd) ;
+    intr->fd = intr->stopFd = -1 ;
+
+    sprintf (value, "%d", intr->gpio) ;
+    (void)sysfsWrite ("/sys/class/gpio/unexport", value) ;
+  }
+
+  state->writeReg (node, mcp23xRegAddr (state, MCP23x08_IOCON, 0), state->iocon) ;
+}
+
+
+/*
+ * mcp23xPinInterrupt:
+ *	Enable (or with edge INT_EDGE_SETUP, disable) the interrupt for one
+ *	expander pin. The chip is set to interrupt on change (INTCON clear,
+ *	so DEFVAL isn't used) and the edge is filtered from INTCAP, which
+ *	avoids the repeated interrupts compare mode gives while a pin is
+ *	held. If function is NULL the changes go to the event queue to be
+ *	collected with mcp23xGetEvent ().
+ *********************************************************************************
+ */
+
+int mcp23xPinInterrupt (int pin, int edge, void (*function)(int pin, int value, void *userData), void *userData)
+{
+  struct wiringPiNodeStruct *node = wiringPiFindNode (pin) ;
+  struct mcp23xState *state = getState (pin) ;
+  struct mcp23xIntr  *intr ;
+  int bit ;
+
+  if (state == NULL)
+    return -1 ;
+
+  intr = getIntr (state, node) ;
+  bit  = pin - node->pinBase ;
+
+  pthread_mutex_lock (&intr->lock) ;
+    intr->edge     [bit] = edge ;
+    intr->function [bit] = function ;
+    intr->userData [bit] = userData ;
+  pthread_mutex_unlock (&intr->lock) ;
+
+  mcp23xUpdateBit (node, MCP23x08_INTCON,  bit, FALSE) ;
+  mcp23xUpdateBit (node, MCP23x08_GPINTEN, bit, edge != INT_EDGE_SETUP) ;
+
+  return 0 ;
+}
+
+
+/*
+ * mcp23xGetEvent:
+ *	Take the oldest queued input change for the expander pin is on.
+ *	mS is how long to wait for one: 0 to poll, -1 for ever.
+ *	Returns 1 with an event, 0 on timeout or -1 on error.
+ *********************************************************************************
+ */
+
+int mcp23xGetEvent (int pin, struct mcp23xEvent *event, int mS)
+{
+  struct mcp23xState *state = getState (pin) ;
+  struct mcp23xIntr  *intr ;
+  struct timeval  now ;
+  struct timespec until ;
+  int res = 0 ;
+
+  if ((state == NULL) || ((intr = state->intr) == NULL))
+    return -1 ;
+
+  if (mS > 0)
+  {
+    gettimeofday (&now, NULL) ;
+    until.tv_sec  = now.tv_sec + mS / 1000 ;
+    until.tv_nsec = (now.tv_usec + (mS % 1000) * 1000) * 1000 ;
+    if (until.tv_nsec >= 1000000000)
+    {
+      until.tv_nsec -= 1000000000 ;
+      ++until.tv_sec ;
+    }
+  }
+
+  pthread_mutex_lock (&intr->lock) ;
+    while ((intr->head == intr->tail) && (mS != 0) && (res == 0))
+      if (mS < 0)
+	pthread_cond_wait (&intr->cond, &intr->lock) ;
+      else
+	res = pthread_cond_timedwait (&intr->cond, &intr->lock, &until) ;
+
+    if (intr->head != intr->tail)
+    {
+      *event     = intr->events [intr->tail] ;
+      intr->tail = (intr->tail + 1) % MCP23X_EVENTS ;
+      res = 1 ;
+    }
+    else
+      res = 0 ;
+  pthread_mutex_unlock (&intr->lock) ;
+
+  return res ;
+}
+
+
+/*
+ * mcp23xResync:
+ *	Reload the cache from the device now, e.g. after it's been reset or
+ *	another program has changed it.
+ *********************************************************************************
+ */
+
+int mcp23xResync (int pin)
+{
+  struct wiringPiNodeStruct *node = wiringPiFindNode (pin) ;
+  struct mcp23xState *state = getState (pin) ;
+
+  if (state == NULL)
+    return -1 ;
+
+  return resync (node, state) ;
+}
+
+
+/*
+ * mcp23xInvalidate:
+ *	Mark the cache as stale - it will be reloaded on next use.
+ *********************************************************************************
+ */
+
+int mcp23xInvalidate (int pin)
+{
+  struct mcp23xState *state = getState (pin) ;
+
+  if (state == NULL)
+    return -1 ;
+
+  state->valid = FALSE ;
+  return 0 ;
+}
+
+
+/*
+ * mcp23xSavedTransactions:
+ *	Number of bus reads avoided by the cache so far
+ *********************************************************************************
+ */
+
+unsigned long mcp23xSavedTransactions (int pin)
+{
+  struct mcp23xState *state = getState (pin) ;
+
+  if (state == NULL)
+    return 0 ;
+
+  return state->saved ;
+}
@@ -0,0 +1,108 @@
+/*
+ * mcp23x.h:
+ *	Common code for the MCP23008, MCP23017, MCP23S08 and MCP23S17
+ *	GPIO expanders: a write-through cache of the configuration registers
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with wiringPi.
+ *    If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+// Number of registers in one bank - indexed by the MCP23x08_ register numbers
+
+#define	MCP23X_REGS	11
+
+// Size of the per-expander queue of input change events
+
+#define	MCP23X_EVENTS	64
+
+struct mcp23xIntr ;
+
+// mcp23xEvent:
+//	One input change, as captured by the chip in INTCAP
+
+struct mcp23xEvent
+{
+  int          pin ;
+  int          value ;
+  unsigned int time ;		// micros () when we serviced the interrupt
+} ;
+
+// mcp23xState:
+//	Hung off node->extra by the expander drivers. The library is the only
+//	writer of the configuration registers, so we keep a copy of them here
+//	and never need to read them back over the bus.
+//	The driver supplies the register access functions; reg is the device
+//	register address (already adjusted for the bank). The Regs versions
+//	transfer len consecutive registers in one transaction - the chip
+//	runs with sequential addressing on (IOCON.SEQOP clear) for this.
+
+struct mcp23xState
+{
+  int           magic ;
+  int           banks ;		// 1 for the 23x08, 2 for the 23x17
+  int           valid ;		// Cache matches the device
+  int           iocon ;		// IOCON as the driver set it up - IOCON_INIT unless it says otherwise
+
+  int         (*readReg)  (struct wiringPiNodeStruct *node, int reg) ;
+  void        (*writeReg) (struct wiringPiNodeStruct *node, int reg, int value) ;
+  int         (*readRegs)  (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len) ;
+  int         (*writeRegs) (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len) ;
+
+  unsigned char cache [MCP23X_REGS][2] ;
+  unsigned long saved ;		// Bus transactions not made thanks to the cache
+  int           dirtyOlat ;	// Banks with output changes held by wiringPiBegin ()
+
+  struct mcp23xIntr *intr ;	// Set up by mcp23xSetupInterrupt ()
+} ;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Used by the drivers
+
+extern struct mcp23xState *mcp23xNew (struct wiringPiNodeStruct *node, int banks,
+	int  (*readReg)  (struct wiringPiNodeStruct *node, int reg),
+	void (*writeReg) (struct wiringPiNodeStruct *node, int reg, int value),
+	int  (*readRegs)  (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len),
+	int  (*writeRegs) (struct wiringPiNodeStruct *node, int reg, unsigned char *data, int len)) ;
+
+extern int  mcp23xRegAddr   (struct mcp23xState *state, int reg, int bank) ;
+extern int  mcp23xGetReg    (struct wiringPiNodeStruct *node, int reg, int bank) ;
+extern void mcp23xSetReg    (struct wiringPiNodeStruct *node, int reg, int bank, int value) ;
+extern void mcp23xUpdateBit (struct wiringPiNodeStruct *node, int reg, int pin, int set) ;
+
+extern unsigned int mcp23xReadPort  (struct wiringPiNodeStruct *node) ;
+extern void         mcp23xWritePort (struct wiringPiNodeStruct *node, unsigned int value, unsigned int mask) ;
+extern void         mcp23xCommit    (struct wiringPiNodeStruct *node) ;
+
+// User API - pin is any pin on the expander
+
+extern int           mcp23xResync            (int pin) ;
+extern int           mcp23xInvalidate        (int pin) ;
+extern unsigned long mcp23xSavedTransactions (int pin) ;
+
+extern int mcp23xSetupInterrupt (int pin, int gpio) ;
+extern void mcp23xStopInterrupt (int pin) ;
+extern int mcp23xPinInterrupt   (int pin, int edge, void (*function)(int pin, int value, void *userData), void *userData) ;
+extern int mcp23xGetEvent       (int pin, struct mcp23xEvent *event, int mS) ;
+extern int mcp23xServiceInterrupt (int pin) ;
+
+#ifdef __cplusplus
+}
+#endif
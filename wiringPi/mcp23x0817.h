@@ -78,8 +78,10 @@
 #define	IOCON_BANK_MODE	0x80
 
 // Default initialisation mode
+//	BANK=0 with sequential addressing (SEQOP clear) so that GPIOA/GPIOB,
+//	OLATA/OLATB, etc. can be transferred as a pair in one transaction.
 
-#define	IOCON_INIT	(IOCON_SEQOP)
+#define	IOCON_INIT	(0)
 
 // SPI Command codes
 
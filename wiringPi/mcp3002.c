@@ -53,6 +53,40 @@ static int myAnalogRead (struct wiringPiNodeStruct *node, int pin)
 }
 
 
+/*
+ * myAnalogReadMulti:
+ *	Several conversions in one SPI message
+ *********************************************************************************
+ */
+
+static void myAnalogReadMulti (struct wiringPiNodeStruct *node, const int *pins, int *values, int count)
+{
+  unsigned char spiData [2 * 16] ;
+  int i, n, chan ;
+
+  while (count > 0)
+  {
+    n = (count > 16) ? 16 : count ;
+
+    for (i = 0 ; i < n ; ++i)
+    {
+      chan = pins [i] - node->pinBase ;
+      spiData [i * 2 + 0] = (chan == 0) ? 0b11010000 : 0b11110000 ;
+      spiData [i * 2 + 1] = 0 ;
+    }
+
+    wiringPiSPIDataRWChain (node->fd, spiData, 2, n) ;
+
+    for (i = 0 ; i < n ; ++i)
+      values [i] = ((spiData [i * 2] << 7) | (spiData [i * 2 + 1] >> 1)) & 0x3FF ;
+
+    pins   += n ;
+    values += n ;
+    count  -= n ;
+  }
+}
+
+
 /*
  * mcp3002Setup:
  *	Create a new wiringPi device node for an mcp3002 on the Pi's
@@ -69,8 +103,9 @@ int mcp3002Setup (const int pinBase, int spiChannel)
 
   node = wiringPiNewNode (pinBase, 2) ;
 
-  node->fd         = spiChannel ;
-  node->analogRead = myAnalogRead ;
+  node->fd              = spiChannel ;
+  node->analogRead      = myAnalogRead ;
+  node->analogReadMulti = myAnalogReadMulti ;
 
   return 0 ;
 }
@@ -53,6 +53,41 @@ static int myAnalogRead (struct wiringPiNodeStruct *node, int pin)
 }
 
 
+/*
+ * myAnalogReadMulti:
+ *	Several conversions in one SPI message
+ *********************************************************************************
+ */
+
+static void myAnalogReadMulti (struct wiringPiNodeStruct *node, const int *pins, int *values, int count)
+{
+  unsigned char spiData [3 * 16] ;
+  int i, n, chan ;
+
+  while (count > 0)
+  {
+    n = (count > 16) ? 16 : count ;
+
+    for (i = 0 ; i < n ; ++i)
+    {
+      chan = pins [i] - node->pinBase ;
+      spiData [i * 3 + 0] = 1 ;				// Start bit
+      spiData [i * 3 + 1] = 0b10000000 | (chan << 4) ;
+      spiData [i * 3 + 2] = 0 ;
+    }
+
+    wiringPiSPIDataRWChain (node->fd, spiData, 3, n) ;
+
+    for (i = 0 ; i < n ; ++i)
+      values [i] = ((spiData [i * 3 + 1] << 8) | spiData [i * 3 + 2]) & 0x3FF ;
+
+    pins   += n ;
+    values += n ;
+    count  -= n ;
+  }
+}
+
+
 /*
  * mcp3004Setup:
  *	Create a new wiringPi device node for an mcp3004 on the Pi's
@@ -69,8 +104,9 @@ int mcp3004Setup (const int pinBase, int spiChannel)
 
   node = wiringPiNewNode (pinBase, 8) ;
 
-  node->fd         = spiChannel ;
-  node->analogRead = myAnalogRead ;
+  node->fd              = spiChannel ;
+  node->analogRead      = myAnalogRead ;
+  node->analogReadMulti = myAnalogReadMulti ;
 
   return 0 ;
 }
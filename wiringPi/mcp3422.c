@@ -25,67 +25,323 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdint.h>
-#include <fcntl.h>
-#include <sys/ioctl.h>
-#include <linux/spi/spidev.h>
+#include <pthread.h>
 
 #include <wiringPi.h>
 #include <wiringPiI2C.h>
 
 #include "mcp3422.h"
 
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
+// Config register bits
+
+#define	MCP3422_RDY	0x80	// Write: start a one-shot conversion, Read: 0 = new result
+#define	MCP3422_CONT	0x10	// Continuous conversion
+
+// Conversion time for each sample rate, uS
+
+static const int convTime [4] = { 266667, 66667, 16667, 4167 } ;
+
+// mcp3422State:
+//	Hung off node->extra. The multiplexer thread leaves the latest
+//	result for each channel here. busLock covers a whole conversion -
+//	config write to result - so a one-shot read of a channel the
+//	multiplexer isn't covering can't be mixed up with its conversions.
+
+struct mcp3422State
+{
+  pthread_t          thread ;
+  pthread_mutex_t    lock ;
+  pthread_mutex_t    busLock ;
+  volatile int       running ;
+  volatile int       oneShots ;		// Waiting for busLock, under lock
+  int                chanMask ;
+  int                muxChan ;		// Channel the chip is converting in continuous mode, -1 for none
+
+  int                value [4] ;
+  unsigned long long time  [4] ;	// CLOCK_MONOTONIC, nS - 0 until we have one
+} ;
+
 
 /*
- * myAnalogRead:
- *	Read a channel from the device
+ * nowNs: sleepUs:
  *********************************************************************************
  */
 
-int myAnalogRead (struct wiringPiNodeStruct *node, int chan)
+static unsigned long long nowNs (void)
+{
+  struct timespec ts ;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts) ;
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec ;
+}
+
+static void sleepUs (int us)
+{
+  struct timespec ts ;
+
+  ts.tv_sec  = us / 1000000 ;
+  ts.tv_nsec = (us % 1000000) * 1000 ;
+  while (nanosleep (&ts, &ts) == -1 && errno == EINTR)
+    ;
+}
+
+
+/*
+ * readResult:
+ *	Read the output register and the config byte that follows it.
+ *	Returns the config byte, or -1 on a bus error. The RDY bit in it
+ *	is clear when the value is a new one.
+ *********************************************************************************
+ */
+
+static int readResult (struct wiringPiNodeStruct *node, int *value)
 {
-  unsigned char config ;
   unsigned char buffer [4] ;
-  int value = 0 ;
 
-// One-shot mode, trigger plus the other configs.
+  if (node->data0 == MCP3422_SR_3_75)			// 18 bits
+  {
+    if (wiringPiI2CReadRaw (node->fd, buffer, 4) != 4)
+      return -1 ;
+    *value = ((buffer [0] & 3) << 16) | (buffer [1] << 8) | buffer [2] ;
+    return buffer [3] ;
+  }
+
+  if (wiringPiI2CReadRaw (node->fd, buffer, 3) != 3)
+    return -1 ;
+
+  switch (node->data0)
+  {
+    case MCP3422_SR_15:	*value =  (buffer [0]         << 8) | buffer [1] ; break ;	// 16 bits
+    case MCP3422_SR_60:	*value = ((buffer [0] & 0x3F) << 8) | buffer [1] ; break ;	// 14 bits
+    default:		*value = ((buffer [0] & 0x0F) << 8) | buffer [1] ; break ;	// 12 bits
+  }
+
+  return buffer [2] ;
+}
+
+
+/*
+ * waitResult:
+ *	Sleep through most of a conversion, then poll RDY until the result
+ *	for chan turns up. Returns FALSE if it doesn't within 2 conversions.
+ *********************************************************************************
+ */
+
+static int waitResult (struct wiringPiNodeStruct *node, int chan, int *value)
+{
+  int conv = convTime [node->data0] ;
+  int poll = (conv / 16 > 500) ? conv / 16 : 500 ;
+  int waited, config ;
+
+  sleepUs (conv - conv / 8) ;
+
+  for (waited = conv - conv / 8 ; waited < conv * 2 ; waited += poll)
+  {
+    if ((config = readResult (node, value)) < 0)
+      return FALSE ;
+
+// In continuous mode a result for the previous channel may still be
+//	waiting when we switch, so check which channel it came from
+
+    if (((config & MCP3422_RDY) == 0) && (((config >> 5) & 3) == chan))
+      return TRUE ;
+
+    sleepUs (poll) ;
+  }
+
+  return FALSE ;
+}
+
+
+/*
+ * muxThread:
+ *	Rotate the converter around the selected channels in continuous
+ *	mode, keeping the latest result for each. With a single channel we
+ *	leave the config alone and just collect each conversion.
+ *********************************************************************************
+ */
+
+static void *muxThread (void *arg)
+{
+  struct wiringPiNodeStruct *node  = (struct wiringPiNodeStruct *)arg ;
+  struct mcp3422State       *state = (struct mcp3422State *)node->extra ;
+  int chan = -1, next, value, ok ;
+
+  while (state->running)
+  {
+
+// Let any one-shot reads in first - we'd otherwise take busLock straight back
+
+    while (state->oneShots > 0)
+      sleepUs (1000) ;
+
+    for (next = (chan + 1) & 3 ; (state->chanMask & (1 << next)) == 0 ; next = (next + 1) & 3)
+      ;
+    chan = next ;
+
+    pthread_mutex_lock (&state->busLock) ;
 
-  config = 0x80 | ((chan - node->pinBase) << 5) | (node->data0 << 2) | (node->data1) ;
-  
-  wiringPiI2CWrite (node->fd, config) ;
+// A one-shot read, or a failed one of ours, leaves muxChan at -1 so the
+//	continuous config goes back, even with only the one channel.
 
-  switch (node->data0)	// Sample rate
+      if (chan != state->muxChan)
+      {
+	state->muxChan = chan ;
+	wiringPiI2CWrite (node->fd, MCP3422_CONT | (chan << 5) | (node->data0 << 2) | node->data1) ;
+      }
+
+      if (!(ok = waitResult (node, chan, &value)))
+	state->muxChan = -1 ;
+
+    pthread_mutex_unlock (&state->busLock) ;
+
+    if (!ok)
+      continue ;
+
+    pthread_mutex_lock (&state->lock) ;
+      state->value [chan] = value ;
+      state->time  [chan] = nowNs () ;
+    pthread_mutex_unlock (&state->lock) ;
+  }
+
+  return NULL ;
+}
+
+
+/*
+ * myAnalogRead:
+ *	Read a channel from the device. When the multiplexer is running
+ *	and covers the channel we just hand back its latest result,
+ *	otherwise do a one-shot conversion.
+ *********************************************************************************
+ */
+
+static int myAnalogRead (struct wiringPiNodeStruct *node, int pin)
+{
+  struct mcp3422State *state = (struct mcp3422State *)node->extra ;
+  int chan = pin - node->pinBase ;
+  int value = 0 ;
+
+  if (state->running && (state->chanMask & (1 << chan)))
   {
-    case MCP3422_SR_3_75:			// 18 bits
-      delay (270) ;
-      read (node->fd, buffer, 4) ;
-      value = ((buffer [0] & 3) << 16) | (buffer [1] << 8) | buffer [0] ;
-      break ;
-
-    case MCP3422_SR_15:				// 16 bits
-      delay ( 70) ;
-      read (node->fd, buffer, 3) ;
-      value = (buffer [0] << 8) | buffer [1] ;
-      break ;
-
-    case MCP3422_SR_60:				// 14 bits
-      delay ( 17) ;
-      read (node->fd, buffer, 3) ;
-      value = ((buffer [0] & 0x3F) << 8) | buffer [1] ;
-      break ;
-
-    case MCP3422_SR_240:			// 12 bits
-      delay (  5) ;
-      read (node->fd, buffer, 3) ;
-      value = ((buffer [0] & 0x0F) << 8) | buffer [0] ;
-      break ;
+    pthread_mutex_lock (&state->lock) ;
+      value = state->value [chan] ;
+    pthread_mutex_unlock (&state->lock) ;
+    return value ;
   }
 
+// One-shot mode, trigger plus the other configs. This takes the chip
+//	out of continuous mode, so have the multiplexer put it back.
+
+  pthread_mutex_lock (&state->lock) ;
+    ++state->oneShots ;
+  pthread_mutex_unlock (&state->lock) ;
+
+  pthread_mutex_lock (&state->busLock) ;
+    wiringPiI2CWrite (node->fd, MCP3422_RDY | (chan << 5) | (node->data0 << 2) | node->data1) ;
+    (void)waitResult (node, chan, &value) ;
+    state->muxChan = -1 ;
+  pthread_mutex_unlock (&state->busLock) ;
+
+  pthread_mutex_lock (&state->lock) ;
+    --state->oneShots ;
+  pthread_mutex_unlock (&state->lock) ;
+
   return value ;
 }
 
 
+/*
+ * mcp3422Continuous:
+ *	Start the background multiplexer on the channels in chanMask (bit 0
+ *	is pinBase) or stop it with a mask of 0. pin is any pin on the chip.
+ *********************************************************************************
+ */
+
+int mcp3422Continuous (int pin, int chanMask)
+{
+  struct wiringPiNodeStruct *node ;
+  struct mcp3422State *state ;
+
+  if (((node = wiringPiFindNode (pin)) == NULL) || (node->analogRead != myAnalogRead))
+    return -1 ;
+
+  state = (struct mcp3422State *)node->extra ;
+
+  if (state->running)
+  {
+    state->running = FALSE ;
+    pthread_join (state->thread, NULL) ;
+  }
+
+  chanMask &= 0x0F ;
+  if (chanMask == 0)
+    return 0 ;
+
+  pthread_mutex_lock (&state->lock) ;
+    state->chanMask = chanMask ;
+    memset (state->time, 0, sizeof (state->time)) ;
+  pthread_mutex_unlock (&state->lock) ;
+
+  state->muxChan = -1 ;
+
+  state->running = TRUE ;
+  if (pthread_create (&state->thread, NULL, muxThread, node) != 0)
+  {
+    state->running = FALSE ;
+    return wiringPiFailure (WPI_ALMOST, "mcp3422Continuous: Unable to start thread: %s\n", strerror (errno)) ;
+  }
+
+  return 0 ;
+}
+
+
+/*
+ * mcp3422ReadLatest:
+ *	Non-blocking read of the last result the multiplexer got for pin,
+ *	and how old it is in uS. Returns -1 if there isn't one yet.
+ *********************************************************************************
+ */
+
+int mcp3422ReadLatest (int pin, int *value, unsigned int *ageUs)
+{
+  struct wiringPiNodeStruct *node ;
+  struct mcp3422State *state ;
+  unsigned long long time ;
+  int chan ;
+
+  if (((node = wiringPiFindNode (pin)) == NULL) || (node->analogRead != myAnalogRead))
+    return -1 ;
+
+  state = (struct mcp3422State *)node->extra ;
+  chan  = pin - node->pinBase ;
+
+  pthread_mutex_lock (&state->lock) ;
+    time   = state->time  [chan] ;
+    *value = state->value [chan] ;
+  pthread_mutex_unlock (&state->lock) ;
+
+  if (time == 0)
+    return -1 ;
+
+  if (ageUs != NULL)
+    *ageUs = (unsigned int)((nowNs () - time) / 1000) ;
+
+  return 0 ;
+}
+
+
 /*
  * mcp3422Setup:
  *	Create a new wiringPi device node for the mcp3422
@@ -96,14 +352,23 @@ int mcp3422Setup (int pinBase, int i2cAddress, int sampleRate, int gain)
 {
   int fd ;
   struct wiringPiNodeStruct *node ;
+  struct mcp3422State *state ;
 
-  if ((fd = wiringPiI2CSetup (i2cAddress)) < 0)
+  if ((fd = wiringPiI2CSetupShared (i2cAddress)) < 0)
     return fd ;
 
+  if ((state = (struct mcp3422State *)calloc (1, sizeof (struct mcp3422State))) == NULL)
+    return wiringPiFailure (WPI_ALMOST, "mcp3422Setup: Unable to allocate memory: %s\n", strerror (errno)) ;
+
+  pthread_mutex_init (&state->lock,    NULL) ;
+  pthread_mutex_init (&state->busLock, NULL) ;
+
   node = wiringPiNewNode (pinBase, 4) ;
 
-  node->data0      = sampleRate ;
-  node->data1      = gain ;
+  node->fd         = fd ;
+  node->data0      = sampleRate & 3 ;
+  node->data1      = gain & 3 ;
+  node->extra      = state ;
   node->analogRead = myAnalogRead ;
 
   return 0 ;
@@ -36,7 +36,9 @@
 extern "C" {
 #endif
 
-extern int mcp3422Setup (int pinBase, int i2cAddress, int sampleRate, int gain) ;
+extern int mcp3422Setup       (int pinBase, int i2cAddress, int sampleRate, int gain) ;
+extern int mcp3422Continuous  (int pin, int chanMask) ;
+extern int mcp3422ReadLatest  (int pin, int *value, unsigned int *ageUs) ;
 
 #ifdef __cplusplus
 }
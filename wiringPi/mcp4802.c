@@ -53,6 +53,36 @@ static void myAnalogWrite (struct wiringPiNodeStruct *node, int pin, int value)
   wiringPiSPIDataRW (node->fd, spiData, 2) ;
 }
 
+/*
+ * myAnalogWriteMulti:
+ *	Write a list of values, one chained SPI message per 16 - the DAC
+ *	latches each one as its chip select goes high.
+ *********************************************************************************
+ */
+
+static void myAnalogWriteMulti (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count)
+{
+  unsigned char spiData [2 * 16] ;
+  int i, n ;
+
+  while (count > 0)
+  {
+    n = (count > 16) ? 16 : count ;
+
+    for (i = 0 ; i < n ; ++i)
+    {
+      spiData [i * 2 + 0] = ((pins [i] == node->pinBase) ? 0x30 : 0xB0) | ((values [i] >> 4) & 0x0F) ;
+      spiData [i * 2 + 1] = ((values [i] << 4) & 0xF0) ;
+    }
+
+    wiringPiSPIDataRWChain (node->fd, spiData, 2, n) ;
+
+    pins   += n ;
+    values += n ;
+    count  -= n ;
+  }
+}
+
 /*
  * mcp4802Setup:
  *	Create a new wiringPi device node for an mcp4802 on the Pi's
@@ -70,7 +100,8 @@ int mcp4802Setup (const int pinBase, int spiChannel)
   node = wiringPiNewNode (pinBase, 2) ;
 
   node->fd          = spiChannel ;
-  node->analogWrite = myAnalogWrite ;
+  node->analogWrite      = myAnalogWrite ;
+  node->analogWriteMulti = myAnalogWriteMulti ;
 
   return 0 ;
 }
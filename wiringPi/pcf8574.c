@@ -30,6 +30,11 @@
 
 #include "pcf8574.h"
 
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
 
 /*
  * myPinMode:
@@ -51,8 +56,12 @@ static void myPinMode (struct wiringPiNodeStruct *node, int pin, int mode)
   else
     old |=   bit ;	// Write bit to 1
 
-  wiringPiI2CWrite (node->fd, old) ;
   node->data2 = old ;
+
+  if (node->deferred)
+    node->dirty = TRUE ;
+  else
+    wiringPiI2CWrite (node->fd, old) ;
 }
 
 
@@ -74,8 +83,12 @@ static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
   else
     old |=   bit ;
 
-  wiringPiI2CWrite (node->fd, old) ;
   node->data2 = old ;
+
+  if (node->deferred)
+    node->dirty = TRUE ;
+  else
+    wiringPiI2CWrite (node->fd, old) ;
 }
 
 
@@ -98,6 +111,44 @@ static int myDigitalRead (struct wiringPiNodeStruct *node, int pin)
 }
 
 
+/*
+ * myDigitalReadPort: myDigitalWritePort:
+ *	All 8 pins in one I2C transfer
+ *********************************************************************************
+ */
+
+static unsigned int myDigitalReadPort (struct wiringPiNodeStruct *node)
+{
+  return wiringPiI2CRead (node->fd) & 0xFF ;
+}
+
+static void myDigitalWritePort (struct wiringPiNodeStruct *node, unsigned int value, unsigned int mask)
+{
+  int old ;
+
+  old = (node->data2 & ~mask) | (value & mask) ;
+
+  node->data2 = old ;
+
+  if (node->deferred)
+    node->dirty = TRUE ;
+  else
+    wiringPiI2CWrite (node->fd, old) ;
+}
+
+
+/*
+ * myCommit:
+ *	Send the changes held back since wiringPiBegin ()
+ *********************************************************************************
+ */
+
+static void myCommit (struct wiringPiNodeStruct *node)
+{
+  wiringPiI2CWrite (node->fd, node->data2) ;
+}
+
+
 /*
  * pcf8574Setup:
  *	Create a new instance of a PCF8574 I2C GPIO interface. We know it
@@ -111,16 +162,21 @@ int pcf8574Setup (const int pinBase, const int i2cAddress)
   int fd ;
   struct wiringPiNodeStruct *node ;
 
-  if ((fd = wiringPiI2CSetup (i2cAddress)) < 0)
+  if ((fd = wiringPiI2CSetupShared (i2cAddress)) < 0)
     return fd ;
 
   node = wiringPiNewNode (pinBase, 8) ;
 
-  node->fd           = fd ;
-  node->pinMode      = myPinMode ;
-  node->digitalRead  = myDigitalRead ;
-  node->digitalWrite = myDigitalWrite ;
-  node->data2        = wiringPiI2CRead (fd) ;
+  node->fd                = fd ;
+  node->pinMode           = myPinMode ;
+  node->digitalRead       = myDigitalRead ;
+  node->digitalWrite      = myDigitalWrite ;
+  node->digitalReadPort   = myDigitalReadPort ;
+  node->digitalWritePort  = myDigitalWritePort ;
+  node->digitalReadMulti  = wiringPiNodeReadMultiPort ;
+  node->digitalWriteMulti = wiringPiNodeWriteMultiPort ;
+  node->commit            = myCommit ;
+  node->data2             = wiringPiI2CRead (fd) ;
 
   return 0 ;
 }
@@ -23,8 +23,6 @@
  ***********************************************************************
  */
 
-#include <unistd.h>
-
 #include "wiringPi.h"
 #include "wiringPiI2C.h"
 
@@ -38,10 +36,10 @@
 
 static void myAnalogWrite (struct wiringPiNodeStruct *node, int pin, int value)
 {
-  unsigned char b [2] ;
+  uint8_t b [2] ;
   b [0] = 0x40 ;
   b [1] = value & 0xFF ;
-  write (node->fd, b, 2) ;
+  wiringPiI2CWriteRaw (node->fd, b, 2) ;
 }
 
 
@@ -77,7 +75,7 @@ int pcf8591Setup (const int pinBase, const int i2cAddress)
   int fd ;
   struct wiringPiNodeStruct *node ;
 
-  if ((fd = wiringPiI2CSetup (i2cAddress)) < 0)
+  if ((fd = wiringPiI2CSetupShared (i2cAddress)) < 0)
     return fd ;
 
   node = wiringPiNewNode (pinBase, 4) ;
@@ -22,11 +22,40 @@
  ***********************************************************************
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
 #include <wiringPi.h>
 #include <wiringPiI2C.h>
 
 #include "sn3218.h"
 
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
+#define	SN3218_LEDS	18
+
+// node->extra points to a copy of the 18 PWM registers. Between
+//	wiringPiBegin () and wiringPiCommit () writes only change the
+//	copy, and the commit sends the lot in one block write.
+
+/*
+ * sendFrame:
+ *	All 18 PWM registers (they auto-increment from 0x01), then the
+ *	update register to latch them.
+ *********************************************************************************
+ */
+
+static void sendFrame (struct wiringPiNodeStruct *node)
+{
+  wiringPiI2CWriteBlock (node->fd, 0x01, (uint8_t *)node->extra, SN3218_LEDS) ;
+  wiringPiI2CWriteReg8  (node->fd, 0x16, 0x00) ;
+}
+
+
 /*
  * myAnalogWrite:
  *	Write analog value on the given pin
@@ -35,13 +64,55 @@
 
 static void myAnalogWrite (struct wiringPiNodeStruct *node, int pin, int value)
 {
+  uint8_t *frame = (uint8_t *)node->extra ;
   int fd   = node->fd ;
-  int chan = 0x01 + (pin - node->pinBase) ;
+  int chan = pin - node->pinBase ;
+
+  frame [chan] = value & 0xFF ;
+
+  if (node->deferred)
+  {
+    node->dirty = TRUE ;
+    return ;
+  }
   
-  wiringPiI2CWriteReg8 (fd, chan, value & 0xFF) ;	// Value
+  wiringPiI2CWriteReg8 (fd, 0x01 + chan, value & 0xFF) ;	// Value
   wiringPiI2CWriteReg8 (fd, 0x16, 0x00) ;		// Update
 }
 
+
+/*
+ * myAnalogWriteMulti:
+ *	Several LEDs at once - one burst for the whole frame
+ *********************************************************************************
+ */
+
+static void myAnalogWriteMulti (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count)
+{
+  uint8_t *frame = (uint8_t *)node->extra ;
+  int i ;
+
+  for (i = 0 ; i < count ; ++i)
+    frame [pins [i] - node->pinBase] = values [i] & 0xFF ;
+
+  if (node->deferred)
+    node->dirty = TRUE ;
+  else
+    sendFrame (node) ;
+}
+
+
+/*
+ * myCommit:
+ *	Send the frame built up since wiringPiBegin ()
+ *********************************************************************************
+ */
+
+static void myCommit (struct wiringPiNodeStruct *node)
+{
+  sendFrame (node) ;
+}
+
 /*
  * sn3218Setup:
  *	Create a new wiringPi device node for an sn3218 on the Pi's
@@ -53,23 +124,32 @@ int sn3218Setup (const int pinBase)
 {
   int fd ;
   struct wiringPiNodeStruct *node ;
+  uint8_t *frame ;
+  static const uint8_t enable [3] = { 0x3F, 0x3F, 0x3F } ;
 
-  if ((fd = wiringPiI2CSetup (0x54)) < 0)
+  if ((fd = wiringPiI2CSetupShared (0x54)) < 0)
     return fd ;
 
+  if ((frame = (uint8_t *)calloc (SN3218_LEDS, 1)) == NULL)
+    return wiringPiFailure (WPI_ALMOST, "sn3218Setup: Unable to allocate memory: %s\n", strerror (errno)) ;
+
 // Setup the chip - initialise all 18 LEDs to off
+//	The register address auto-increments, so the 3 LED control
+//	registers can go in one block write
 
 //wiringPiI2CWriteReg8 (fd, 0x17, 0) ;		// Reset
-  wiringPiI2CWriteReg8 (fd, 0x00, 1) ;		// Not Shutdown
-  wiringPiI2CWriteReg8 (fd, 0x13, 0x3F) ;	// Enable LEDs  0- 5
-  wiringPiI2CWriteReg8 (fd, 0x14, 0x3F) ;	// Enable LEDs  6-11
-  wiringPiI2CWriteReg8 (fd, 0x15, 0x3F) ;	// Enable LEDs 12-17
-  wiringPiI2CWriteReg8 (fd, 0x16, 0x00) ;	// Update
+  wiringPiI2CWriteReg8  (fd, 0x00, 1) ;		// Not Shutdown
+  wiringPiI2CWriteBlock (fd, 0x13, enable, 3) ;	// Enable LEDs 0-17
   
-  node = wiringPiNewNode (pinBase, 18) ;
+  node = wiringPiNewNode (pinBase, SN3218_LEDS) ;
+
+  node->fd               = fd ;
+  node->extra            = frame ;
+  node->analogWrite      = myAnalogWrite ;
+  node->analogWriteMulti = myAnalogWriteMulti ;
+  node->commit           = myCommit ;
 
-  node->fd          = fd ;
-  node->analogWrite = myAnalogWrite ;
+  sendFrame (node) ;				// All off
 
   return 0 ;
 }
@@ -5,6 +5,7 @@
  *	Note that the code can cope with a number of 595's
  *	daisy-chained together - up to 4 for now as we're storing
  *	the output "register" in a single unsigned int.
+ *	The SPI version has no such limit.
  *
  *	Copyright (c) 2013 Gordon Henderson
  ***********************************************************************
@@ -29,39 +30,38 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 
 #include "wiringPi.h"
+#include "wiringPiSPI.h"
 
 #include "sr595.h"
 
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
 
 /*
- * myDigitalWrite:
+ * shiftOutput:
+ *	Clock the whole output register out to the chain and latch it
  *********************************************************************************
  */
 
-static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
+static void shiftOutput (struct wiringPiNodeStruct *node)
 {
-  unsigned int mask ;
   int  dataPin, clockPin, latchPin ;
   int  bit, bits, output ;
 
-  pin     -= node->pinBase ;				// Normalise pin number
   bits     = node->pinMax - node->pinBase + 1 ;		// ie. number of clock pulses
   dataPin  = node->data0 ;
   clockPin = node->data1 ;
   latchPin = node->data2 ;
   output   = node->data3 ;
 
-  mask = 1 << pin ;
-
-  if (value == LOW)
-    output &= (~mask) ;
-  else
-    output |=   mask ;
-
-  node->data3 = output ;
-
 // A low -> high latch transition copies the latch to the output pins
 
   digitalWrite (latchPin, LOW) ; delayMicroseconds (1) ;
@@ -76,6 +76,78 @@ static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
 }
 
 
+/*
+ * myDigitalWrite:
+ *********************************************************************************
+ */
+
+static void myDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
+{
+  unsigned int mask ;
+
+  mask = 1 << (pin - node->pinBase) ;
+
+  if (value == LOW)
+    node->data3 &= (~mask) ;
+  else
+    node->data3 |=   mask ;
+
+  if (node->deferred)
+    node->dirty = TRUE ;
+  else
+    shiftOutput (node) ;
+}
+
+
+/*
+ * myDigitalWritePort: myDigitalWriteMulti:
+ *	Change any number of outputs for the cost of one shift sequence
+ *********************************************************************************
+ */
+
+static void myDigitalWritePort (struct wiringPiNodeStruct *node, unsigned int value, unsigned int mask)
+{
+  node->data3 = (node->data3 & ~mask) | (value & mask) ;
+  if (node->deferred)
+    node->dirty = TRUE ;
+  else
+    shiftOutput (node) ;
+}
+
+static void myDigitalWriteMulti (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count)
+{
+  unsigned int mask ;
+  int i ;
+
+  for (i = 0 ; i < count ; ++i)
+  {
+    mask = 1 << (pins [i] - node->pinBase) ;
+
+    if (values [i] == LOW)
+      node->data3 &= (~mask) ;
+    else
+      node->data3 |=   mask ;
+  }
+
+  if (node->deferred)
+    node->dirty = TRUE ;
+  else
+    shiftOutput (node) ;
+}
+
+
+/*
+ * myCommit:
+ *	Send the changes held back since wiringPiBegin ()
+ *********************************************************************************
+ */
+
+static void myCommit (struct wiringPiNodeStruct *node)
+{
+  shiftOutput (node) ;
+}
+
+
 /*
  * sr595Setup:
  *	Create a new instance of a 74x595 shift register GPIO expander.
@@ -89,11 +161,14 @@ int sr595Setup (const int pinBase, const int numPins,
 
   node = wiringPiNewNode (pinBase, numPins) ;
 
-  node->data0           = dataPin ;
-  node->data1           = clockPin ;
-  node->data2           = latchPin ;
-  node->data3           = 0 ;		// Output register
-  node->digitalWrite    = myDigitalWrite ;
+  node->data0             = dataPin ;
+  node->data1             = clockPin ;
+  node->data2             = latchPin ;
+  node->data3             = 0 ;		// Output register
+  node->digitalWrite      = myDigitalWrite ;
+  node->digitalWritePort  = myDigitalWritePort ;
+  node->digitalWriteMulti = myDigitalWriteMulti ;
+  node->commit            = myCommit ;
 
 // Initialise the underlying hardware
 
@@ -107,3 +182,186 @@ int sr595Setup (const int pinBase, const int numPins,
 
   return 0 ;
 }
+
+
+/*
+ * SPI version:
+ *	The data and clock lines of the chain go to the Pi's MOSI and SCLK
+ *	and the whole chain is shifted out by the SPI hardware in one transfer.
+ *	The latch (RCLK) can go to the SPI chip select - it rises at the end
+ *	of the transfer, which is just what the 595 wants - or to any GPIO.
+ *	The output register lives in node->extra so the chain can be any length.
+ *********************************************************************************
+ */
+
+struct sr595Spi
+{
+  int            channel ;
+  int            latchPin ;	// -1 to latch on the SPI CS line
+  int            bytes ;
+  unsigned char *shadow ;	// Byte 0 holds pins 0-7
+  unsigned char *tx ;
+} ;
+
+
+/*
+ * spiShiftOutput:
+ *	The last chip in the chain needs its bits first, so send the
+ *	shadow backwards.
+ *********************************************************************************
+ */
+
+static void spiShiftOutput (struct wiringPiNodeStruct *node)
+{
+  struct sr595Spi *sr = (struct sr595Spi *)node->extra ;
+  int i ;
+
+  for (i = 0 ; i < sr->bytes ; ++i)
+    sr->tx [i] = sr->shadow [sr->bytes - 1 - i] ;
+
+  if (sr->latchPin != -1)
+    digitalWrite (sr->latchPin, LOW) ;
+
+  wiringPiSPIDataRW (sr->channel, sr->tx, sr->bytes) ;
+
+  if (sr->latchPin != -1)
+    digitalWrite (sr->latchPin, HIGH) ;
+}
+
+
+/*
+ * spiSetBit:
+ *********************************************************************************
+ */
+
+static void spiSetBit (struct wiringPiNodeStruct *node, int pin, int value)
+{
+  struct sr595Spi *sr = (struct sr595Spi *)node->extra ;
+
+  pin -= node->pinBase ;
+
+  if (value == LOW)
+    sr->shadow [pin >> 3] &= ~(1 << (pin & 7)) ;
+  else
+    sr->shadow [pin >> 3] |=   1 << (pin & 7) ;
+}
+
+
+/*
+ * spiFlush:
+ *	Shift out now, or leave it for wiringPiCommit ()
+ *********************************************************************************
+ */
+
+static void spiFlush (struct wiringPiNodeStruct *node)
+{
+  if (node->deferred)
+    node->dirty = TRUE ;
+  else
+    spiShiftOutput (node) ;
+}
+
+
+/*
+ * mySpiDigitalWrite: mySpiDigitalWritePort: mySpiDigitalWriteMulti:
+ *********************************************************************************
+ */
+
+static void mySpiDigitalWrite (struct wiringPiNodeStruct *node, int pin, int value)
+{
+  spiSetBit (node, pin, value) ;
+  spiFlush  (node) ;
+}
+
+static void mySpiDigitalWritePort (struct wiringPiNodeStruct *node, unsigned int value, unsigned int mask)
+{
+  struct sr595Spi *sr = (struct sr595Spi *)node->extra ;
+  int i ;
+
+  for (i = 0 ; (i < 4) && (i < sr->bytes) ; ++i)
+    sr->shadow [i] = (sr->shadow [i] & ~(mask >> (i * 8))) | ((value & mask) >> (i * 8)) ;
+
+  spiFlush (node) ;
+}
+
+static void mySpiDigitalWriteMulti (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count)
+{
+  int i ;
+
+  for (i = 0 ; i < count ; ++i)
+    spiSetBit (node, pins [i], values [i]) ;
+
+  spiFlush (node) ;
+}
+
+
+/*
+ * mySpiDigitalRead:
+ *	The 595 can't be read, but we can return what we last wrote
+ *********************************************************************************
+ */
+
+static int mySpiDigitalRead (struct wiringPiNodeStruct *node, int pin)
+{
+  struct sr595Spi *sr = (struct sr595Spi *)node->extra ;
+
+  pin -= node->pinBase ;
+
+  return (sr->shadow [pin >> 3] >> (pin & 7)) & 1 ;
+}
+
+
+/*
+ * sr595SpiSetup:
+ *	Create a new instance of a chain of 74x595 shift registers driven
+ *	by the SPI hardware. latchPin is -1 if the latch is on the chip
+ *	select line for spiChannel.
+ *********************************************************************************
+ */
+
+int sr595SpiSetup (const int pinBase, const int numPins,
+	const int spiChannel, const int speed, const int latchPin)
+{
+  struct wiringPiNodeStruct *node ;
+  struct sr595Spi *sr ;
+  int x ;
+
+  if ((x = wiringPiSPISetup (spiChannel, speed)) < 0)
+    return x ;
+
+  if ((sr = (struct sr595Spi *)calloc (1, sizeof (struct sr595Spi))) == NULL)
+    return wiringPiFailure (WPI_ALMOST, "sr595SpiSetup: Unable to allocate memory: %s\n", strerror (errno)) ;
+
+  sr->channel  = spiChannel ;
+  sr->latchPin = latchPin ;
+  sr->bytes    = (numPins + 7) / 8 ;
+  sr->shadow   = (unsigned char *)calloc (2, sr->bytes) ;
+
+  if (sr->shadow == NULL)
+  {
+    free (sr) ;
+    return wiringPiFailure (WPI_ALMOST, "sr595SpiSetup: Unable to allocate memory: %s\n", strerror (errno)) ;
+  }
+  sr->tx = sr->shadow + sr->bytes ;
+
+  if (latchPin != -1)
+  {
+    digitalWrite (latchPin, HIGH) ;
+    pinMode      (latchPin, OUTPUT) ;
+  }
+
+  node = wiringPiNewNode (pinBase, numPins) ;
+
+  node->extra             = sr ;
+  node->digitalRead       = mySpiDigitalRead ;
+  node->digitalWrite      = mySpiDigitalWrite ;
+  node->digitalWritePort  = mySpiDigitalWritePort ;
+  node->digitalWriteMulti = mySpiDigitalWriteMulti ;
+  node->commit            = spiShiftOutput ;
+
+// Start with all outputs off
+
+  spiShiftOutput (node) ;
+
+  return 0 ;
+}
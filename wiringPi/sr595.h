@@ -29,6 +29,9 @@ extern "C" {
 extern int sr595Setup (const int pinBase, const int numPins,
 	const int dataPin, const int clockPin, const int latchPin) ;
 
+extern int sr595SpiSetup (const int pinBase, const int numPins,
+	const int spiChannel, const int speed, const int latchPin) ;
+
 #ifdef __cplusplus
 }
 #endif
@@ -188,6 +188,13 @@ struct wiringPiNodeStruct *wiringPiNodes = NULL;
 // Locals to hold pointers to the hardware
 
 static volatile uint32_t *gpio;
+
+// Shadow of the GPIO data registers for the bank write functions
+
+#define SUNXI_GPIO_BANKS 9
+
+static uint32_t bankShadow[SUNXI_GPIO_BANKS];
+static unsigned int bankShadowValid;
 static volatile uint32_t *pwm;
 static volatile uint32_t *clk;
 static volatile uint32_t *pads;
@@ -747,6 +754,7 @@ void sunxi_digitalWrite(int pin, int value) {
             if (wiringPiDebug)
                 printf("HIGH val set over reg val: 0x%x\n", regval);
         }
+        bankShadow[bank] = regval;
     } else {
         printf("pin number error\n");
     }
@@ -1199,6 +1207,89 @@ static void analogWriteDummy(struct wiringPiNodeStruct *node, int pin, int value
     return;
 }
 
+static unsigned int digitalReadPortDefault(struct wiringPiNodeStruct *node) {
+    unsigned int value = 0;
+    int pin;
+
+    for (pin = node->pinBase; (pin <= node->pinMax) && (pin < node->pinBase + 32); ++pin)
+        if (node->digitalRead(node, pin) != LOW)
+            value |= 1u << (pin - node->pinBase);
+
+    return value;
+}
+
+static void digitalWritePortDefault(struct wiringPiNodeStruct *node, unsigned int value, unsigned int mask) {
+    int pin;
+
+    for (pin = node->pinBase; (pin <= node->pinMax) && (pin < node->pinBase + 32); ++pin)
+        if (mask & (1u << (pin - node->pinBase)))
+            node->digitalWrite(node, pin, (value >> (pin - node->pinBase)) & 1);
+}
+
+static void digitalReadMultiDefault(struct wiringPiNodeStruct *node, const int *pins, int *values, int count) {
+    int i;
+
+    for (i = 0; i < count; ++i)
+        values[i] = node->digitalRead(node, pins[i]);
+}
+
+static void digitalWriteMultiDefault(struct wiringPiNodeStruct *node, const int *pins, const int *values, int count) {
+    int i;
+
+    for (i = 0; i < count; ++i)
+        node->digitalWrite(node, pins[i], values[i]);
+}
+
+static void analogReadMultiDefault(struct wiringPiNodeStruct *node, const int *pins, int *values, int count) {
+    int i;
+
+    for (i = 0; i < count; ++i)
+        values[i] = node->analogRead(node, pins[i]);
+}
+
+static void analogWriteMultiDefault(struct wiringPiNodeStruct *node, const int *pins, const int *values, int count) {
+    int i;
+
+    for (i = 0; i < count; ++i)
+        node->analogWrite(node, pins[i], values[i]);
+}
+
+static void commitDummy(struct wiringPiNodeStruct *node) {
+    return;
+}
+
+/*
+ * wiringPiNodeReadMultiPort: wiringPiNodeWriteMultiPort:
+ *	Multi-pin hooks for devices whose digitalReadPort/digitalWritePort
+ *	do the whole device in one transfer - drivers can plug these in
+ *	rather than writing their own.
+ *********************************************************************************
+ */
+
+void wiringPiNodeReadMultiPort(struct wiringPiNodeStruct *node, const int *pins, int *values, int count) {
+    unsigned int port = node->digitalReadPort(node);
+    int i;
+
+    for (i = 0; i < count; ++i)
+        values[i] = (port >> (pins[i] - node->pinBase)) & 1;
+}
+
+void wiringPiNodeWriteMultiPort(struct wiringPiNodeStruct *node, const int *pins, const int *values, int count) {
+    unsigned int value = 0, mask = 0, bit;
+    int i;
+
+    for (i = 0; i < count; ++i) {
+        bit = 1u << (pins[i] - node->pinBase);
+        mask |= bit;
+        if (values[i] != LOW)
+            value |= bit;
+        else
+            value &= ~bit;
+    }
+
+    node->digitalWritePort(node, value, mask);
+}
+
 struct wiringPiNodeStruct *wiringPiNewNode(int pinBase, int numPins) {
     int pin;
     struct wiringPiNodeStruct *node;
@@ -1227,6 +1318,13 @@ struct wiringPiNodeStruct *wiringPiNewNode(int pinBase, int numPins) {
     node->pwmWrite = pwmWriteDummy;
     node->analogRead = analogReadDummy;
     node->analogWrite = analogWriteDummy;
+    node->digitalReadPort = digitalReadPortDefault;
+    node->digitalWritePort = digitalWritePortDefault;
+    node->digitalReadMulti = digitalReadMultiDefault;
+    node->digitalWriteMulti = digitalWriteMultiDefault;
+    node->analogReadMulti = analogReadMultiDefault;
+    node->analogWriteMulti = analogWriteMultiDefault;
+    node->commit = commitDummy;
     node->next = wiringPiNodes;
     wiringPiNodes = node;
 
@@ -1559,6 +1657,183 @@ void analogWrite(int pin, int value) {
     node->analogWrite(node, pin, value);
 }
 
+/*
+ * digitalReadPort:
+ *	Read all the pins of the extension node that pin belongs to in
+ *	one go. Bit 0 of the result is the node's pinBase. Devices that
+ *	support it do this in a single bus transaction.
+ *********************************************************************************
+ */
+
+unsigned int digitalReadPort(int pin) {
+    struct wiringPiNodeStruct *node;
+
+    if ((node = wiringPiFindNode(pin)) == NULL)
+        return 0;
+
+    return node->digitalReadPort(node);
+}
+
+/*
+ * digitalWritePort:
+ *	Set the pins selected by mask on the extension node that pin
+ *	belongs to. Bit 0 is the node's pinBase.
+ *********************************************************************************
+ */
+
+void digitalWritePort(int pin, unsigned int value, unsigned int mask) {
+    struct wiringPiNodeStruct *node;
+
+    if ((node = wiringPiFindNode(pin)) == NULL)
+        return;
+
+    node->digitalWritePort(node, value, mask);
+}
+
+/*
+ * multiDispatch:
+ *	Split a list of pins up by node and hand each node its share in one
+ *	call, so devices that can do a batch in one transfer get the chance.
+ *	On-board pins are done one at a time. Pins on different nodes are not
+ *	necessarily done in the order given.
+ *********************************************************************************
+ */
+
+#define MULTI_WRITE 0
+#define MULTI_READ 1
+#define MULTI_ANALOG 2
+#define MULTI_ANALOG_WRITE 3
+
+static void multiDispatch(int type, const int *pins, int *values, int count) {
+    int stackBuf[3 * 64];
+    unsigned char stackDone[64];
+    int *buf, *nodePins, *nodeValues, *nodeIndex;
+    unsigned char *done;
+    struct wiringPiNodeStruct *node;
+    int i, j, n;
+
+    if (count <= 0)
+        return;
+
+    if (count <= 64) {
+        buf = stackBuf;
+        done = stackDone;
+    } else if ((buf = (int *) malloc(3 * count * sizeof (int) + count)) == NULL)
+        return;
+    else
+        done = (unsigned char *) (buf + 3 * count);
+
+    nodePins = buf;
+    nodeValues = buf + count;
+    nodeIndex = buf + 2 * count;
+    memset(done, 0, count);
+
+    for (i = 0; i < count; ++i) {
+        if (done[i])
+            continue;
+
+        if ((node = wiringPiFindNode(pins[i])) == NULL) {
+            if (type == MULTI_WRITE)
+                digitalWrite(pins[i], values[i]);
+            else if (type == MULTI_ANALOG_WRITE)
+                analogWrite(pins[i], values[i]);
+            else if (type == MULTI_READ)
+                values[i] = digitalRead(pins[i]);
+            else
+                values[i] = analogRead(pins[i]);
+            done[i] = 1;
+            continue;
+        }
+
+        for (n = 0, j = i; j < count; ++j)
+            if (!done[j] && (pins[j] >= node->pinBase) && (pins[j] <= node->pinMax)) {
+                done[j] = 1;
+                nodePins[n] = pins[j];
+                nodeValues[n] = (type == MULTI_WRITE || type == MULTI_ANALOG_WRITE) ? values[j] : 0;
+                nodeIndex[n] = j;
+                ++n;
+            }
+
+        if (type == MULTI_WRITE)
+            node->digitalWriteMulti(node, nodePins, nodeValues, n);
+        else if (type == MULTI_ANALOG_WRITE)
+            node->analogWriteMulti(node, nodePins, nodeValues, n);
+        else {
+            if (type == MULTI_READ)
+                node->digitalReadMulti(node, nodePins, nodeValues, n);
+            else
+                node->analogReadMulti(node, nodePins, nodeValues, n);
+            for (j = 0; j < n; ++j)
+                values[nodeIndex[j]] = nodeValues[j];
+        }
+    }
+
+    if (buf != stackBuf)
+        free(buf);
+}
+
+/*
+ * digitalReadMulti: digitalWriteMulti: analogReadMulti: analogWriteMulti:
+ *	Read or write a list of pins, batching them per device
+ *********************************************************************************
+ */
+
+void digitalReadMulti(const int *pins, int *values, int count) {
+    multiDispatch(MULTI_READ, pins, values, count);
+}
+
+void digitalWriteMulti(const int *pins, const int *values, int count) {
+    multiDispatch(MULTI_WRITE, pins, (int *) values, count);
+}
+
+void analogReadMulti(const int *pins, int *values, int count) {
+    multiDispatch(MULTI_ANALOG, pins, values, count);
+}
+
+void analogWriteMulti(const int *pins, const int *values, int count) {
+    multiDispatch(MULTI_ANALOG_WRITE, pins, (int *) values, count);
+}
+
+/*
+ * wiringPiBegin: wiringPiCommit:
+ *	Write combining for extension nodes. Between wiringPiBegin and the
+ *	matching wiringPiCommit, output changes on a node only update its
+ *	shadow copy; the commit then sends them to the device in one bus
+ *	transfer or shift sequence. pin is any pin on the node, or -1 for
+ *	every node. Calls may be nested - the outermost commit flushes.
+ *********************************************************************************
+ */
+
+void wiringPiBegin(int pin) {
+    struct wiringPiNodeStruct *node;
+
+    if (pin == -1) {
+        for (node = wiringPiNodes; node != NULL; node = node->next)
+            ++node->deferred;
+    } else if ((node = wiringPiFindNode(pin)) != NULL)
+        ++node->deferred;
+}
+
+static void commitNode(struct wiringPiNodeStruct *node) {
+    if (node->deferred == 0)
+        return;
+
+    if ((--node->deferred == 0) && node->dirty) {
+        node->dirty = FALSE;
+        node->commit(node);
+    }
+}
+
+void wiringPiCommit(int pin) {
+    struct wiringPiNodeStruct *node;
+
+    if (pin == -1) {
+        for (node = wiringPiNodes; node != NULL; node = node->next)
+            commitNode(node);
+    } else if ((node = wiringPiFindNode(pin)) != NULL)
+        commitNode(node);
+}
+
 /*
  * pwmToneWrite:
  *	Pi Specific.
@@ -1580,6 +1855,80 @@ void pwmToneWrite(int pin, int freq) {
 
 
 
+/*
+ * wiringPiPinToBank:
+ *	Resolve an on-board pin (in the current numbering mode) to its GPIO
+ *	bank and the bit mask within that bank's data register. Returns 0,
+ *	or -1 if the pin isn't on-board or we're in sys mode and can't get
+ *	at the registers.
+ *********************************************************************************
+ */
+
+int wiringPiPinToBank(int pin, int *bank, unsigned int *mask) {
+    if ((pin & PI_GPIO_MASK) != 0)
+        return -1;
+
+    if (wiringPiMode == WPI_MODE_PINS)
+        pin = pinToGpio [pin];
+    else if (wiringPiMode == WPI_MODE_PHYS)
+        pin = physToGpio[pin];
+    else if (wiringPiMode == WPI_MODE_GPIO)
+        pin = pinTobcm[pin];
+    else
+        return -1;
+
+    if ((pin < 0) || ((pin >> 5) >= SUNXI_GPIO_BANKS) || (BP_PIN_MASK[pin >> 5][pin & 31] == -1))
+        return -1;
+
+    *bank = pin >> 5;
+    *mask = 1u << (pin & 31);
+
+    return 0;
+}
+
+/*
+ * digitalReadBank: digitalWriteBank:
+ *	Read or write a whole GPIO data register in one access. Writes go
+ *	via a shadow copy so setting some bits doesn't need a read first;
+ *	the shadow is refreshed by every digitalReadBank, so call that once
+ *	before a burst of writes if something else may have changed the bank.
+ *	Both need the registers mapped, so do nothing (and read 0) before
+ *	setup, in sys mode, or for a bank that doesn't exist.
+ *********************************************************************************
+ */
+
+static int bankUsable(int bank) {
+    if ((bank < 0) || (bank >= SUNXI_GPIO_BANKS))
+        return FALSE;
+
+    return (wiringPiMode == WPI_MODE_PINS) || (wiringPiMode == WPI_MODE_PHYS) || (wiringPiMode == WPI_MODE_GPIO);
+}
+
+unsigned int digitalReadBank(int bank) {
+    uint32_t value;
+
+    if (!bankUsable(bank))
+        return 0;
+
+    value = readl(SUNXI_GPIO_BASE + (bank * 36) + 0x10);
+
+    bankShadow[bank] = value;
+    bankShadowValid |= 1u << bank;
+
+    return value;
+}
+
+void digitalWriteBank(int bank, unsigned int value, unsigned int mask) {
+    if (!bankUsable(bank))
+        return;
+
+    if ((bankShadowValid & (1u << bank)) == 0)
+        (void) digitalReadBank(bank);
+
+    bankShadow[bank] = (bankShadow[bank] & ~mask) | (value & mask);
+    writel(bankShadow[bank], SUNXI_GPIO_BASE + (bank * 36) + 0x10);
+}
+
 /*
  * digitalWriteByte:
  *	Pi Specific
@@ -133,6 +133,32 @@ struct wiringPiNodeStruct
   void   (*analogWrite)     (struct wiringPiNodeStruct *node, int pin, int value) ;
 
   struct wiringPiNodeStruct *next ;
+
+// Everything from here on was added later. It goes after next so drivers
+//	built against the older header still find their hooks where they
+//	expect them.
+
+  void        *extra ;	// Node specific data block when the above isn't enough
+
+  int          deferred ;	// wiringPiBegin () nesting - hold writes in the shadow
+  int          dirty ;		// Shadow has changes the device hasn't seen yet
+
+// Whole node at once: bit 0 is pinBase. The default calls the single pin
+//	functions in turn; devices that can do better override these.
+
+  unsigned int (*digitalReadPort)  (struct wiringPiNodeStruct *node) ;
+  void         (*digitalWritePort) (struct wiringPiNodeStruct *node, unsigned int value, unsigned int mask) ;
+
+// A list of pins, all on this node. Again the default is one at a time.
+
+  void   (*digitalReadMulti)  (struct wiringPiNodeStruct *node, const int *pins, int *values, int count) ;
+  void   (*digitalWriteMulti) (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count) ;
+  void   (*analogReadMulti)   (struct wiringPiNodeStruct *node, const int *pins, int *values, int count) ;
+  void   (*analogWriteMulti)  (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count) ;
+
+// Flush deferred writes to the device - only called when dirty is set
+
+  void   (*commit)          (struct wiringPiNodeStruct *node) ;
 } ;
 
 extern struct wiringPiNodeStruct *wiringPiNodes ;
@@ -159,6 +185,8 @@ extern int wiringPiFailure (int fatal, const char *message, ...) ;
 
 extern struct wiringPiNodeStruct *wiringPiFindNode (int pin) ;
 extern struct wiringPiNodeStruct *wiringPiNewNode  (int pinBase, int numPins) ;
+extern void wiringPiNodeReadMultiPort  (struct wiringPiNodeStruct *node, const int *pins, int *values, int count) ;
+extern void wiringPiNodeWriteMultiPort (struct wiringPiNodeStruct *node, const int *pins, const int *values, int count) ;
 
 extern int  wiringPiSetup       (void) ;
 extern int  wiringPiSetupSys    (void) ;
@@ -173,6 +201,14 @@ extern void digitalWrite        (int pin, int value) ;
 extern void pwmWrite            (int pin, int value) ;
 extern int  analogRead          (int pin) ;
 extern void analogWrite         (int pin, int value) ;
+extern unsigned int digitalReadPort  (int pin) ;
+extern void         digitalWritePort (int pin, unsigned int value, unsigned int mask) ;
+extern void digitalReadMulti    (const int *pins, int *values, int count) ;
+extern void digitalWriteMulti   (const int *pins, const int *values, int count) ;
+extern void analogReadMulti     (const int *pins, int *values, int count) ;
+extern void analogWriteMulti    (const int *pins, const int *values, int count) ;
+extern void wiringPiBegin       (int pin) ;
+extern void wiringPiCommit      (int pin) ;
 
 // PiFace specifics 
 //	(Deprecated)
@@ -191,6 +227,9 @@ extern void setPadDrive         (int group, int value) ;
 extern int  getAlt              (int pin) ;
 extern void pwmToneWrite        (int pin, int freq) ;
 extern void digitalWriteByte    (int value) ;
+extern int  wiringPiPinToBank   (int pin, int *bank, unsigned int *mask) ;
+extern unsigned int digitalReadBank  (int bank) ;
+extern void         digitalWriteBank (int bank, unsigned int value, unsigned int mask) ;
 extern void pwmSetMode          (int mode) ;
 extern void pwmSetRange         (unsigned int range) ;
 extern void pwmSetClock         (int divisor) ;
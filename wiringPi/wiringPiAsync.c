@@ -0,0 +1,544 @@
+/*
+ * wiringPiAsync.c:
+ *	Asynchronous SPI and I2C transfers run by a per-bus worker thread
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with wiringPi.
+ *    If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+/*
+ * Notes:
+ *	Every SPI and I2C call in wiringPi blocks inside an ioctl () until
+ *	the transfer is over, which is fine until you have a slow device on
+ *	the bus and a thread that needs to get on with something else.
+ *
+ *	An executor here is one worker thread with a bounded queue in front
+ *	of it. Transfers are run strictly in the order they were submitted,
+ *	so anything aimed at the same device stays in order. Create one
+ *	executor per physical bus - there is nothing to be gained from
+ *	running two transfers on the same bus at once.
+ *
+ *	Completion can be picked up in any of three ways:
+ *	  - A callback, run on the worker thread. The op is marked done
+ *	    before the callback is called and is not touched again by us,
+ *	    so the callback is free to re-use or free it.
+ *	  - wiringPiAsyncWait (), which blocks until the op is done.
+ *	  - The eventfd from wiringPiAsyncEventFd () which is bumped once
+ *	    per completed op, so you can poll/epoll on it and then check
+ *	    the done flags of the ops you have outstanding.
+ *********************************************************************************
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "wiringPi.h"
+#include "wiringPiSPI.h"
+#include "wiringPiI2C.h"
+
+#include "wiringPiAsync.h"
+
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
+// asyncBus:
+//	used and stop only change with asyncSetupLock held. Callers count
+//	themselves into waiters while they're using the bus, and Close
+//	waits for them all to leave before it tears the bus down.
+
+struct asyncBus
+{
+  int                      used ;
+  int                      stop ;	// Closing - no new callers
+  int                      stopped ;	// The worker has gone
+  int                      waiters ;
+  pthread_t                thread ;
+  pthread_mutex_t          lock ;
+  pthread_cond_t           notEmpty ;
+  pthread_cond_t           notFull ;
+  pthread_cond_t           completed ;
+
+  struct wiringPiAsyncOp **queue ;
+  int                      depth ;
+  int                      head ;
+  int                      count ;	// Waiting in the queue
+  int                      busy ;	// Queued plus the one being run
+
+  int                      evFd ;
+} ;
+
+static struct asyncBus asyncBuses [WPI_ASYNC_MAX_BUS] ;
+
+static pthread_mutex_t asyncSetupLock = PTHREAD_MUTEX_INITIALIZER ;
+
+
+/*
+ * asyncRun:
+ *	Perform the transfer using the normal blocking calls
+ *********************************************************************************
+ */
+
+static void asyncRun (struct wiringPiAsyncOp *op)
+{
+  int result ;
+
+  errno = 0 ;
+
+  switch (op->type)
+  {
+    case WPI_ASYNC_SPI:
+      result = wiringPiSPIDataRW (op->fd, op->data, op->len) ;
+      break ;
+
+    case WPI_ASYNC_I2C_READ:
+      result = wiringPiI2CRead (op->fd) ;
+      break ;
+
+    case WPI_ASYNC_I2C_READ_REG8:
+      result = wiringPiI2CReadReg8 (op->fd, op->reg) ;
+      break ;
+
+    case WPI_ASYNC_I2C_READ_REG16:
+      result = wiringPiI2CReadReg16 (op->fd, op->reg) ;
+      break ;
+
+    case WPI_ASYNC_I2C_WRITE:
+      result = wiringPiI2CWrite (op->fd, op->value) ;
+      break ;
+
+    case WPI_ASYNC_I2C_WRITE_REG8:
+      result = wiringPiI2CWriteReg8 (op->fd, op->reg, op->value) ;
+      break ;
+
+    case WPI_ASYNC_I2C_WRITE_REG16:
+      result = wiringPiI2CWriteReg16 (op->fd, op->reg, op->value) ;
+      break ;
+
+    case WPI_ASYNC_READ:
+      result = read (op->fd, op->data, op->len) ;
+      break ;
+
+    case WPI_ASYNC_WRITE:
+      result = write (op->fd, op->data, op->len) ;
+      break ;
+
+    case WPI_ASYNC_I2C_READ_BLOCK:
+      result = wiringPiI2CReadBlock (op->fd, op->reg, op->data, op->len) ;
+      break ;
+
+    case WPI_ASYNC_I2C_WRITE_BLOCK:
+      result = wiringPiI2CWriteBlock (op->fd, op->reg, op->data, op->len) ;
+      break ;
+
+    default:
+      result = -1 ;
+      errno  = EINVAL ;
+      break ;
+  }
+
+  op->result = result ;
+  op->error  = (result < 0) ? errno : 0 ;
+}
+
+
+/*
+ * asyncThread:
+ *	The worker. Pulls transfers off the queue in order and runs them.
+ *********************************************************************************
+ */
+
+static void *asyncThread (void *arg)
+{
+  struct asyncBus *bus = (struct asyncBus *)arg ;
+  struct wiringPiAsyncOp *op ;
+  void (*callback)(struct wiringPiAsyncOp *) ;
+  uint64_t one = 1 ;
+
+  for (;;)
+  {
+    pthread_mutex_lock (&bus->lock) ;
+      while ((bus->count == 0) && !bus->stop)
+        pthread_cond_wait (&bus->notEmpty, &bus->lock) ;
+
+      if (bus->count == 0)		// Stopping and nothing left to do
+      {
+        pthread_mutex_unlock (&bus->lock) ;
+        break ;
+      }
+
+      op = bus->queue [bus->head] ;
+      bus->head = (bus->head + 1) % bus->depth ;
+      --bus->count ;
+      pthread_cond_signal (&bus->notFull) ;
+    pthread_mutex_unlock (&bus->lock) ;
+
+    asyncRun (op) ;
+    callback = op->callback ;
+
+    pthread_mutex_lock (&bus->lock) ;
+      op->done = TRUE ;
+      --bus->busy ;
+      pthread_cond_broadcast (&bus->completed) ;
+    pthread_mutex_unlock (&bus->lock) ;
+
+    (void)write (bus->evFd, &one, sizeof (one)) ;
+
+    if (callback != NULL)
+      callback (op) ;
+  }
+
+  return NULL ;
+}
+
+
+/*
+ * asyncEnter: asyncLeave:
+ *	Validate a bus handle and count us in as using it, or out again.
+ *	Returns NULL with errno set to EINVAL for a bad handle or EPIPE if
+ *	the bus is being closed.
+ *********************************************************************************
+ */
+
+static struct asyncBus *asyncEnter (int bus)
+{
+  struct asyncBus *b = NULL ;
+
+  pthread_mutex_lock (&asyncSetupLock) ;
+
+  if ((bus < 0) || (bus >= WPI_ASYNC_MAX_BUS) || !asyncBuses [bus].used)
+    errno = EINVAL ;
+  else if (asyncBuses [bus].stop)
+    errno = EPIPE ;
+  else
+  {
+    b = &asyncBuses [bus] ;
+    pthread_mutex_lock (&b->lock) ;
+      ++b->waiters ;
+    pthread_mutex_unlock (&b->lock) ;
+  }
+
+  pthread_mutex_unlock (&asyncSetupLock) ;
+
+  return b ;
+}
+
+static void asyncLeave (struct asyncBus *b)
+{
+  pthread_mutex_lock (&b->lock) ;
+    if ((--b->waiters == 0) && b->stopped)
+      pthread_cond_broadcast (&b->completed) ;
+  pthread_mutex_unlock (&b->lock) ;
+}
+
+
+/*
+ * asyncQueue:
+ *	Add a transfer to the end of the queue, optionally waiting for space
+ *********************************************************************************
+ */
+
+static int asyncQueue (int bus, struct wiringPiAsyncOp *op, int wait)
+{
+  struct asyncBus *b ;
+  int result = 0 ;
+
+  if ((b = asyncEnter (bus)) == NULL)
+    return -1 ;
+
+  op->done   = FALSE ;
+  op->result = 0 ;
+  op->error  = 0 ;
+
+  pthread_mutex_lock (&b->lock) ;
+
+    while ((b->count == b->depth) && wait && !b->stop)
+      pthread_cond_wait (&b->notFull, &b->lock) ;
+
+    if ((b->count == b->depth) || b->stop)
+    {
+      errno  = b->stop ? EPIPE : EAGAIN ;
+      result = -1 ;
+    }
+    else
+    {
+      b->queue [(b->head + b->count) % b->depth] = op ;
+      ++b->count ;
+      ++b->busy ;
+      pthread_cond_signal (&b->notEmpty) ;
+    }
+
+  pthread_mutex_unlock (&b->lock) ;
+
+  asyncLeave (b) ;
+
+  return result ;
+}
+
+
+/*
+ * wiringPiAsyncSubmit: wiringPiAsyncTrySubmit:
+ *	Queue up a transfer. Submit will wait for room in the queue,
+ *	TrySubmit returns -1 with errno set to EAGAIN if it's full.
+ *********************************************************************************
+ */
+
+int wiringPiAsyncSubmit (int bus, struct wiringPiAsyncOp *op)
+{
+  return asyncQueue (bus, op, TRUE) ;
+}
+
+int wiringPiAsyncTrySubmit (int bus, struct wiringPiAsyncOp *op)
+{
+  return asyncQueue (bus, op, FALSE) ;
+}
+
+
+/*
+ * wiringPiAsyncWait:
+ *	Wait for a transfer to complete and return its result. A negative
+ *	timeout waits forever. On time-out, -1 is returned with errno set
+ *	to ETIMEDOUT and the op is left running. The timeout is on the
+ *	monotonic clock, so setting the time doesn't upset it.
+ *********************************************************************************
+ */
+
+int wiringPiAsyncWait (int bus, struct wiringPiAsyncOp *op, int mS)
+{
+  struct asyncBus *b ;
+  struct timespec then ;
+  int done ;
+
+  if ((b = asyncEnter (bus)) == NULL)
+    return -1 ;
+
+  if (mS >= 0)
+  {
+    clock_gettime (CLOCK_MONOTONIC, &then) ;
+    then.tv_sec  += mS / 1000 ;
+    then.tv_nsec += (long)(mS % 1000) * 1000000L ;
+    if (then.tv_nsec >= 1000000000L)
+    {
+      then.tv_sec  += 1 ;
+      then.tv_nsec -= 1000000000L ;
+    }
+  }
+
+  pthread_mutex_lock (&b->lock) ;
+    while (!op->done && !b->stopped)
+    {
+      if (mS < 0)
+        pthread_cond_wait (&b->completed, &b->lock) ;
+      else if (pthread_cond_timedwait (&b->completed, &b->lock, &then) == ETIMEDOUT)
+        break ;
+    }
+    done = op->done ;
+  pthread_mutex_unlock (&b->lock) ;
+
+  asyncLeave (b) ;
+
+  if (!done)
+  {
+    errno = ETIMEDOUT ;
+    return -1 ;
+  }
+
+  errno = op->error ;
+  return op->result ;
+}
+
+
+/*
+ * wiringPiAsyncDrain:
+ *	Wait until everything submitted so far has completed
+ *********************************************************************************
+ */
+
+int wiringPiAsyncDrain (int bus)
+{
+  struct asyncBus *b ;
+
+  if ((b = asyncEnter (bus)) == NULL)
+    return -1 ;
+
+  pthread_mutex_lock (&b->lock) ;
+    while (b->busy != 0)
+      pthread_cond_wait (&b->completed, &b->lock) ;
+  pthread_mutex_unlock (&b->lock) ;
+
+  asyncLeave (b) ;
+
+  return 0 ;
+}
+
+
+/*
+ * wiringPiAsyncEventFd:
+ *	Return the eventfd that is signalled once for every completed op.
+ *	It's non-blocking; reading it returns (and clears) the count.
+ *********************************************************************************
+ */
+
+int wiringPiAsyncEventFd (int bus)
+{
+  int fd = -1 ;
+
+  pthread_mutex_lock (&asyncSetupLock) ;
+    if ((bus >= 0) && (bus < WPI_ASYNC_MAX_BUS) && asyncBuses [bus].used)
+      fd = asyncBuses [bus].evFd ;
+  pthread_mutex_unlock (&asyncSetupLock) ;
+
+  return fd ;
+}
+
+
+/*
+ * wiringPiAsyncCreate:
+ *	Create a new executor with room for depth outstanding transfers and
+ *	return its handle.
+ *********************************************************************************
+ */
+
+int wiringPiAsyncCreate (int depth)
+{
+  struct asyncBus *b = NULL ;
+  pthread_condattr_t attr ;
+  int bus ;
+
+  if (depth < 1)
+    depth = 1 ;
+
+  pthread_mutex_lock (&asyncSetupLock) ;
+
+  for (bus = 0 ; bus < WPI_ASYNC_MAX_BUS ; ++bus)
+    if (!asyncBuses [bus].used)
+    {
+      b = &asyncBuses [bus] ;
+      break ;
+    }
+
+  if (b == NULL)
+  {
+    pthread_mutex_unlock (&asyncSetupLock) ;
+    return wiringPiFailure (WPI_ALMOST, "wiringPiAsyncCreate: No free executors\n") ;
+  }
+
+  memset (b, 0, sizeof (struct asyncBus)) ;
+
+  if ((b->queue = calloc (depth, sizeof (struct wiringPiAsyncOp *))) == NULL)
+  {
+    pthread_mutex_unlock (&asyncSetupLock) ;
+    return wiringPiFailure (WPI_ALMOST, "wiringPiAsyncCreate: Unable to allocate memory: %s\n", strerror (errno)) ;
+  }
+
+  if ((b->evFd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+  {
+    free (b->queue) ;
+    pthread_mutex_unlock (&asyncSetupLock) ;
+    return wiringPiFailure (WPI_ALMOST, "wiringPiAsyncCreate: Unable to create eventfd: %s\n", strerror (errno)) ;
+  }
+
+  b->depth = depth ;
+  pthread_mutex_init (&b->lock,      NULL) ;
+  pthread_cond_init  (&b->notEmpty,  NULL) ;
+  pthread_cond_init  (&b->notFull,   NULL) ;
+  pthread_condattr_init     (&attr) ;
+  pthread_condattr_setclock (&attr, CLOCK_MONOTONIC) ;
+  pthread_cond_init         (&b->completed, &attr) ;
+  pthread_condattr_destroy  (&attr) ;
+
+  if (pthread_create (&b->thread, NULL, asyncThread, b) != 0)
+  {
+    pthread_cond_destroy  (&b->completed) ;
+    pthread_cond_destroy  (&b->notFull) ;
+    pthread_cond_destroy  (&b->notEmpty) ;
+    pthread_mutex_destroy (&b->lock) ;
+    close (b->evFd) ;
+    free  (b->queue) ;
+    pthread_mutex_unlock (&asyncSetupLock) ;
+    return wiringPiFailure (WPI_ALMOST, "wiringPiAsyncCreate: Unable to start worker thread\n") ;
+  }
+
+  b->used = TRUE ;
+
+  pthread_mutex_unlock (&asyncSetupLock) ;
+
+  return bus ;
+}
+
+
+/*
+ * wiringPiAsyncClose:
+ *	Run everything still in the queue, then stop the worker and release
+ *	the executor. Anyone still waiting on it is let go first; the worker
+ *	may be calling back into us, so asyncSetupLock isn't held over the
+ *	join.
+ *********************************************************************************
+ */
+
+void wiringPiAsyncClose (int bus)
+{
+  struct asyncBus *b ;
+
+  pthread_mutex_lock (&asyncSetupLock) ;
+
+  if ((bus < 0) || (bus >= WPI_ASYNC_MAX_BUS) || !asyncBuses [bus].used || asyncBuses [bus].stop)
+  {
+    pthread_mutex_unlock (&asyncSetupLock) ;
+    return ;
+  }
+
+  b = &asyncBuses [bus] ;
+
+  pthread_mutex_lock (&b->lock) ;
+    b->stop = TRUE ;
+    pthread_cond_broadcast (&b->notEmpty) ;
+    pthread_cond_broadcast (&b->notFull) ;
+  pthread_mutex_unlock (&b->lock) ;
+
+  pthread_mutex_unlock (&asyncSetupLock) ;
+
+  pthread_join (b->thread, NULL) ;
+
+  pthread_mutex_lock (&b->lock) ;
+    b->stopped = TRUE ;
+    pthread_cond_broadcast (&b->completed) ;
+    while (b->waiters > 0)
+      pthread_cond_wait (&b->completed, &b->lock) ;
+  pthread_mutex_unlock (&b->lock) ;
+
+  close (b->evFd) ;
+  free  (b->queue) ;
+
+  pthread_cond_destroy  (&b->completed) ;
+  pthread_cond_destroy  (&b->notFull) ;
+  pthread_cond_destroy  (&b->notEmpty) ;
+  pthread_mutex_destroy (&b->lock) ;
+
+  pthread_mutex_lock (&asyncSetupLock) ;
+    b->used = FALSE ;
+  pthread_mutex_unlock (&asyncSetupLock) ;
+}
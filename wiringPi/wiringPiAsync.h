@@ -0,0 +1,79 @@
+/*
+ * wiringPiAsync.h:
+ *	Asynchronous SPI and I2C transfers run by a per-bus worker thread
+ ***********************************************************************
+ * This file is part of wiringPi:
+ *	https://projects.drogon.net/raspberry-pi/wiringpi/
+ *
+ *    wiringPi is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as
+ *    published by the Free Software Foundation, either version 3 of the
+ *    License, or (at your option) any later version.
+ *
+ *    wiringPi is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public
+ *    License along with wiringPi.
+ *    If not, see <http://www.gnu.org/licenses/>.
+ ***********************************************************************
+ */
+
+// Maximum number of executors that can be open at once
+
+#define	WPI_ASYNC_MAX_BUS	8
+
+// Transfer types
+
+#define	WPI_ASYNC_SPI			0	// wiringPiSPIDataRW (fd, data, len)
+#define	WPI_ASYNC_I2C_READ		1	// wiringPiI2CRead       (fd)
+#define	WPI_ASYNC_I2C_READ_REG8		2	// wiringPiI2CReadReg8   (fd, reg)
+#define	WPI_ASYNC_I2C_READ_REG16	3	// wiringPiI2CReadReg16  (fd, reg)
+#define	WPI_ASYNC_I2C_WRITE		4	// wiringPiI2CWrite      (fd, value)
+#define	WPI_ASYNC_I2C_WRITE_REG8	5	// wiringPiI2CWriteReg8  (fd, reg, value)
+#define	WPI_ASYNC_I2C_WRITE_REG16	6	// wiringPiI2CWriteReg16 (fd, reg, value)
+#define	WPI_ASYNC_READ			7	// read  (fd, data, len)
+#define	WPI_ASYNC_WRITE			8	// write (fd, data, len)
+#define	WPI_ASYNC_I2C_READ_BLOCK	9	// wiringPiI2CReadBlock  (fd, reg, data, len)
+#define	WPI_ASYNC_I2C_WRITE_BLOCK	10	// wiringPiI2CWriteBlock (fd, reg, data, len)
+
+// wiringPiAsyncOp:
+//	One transfer. The caller owns the memory and must keep it (and
+//	the data buffer) valid until the transfer has completed.
+//	For SPI transfers fd is the SPI channel, for everything else
+//	it's the file descriptor returned by the setup function.
+
+struct wiringPiAsyncOp
+{
+  int            type ;
+  int            fd ;
+  int            reg ;
+  int            value ;
+  unsigned char *data ;
+  int            len ;
+
+  void         (*callback) (struct wiringPiAsyncOp *op) ;	// Optional
+  void          *userData ;
+
+  int            result ;	// Return value of the blocking call
+  int            error ;	// errno if result < 0
+  volatile int   done ;
+} ;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int  wiringPiAsyncCreate    (int depth) ;
+extern void wiringPiAsyncClose     (int bus) ;
+extern int  wiringPiAsyncSubmit    (int bus, struct wiringPiAsyncOp *op) ;
+extern int  wiringPiAsyncTrySubmit (int bus, struct wiringPiAsyncOp *op) ;
+extern int  wiringPiAsyncWait      (int bus, struct wiringPiAsyncOp *op, int mS) ;
+extern int  wiringPiAsyncDrain     (int bus) ;
+extern int  wiringPiAsyncEventFd   (int bus) ;
+
+#ifdef __cplusplus
+}
+#endif
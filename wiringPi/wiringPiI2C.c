@@ -51,16 +51,30 @@
 #include <errno.h>
 #include <string.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 
 #include "wiringPi.h"
 #include "wiringPiI2C.h"
 
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
 // I2C definitions
 
 #define I2C_SLAVE	0x0703
+#define I2C_TENBIT	0x0704	/* 0 for 7 bit addrs, != 0 for 10 bit */
+#define I2C_FUNCS	0x0705	/* Get the adapter functionality mask */
+#define I2C_RDWR	0x0707	/* Combined R/W transfer (one STOP only) */
 #define I2C_SMBUS	0x0720	/* SMBus-level access */
 
+#define I2C_RDWR_MAX_MSGS	42	/* Kernel limit on messages per I2C_RDWR */
+
+#define I2C_FUNC_I2C		0x00000001	/* Adapter can do plain I2C (I2C_RDWR) */
+
 #define I2C_SMBUS_READ	1
 #define I2C_SMBUS_WRITE	0
 
@@ -98,6 +112,22 @@ struct i2c_smbus_ioctl_data
   union i2c_smbus_data *data ;
 } ;
 
+// struct wiringPiI2CMsg is laid out the same as the kernel's struct i2c_msg
+
+struct i2c_rdwr_ioctl_data
+{
+  struct wiringPiI2CMsg *msgs ;
+  uint32_t nmsgs ;
+} ;
+
+// Remember which device each file descriptor was set up for so we
+//	can address it in combined transactions.
+//	Stored as devId + 1 so that zero means we don't know.
+
+#define	I2C_MAX_FDS	256
+
+static int i2cDevIds [I2C_MAX_FDS] ;
+
 static inline int i2c_smbus_access (int fd, char rw, uint8_t command, int size, union i2c_smbus_data *data)
 {
   struct i2c_smbus_ioctl_data args ;
@@ -110,6 +140,190 @@ static inline int i2c_smbus_access (int fd, char rw, uint8_t command, int size,
 }
 
 
+/*
+ * Shared buses:
+ *	wiringPiI2CSetupShared () opens each /dev/i2c-N adapter once and
+ *	hands out a device handle rather than a file descriptor. Every
+ *	function here accepts either.
+ *
+ *	A handle is just an index into i2cDevs offset by I2C_HANDLE_BASE,
+ *	which is well clear of any file descriptor we're likely to see.
+ *	All access to a shared bus is done with the bus locked. SMBus and
+ *	plain read/write transfers need the adapter pointed at the right
+ *	device with I2C_SLAVE first, so we remember which address it's
+ *	pointing at and only switch when it changes. I2C_RDWR messages
+ *	carry their own address so don't need that.
+ *********************************************************************************
+ */
+
+#define	I2C_HANDLE_BASE	0x40000000
+#define	I2C_MAX_HANDLES	256
+
+struct i2cBus
+{
+  char            *device ;
+  int              fd ;
+  unsigned long    funcs ;	// I2C_FUNCS, read once when opened
+  int              addr ;	// Currently selected device or -1
+  int              users ;
+  pthread_mutex_t  lock ;
+  struct wiringPiI2CStats stats ;
+  struct i2cBus   *next ;
+} ;
+
+struct i2cDev
+{
+  struct i2cBus *bus ;
+  int            devId ;
+} ;
+
+static struct i2cBus   *i2cBuses ;
+static struct i2cDev   *i2cDevs [I2C_MAX_HANDLES] ;
+static pthread_mutex_t  i2cSetupLock = PTHREAD_MUTEX_INITIALIZER ;
+
+
+/*
+ * i2cGetDev:
+ *	Return the device for a handle, or NULL if it's a plain fd
+ *********************************************************************************
+ */
+
+static struct i2cDev *i2cGetDev (int fd)
+{
+  if ((fd < I2C_HANDLE_BASE) || (fd >= I2C_HANDLE_BASE + I2C_MAX_HANDLES))
+    return NULL ;
+
+  return i2cDevs [fd - I2C_HANDLE_BASE] ;
+}
+
+
+/*
+ * i2cLock: i2cUnlock:
+ *	Bracket a transfer. For a shared handle this takes the bus lock,
+ *	optionally selects the device and returns the bus fd. For a plain
+ *	fd it does nothing.
+ *	i2cUnlock updates the counters and passes the result back through.
+ *********************************************************************************
+ */
+
+static int i2cLock (int fd, struct i2cBus **busp, int select)
+{
+  struct i2cDev *dev ;
+  struct i2cBus *bus ;
+
+  if ((dev = i2cGetDev (fd)) == NULL)
+  {
+    *busp = NULL ;
+    if (fd >= I2C_HANDLE_BASE)
+    {
+      errno = EBADF ;
+      return -1 ;
+    }
+    return fd ;
+  }
+
+  *busp = bus = dev->bus ;
+  pthread_mutex_lock (&bus->lock) ;
+
+  if (select && (bus->addr != dev->devId))
+  {
+    if ((ioctl (bus->fd, I2C_TENBIT, dev->devId > 0x7F ? 1 : 0) < 0) ||
+	(ioctl (bus->fd, I2C_SLAVE,  dev->devId) < 0))
+    {
+      bus->addr = -1 ;
+      ++bus->stats.errors ;
+      pthread_mutex_unlock (&bus->lock) ;
+      return -1 ;
+    }
+    bus->addr = dev->devId ;
+    ++bus->stats.selects ;
+  }
+
+  return bus->fd ;
+}
+
+static int i2cUnlock (struct i2cBus *bus, int result, int bytes)
+{
+  if (bus == NULL)
+    return result ;
+
+  ++bus->stats.transactions ;
+  if (result < 0)
+    ++bus->stats.errors ;
+  else
+    bus->stats.bytes += bytes ;
+
+  pthread_mutex_unlock (&bus->lock) ;
+
+  return result ;
+}
+
+
+/*
+ * i2cSmbus: i2cReadWrite: i2cRdwr:
+ *	The three ways we talk to an adapter, routed through the above.
+ *********************************************************************************
+ */
+
+static int i2cSmbus (int fd, char rw, uint8_t command, int size, union i2c_smbus_data *data)
+{
+  struct i2cBus *bus ;
+  int realFd, res, bytes ;
+
+  if ((realFd = i2cLock (fd, &bus, TRUE)) < 0)
+    return -1 ;
+
+  res = i2c_smbus_access (realFd, rw, command, size, data) ;
+
+  /**/ if (size == I2C_SMBUS_QUICK)
+    bytes = 0 ;
+  else if (size == I2C_SMBUS_WORD_DATA)
+    bytes = 2 ;
+  else if ((size == I2C_SMBUS_BLOCK_DATA) || (size == I2C_SMBUS_I2C_BLOCK_DATA))
+    bytes = data->block [0] ;
+  else
+    bytes = 1 ;
+
+  return i2cUnlock (bus, res, bytes) ;
+}
+
+static int i2cReadWrite (int fd, uint8_t *data, int len, int isWrite)
+{
+  struct i2cBus *bus ;
+  int realFd, res ;
+
+  if ((realFd = i2cLock (fd, &bus, TRUE)) < 0)
+    return -1 ;
+
+  if (isWrite)
+    res = write (realFd, data, len) ;
+  else
+    res = read  (realFd, data, len) ;
+
+  return i2cUnlock (bus, res, res) ;
+}
+
+static int i2cRdwr (int fd, struct wiringPiI2CMsg *msgs, int count)
+{
+  struct i2c_rdwr_ioctl_data rdwr ;
+  struct i2cBus *bus ;
+  int realFd, res, i, bytes = 0 ;
+
+  if ((realFd = i2cLock (fd, &bus, FALSE)) < 0)
+    return -1 ;
+
+  rdwr.msgs  = msgs ;
+  rdwr.nmsgs = count ;
+
+  res = ioctl (realFd, I2C_RDWR, &rdwr) ;
+
+  for (i = 0 ; i < count ; ++i)
+    bytes += msgs [i].len ;
+
+  return i2cUnlock (bus, res, bytes) ;
+}
+
+
 /*
  * wiringPiI2CRead:
  *	Simple device read
@@ -120,7 +334,7 @@ int wiringPiI2CRead (int fd)
 {
   union i2c_smbus_data data ;
 
-  if (i2c_smbus_access (fd, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &data))
+  if (i2cSmbus (fd, I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &data))
     return -1 ;
   else
     return data.byte & 0xFF ;
@@ -137,7 +351,7 @@ int wiringPiI2CReadReg8 (int fd, int reg)
 {
   union i2c_smbus_data data;
 
-  if (i2c_smbus_access (fd, I2C_SMBUS_READ, reg, I2C_SMBUS_BYTE_DATA, &data))
+  if (i2cSmbus (fd, I2C_SMBUS_READ, reg, I2C_SMBUS_BYTE_DATA, &data))
     return -1 ;
   else
     return data.byte & 0xFF ;
@@ -147,7 +361,7 @@ int wiringPiI2CReadReg16 (int fd, int reg)
 {
   union i2c_smbus_data data;
 
-  if (i2c_smbus_access (fd, I2C_SMBUS_READ, reg, I2C_SMBUS_WORD_DATA, &data))
+  if (i2cSmbus (fd, I2C_SMBUS_READ, reg, I2C_SMBUS_WORD_DATA, &data))
     return -1 ;
   else
     return data.word & 0xFFFF ;
@@ -162,7 +376,7 @@ int wiringPiI2CReadReg16 (int fd, int reg)
 
 int wiringPiI2CWrite (int fd, int data)
 {
-  return i2c_smbus_access (fd, I2C_SMBUS_WRITE, data, I2C_SMBUS_BYTE, NULL) ;
+  return i2cSmbus (fd, I2C_SMBUS_WRITE, data, I2C_SMBUS_BYTE, NULL) ;
 }
 
 
@@ -177,7 +391,7 @@ int wiringPiI2CWriteReg8 (int fd, int reg, int value)
   union i2c_smbus_data data ;
 
   data.byte = value ;
-  return i2c_smbus_access (fd, I2C_SMBUS_WRITE, reg, I2C_SMBUS_BYTE_DATA, &data) ;
+  return i2cSmbus (fd, I2C_SMBUS_WRITE, reg, I2C_SMBUS_BYTE_DATA, &data) ;
 }
 
 int wiringPiI2CWriteReg16 (int fd, int reg, int value)
@@ -185,7 +399,231 @@ int wiringPiI2CWriteReg16 (int fd, int reg, int value)
   union i2c_smbus_data data ;
 
   data.word = value ;
-  return i2c_smbus_access (fd, I2C_SMBUS_WRITE, reg, I2C_SMBUS_WORD_DATA, &data) ;
+  return i2cSmbus (fd, I2C_SMBUS_WRITE, reg, I2C_SMBUS_WORD_DATA, &data) ;
+}
+
+
+/*
+ * wiringPiI2CReadRaw: wiringPiI2CWriteRaw:
+ *	Plain multi-byte read or write from/to the device with no register
+ *	address - a single I2C transaction either way.
+ *********************************************************************************
+ */
+
+int wiringPiI2CReadRaw (int fd, uint8_t *data, int len)
+{
+  return i2cReadWrite (fd, data, len, FALSE) ;
+}
+
+int wiringPiI2CWriteRaw (int fd, const uint8_t *data, int len)
+{
+  return i2cReadWrite (fd, (uint8_t *)data, len, TRUE) ;
+}
+
+
+/*
+ * wiringPiI2CTransfer:
+ *	Run a list of messages as one combined transaction: the messages are
+ *	joined by repeated-starts and there is a single STOP at the end
+ *	(unless a message asks for one with WPI_I2C_M_STOP).
+ *	Returns the number of messages transferred or -1 on error.
+ *********************************************************************************
+ */
+
+int wiringPiI2CTransfer (int fd, struct wiringPiI2CMsg *msgs, int count)
+{
+  if ((count < 1) || (count > I2C_RDWR_MAX_MSGS))
+  {
+    errno = EINVAL ;
+    return -1 ;
+  }
+
+  return i2cRdwr (fd, msgs, count) ;
+}
+
+
+/*
+ * wiringPiI2CReadBlock:
+ *	Read len bytes starting at the given register: a register write then
+ *	a repeated-start read, in one transaction. The device needs to auto-
+ *	increment its register pointer for this to make sense.
+ *	If we don't know the device address (the fd didn't come from one of
+ *	our setup functions), or the adapter can only do SMBus, then fall
+ *	back to an SMBus I2C block read which is limited to 32 bytes.
+ *	Returns the number of bytes read or -1 on error.
+ *********************************************************************************
+ */
+
+int wiringPiI2CReadBlock (int fd, int reg, uint8_t *data, int len)
+{
+  struct wiringPiI2CMsg msgs [2] ;
+  struct i2cDev *dev ;
+  uint8_t regByte = reg ;
+  int devId ;
+
+  if ((len < 1) || (len > 0xFFFF))
+  {
+    errno = EINVAL ;
+    return -1 ;
+  }
+
+  if ((dev = i2cGetDev (fd)) != NULL)
+  {
+    if ((dev->bus->funcs & I2C_FUNC_I2C) == 0)		// SMBus-only adapter
+      return wiringPiI2CReadI2CBlock (fd, reg, data, len) ;
+    devId = dev->devId ;
+  }
+  else if ((fd >= 0) && (fd < I2C_MAX_FDS) && (i2cDevIds [fd] != 0))
+    devId = i2cDevIds [fd] - 1 ;
+  else
+    return wiringPiI2CReadI2CBlock (fd, reg, data, len) ;
+
+  msgs [0].addr  = devId ;
+  msgs [0].flags = (devId > 0x7F) ? WPI_I2C_M_TEN : 0 ;
+  msgs [0].len   = 1 ;
+  msgs [0].buf   = &regByte ;
+
+  msgs [1].addr  = devId ;
+  msgs [1].flags = msgs [0].flags | WPI_I2C_M_RD ;
+  msgs [1].len   = len ;
+  msgs [1].buf   = data ;
+
+  if (wiringPiI2CTransfer (fd, msgs, 2) != 2)
+    return -1 ;
+
+  return len ;
+}
+
+
+/*
+ * wiringPiI2CWriteBlock:
+ *	Write len bytes starting at the given register in one transaction.
+ *	Returns the number of data bytes written or -1 on error.
+ *********************************************************************************
+ */
+
+int wiringPiI2CWriteBlock (int fd, int reg, const uint8_t *data, int len)
+{
+  uint8_t  local [64] ;
+  uint8_t *buf = local ;
+  int      res ;
+
+  if (len < 0)
+  {
+    errno = EINVAL ;
+    return -1 ;
+  }
+
+  if (len + 1 > (int)sizeof (local))
+    if ((buf = malloc (len + 1)) == NULL)
+      return -1 ;
+
+  buf [0] = reg ;
+  memcpy (buf + 1, data, len) ;
+
+  res = i2cReadWrite (fd, buf, len + 1, TRUE) ;
+
+  if (buf != local)
+    free (buf) ;
+
+  return (res < 0) ? -1 : res - 1 ;
+}
+
+
+/*
+ * wiringPiI2CReadBlockData: wiringPiI2CWriteBlockData:
+ *	SMBus block read/write. Here the device sends (or is sent) a count
+ *	byte first, so a read returns however many bytes the device decides
+ *	to send - up to 32. The data buffer must have room for 32 bytes.
+ *	Returns the number of bytes transferred or -1 on error.
+ *********************************************************************************
+ */
+
+int wiringPiI2CReadBlockData (int fd, int reg, uint8_t *data)
+{
+  union i2c_smbus_data smbus ;
+  int len ;
+
+  if (i2cSmbus (fd, I2C_SMBUS_READ, reg, I2C_SMBUS_BLOCK_DATA, &smbus))
+    return -1 ;
+
+  len = smbus.block [0] ;
+  if (len > I2C_SMBUS_BLOCK_MAX)
+    len = I2C_SMBUS_BLOCK_MAX ;
+
+  memcpy (data, &smbus.block [1], len) ;
+
+  return len ;
+}
+
+int wiringPiI2CWriteBlockData (int fd, int reg, const uint8_t *data, int len)
+{
+  union i2c_smbus_data smbus ;
+
+  if ((len < 0) || (len > I2C_SMBUS_BLOCK_MAX))
+  {
+    errno = EINVAL ;
+    return -1 ;
+  }
+
+  smbus.block [0] = len ;
+  memcpy (&smbus.block [1], data, len) ;
+
+  if (i2cSmbus (fd, I2C_SMBUS_WRITE, reg, I2C_SMBUS_BLOCK_DATA, &smbus))
+    return -1 ;
+
+  return len ;
+}
+
+
+/*
+ * wiringPiI2CReadI2CBlock: wiringPiI2CWriteI2CBlock:
+ *	SMBus "I2C block" transfers - a plain register burst of up to 32
+ *	bytes with no count byte. Reads use a repeated-start.
+ *	Returns the number of bytes transferred or -1 on error.
+ *********************************************************************************
+ */
+
+int wiringPiI2CReadI2CBlock (int fd, int reg, uint8_t *data, int len)
+{
+  union i2c_smbus_data smbus ;
+
+  if ((len < 1) || (len > I2C_SMBUS_I2C_BLOCK_MAX))
+  {
+    errno = EINVAL ;
+    return -1 ;
+  }
+
+  smbus.block [0] = len ;
+
+  if (i2cSmbus (fd, I2C_SMBUS_READ, reg, I2C_SMBUS_I2C_BLOCK_DATA, &smbus))
+    return -1 ;
+
+  if (smbus.block [0] < len)
+    len = smbus.block [0] ;
+
+  memcpy (data, &smbus.block [1], len) ;
+
+  return len ;
+}
+
+int wiringPiI2CWriteI2CBlock (int fd, int reg, const uint8_t *data, int len)
+{
+  union i2c_smbus_data smbus ;
+
+  if ((len < 1) || (len > I2C_SMBUS_I2C_BLOCK_MAX))
+  {
+    errno = EINVAL ;
+    return -1 ;
+  }
+
+  smbus.block [0] = len ;
+  memcpy (&smbus.block [1], data, len) ;
+
+  if (i2cSmbus (fd, I2C_SMBUS_WRITE, reg, I2C_SMBUS_I2C_BLOCK_DATA, &smbus))
+    return -1 ;
+
+  return len ;
 }
 
 
@@ -193,6 +631,7 @@ int wiringPiI2CWriteReg16 (int fd, int reg, int value)
  * wiringPiI2CSetupInterface:
  *	Undocumented access to set the interface explicitly - might be used
  *	for the Pi's 2nd I2C interface...
+ *	Device IDs above 0x7F are taken to be 10-bit addresses.
  *********************************************************************************
  */
 
@@ -203,23 +642,34 @@ int wiringPiI2CSetupInterface (const char *device, int devId)
   if ((fd = open (device, O_RDWR)) < 0)
     return wiringPiFailure (WPI_ALMOST, "Unable to open I2C device: %s\n", strerror (errno)) ;
 
+  if (devId > 0x7F)
+    if (ioctl (fd, I2C_TENBIT, 1) < 0)
+      return wiringPiFailure (WPI_ALMOST, "Unable to select 10-bit I2C addressing: %s\n", strerror (errno)) ;
+
   if (ioctl (fd, I2C_SLAVE, devId) < 0)
     return wiringPiFailure (WPI_ALMOST, "Unable to select I2C device: %s\n", strerror (errno)) ;
 
+  if (fd < I2C_MAX_FDS)
+    i2cDevIds [fd] = devId + 1 ;
+
   return fd ;
 }
 
 
 /*
- * wiringPiI2CSetup:
- *	Open the I2C device, and regsiter the target device
+ * i2cDefaultDevice:
+ *	Work out which I2C adapter the header pins are on. Only done once as
+ *	piBoardRev () has to go and read /proc/cpuinfo.
  *********************************************************************************
  */
 
-int wiringPiI2CSetup (const int devId)
+static const char *i2cDefaultDevice (void)
 {
+  static const char *device = NULL ;
   int rev ;
-  const char *device ;
+
+  if (device != NULL)
+    return device ;
 
   rev = piBoardRev () ;
 /*modify for BananaPro by LeMaker team*/
@@ -232,5 +682,183 @@ int wiringPiI2CSetup (const int devId)
 else
 	device = "/dev/i2c-3" ;
 
-  return wiringPiI2CSetupInterface (device, devId) ;
+  return device ;
+}
+
+
+/*
+ * wiringPiI2CSetup:
+ *	Open the I2C device, and regsiter the target device
+ *********************************************************************************
+ */
+
+int wiringPiI2CSetup (const int devId)
+{
+  return wiringPiI2CSetupInterface (i2cDefaultDevice (), devId) ;
+}
+
+
+/*
+ * wiringPiI2CSetupSharedInterface: wiringPiI2CSetupShared:
+ *	As above, but rather than opening the adapter again for every device,
+ *	share one open adapter between all the devices on it, and return a
+ *	handle for use with the rest of the wiringPiI2C functions. The
+ *	handle is not a file descriptor, so use wiringPiI2CReadRaw () and
+ *	friends rather than read () and write () on it.
+ *********************************************************************************
+ */
+
+int wiringPiI2CSetupSharedInterface (const char *device, int devId)
+{
+  struct i2cBus *bus ;
+  struct i2cDev *dev ;
+  int handle ;
+
+  pthread_mutex_lock (&i2cSetupLock) ;
+
+  for (handle = 0 ; handle < I2C_MAX_HANDLES ; ++handle)
+    if (i2cDevs [handle] == NULL)
+      break ;
+
+  if (handle == I2C_MAX_HANDLES)
+  {
+    pthread_mutex_unlock (&i2cSetupLock) ;
+    return wiringPiFailure (WPI_ALMOST, "Unable to setup I2C device: Too many devices\n") ;
+  }
+
+  for (bus = i2cBuses ; bus != NULL ; bus = bus->next)
+    if (strcmp (bus->device, device) == 0)
+      break ;
+
+  if (bus == NULL)
+  {
+    if ((bus = calloc (1, sizeof (struct i2cBus))) == NULL)
+    {
+      pthread_mutex_unlock (&i2cSetupLock) ;
+      return wiringPiFailure (WPI_ALMOST, "Unable to allocate memory: %s\n", strerror (errno)) ;
+    }
+
+    if ((bus->fd = open (device, O_RDWR)) < 0)
+    {
+      free (bus) ;
+      pthread_mutex_unlock (&i2cSetupLock) ;
+      return wiringPiFailure (WPI_ALMOST, "Unable to open I2C device: %s\n", strerror (errno)) ;
+    }
+
+    if (ioctl (bus->fd, I2C_FUNCS, &bus->funcs) < 0)
+      bus->funcs = 0 ;
+
+    bus->device = strdup (device) ;
+    bus->addr   = -1 ;
+    pthread_mutex_init (&bus->lock, NULL) ;
+
+    bus->next = i2cBuses ;
+    i2cBuses  = bus ;
+  }
+
+  if ((dev = malloc (sizeof (struct i2cDev))) == NULL)
+  {
+    pthread_mutex_unlock (&i2cSetupLock) ;
+    return wiringPiFailure (WPI_ALMOST, "Unable to allocate memory: %s\n", strerror (errno)) ;
+  }
+
+  dev->bus   = bus ;
+  dev->devId = devId ;
+  ++bus->users ;
+
+  i2cDevs [handle] = dev ;
+
+  pthread_mutex_unlock (&i2cSetupLock) ;
+
+  return I2C_HANDLE_BASE + handle ;
+}
+
+int wiringPiI2CSetupShared (const int devId)
+{
+  return wiringPiI2CSetupSharedInterface (i2cDefaultDevice (), devId) ;
+}
+
+
+/*
+ * wiringPiI2CClose:
+ *	Release a device handle or close a file descriptor. A shared adapter
+ *	is closed when the last device on it goes.
+ *********************************************************************************
+ */
+
+void wiringPiI2CClose (int fd)
+{
+  struct i2cDev  *dev ;
+  struct i2cBus  *bus, **prev ;
+
+  if ((dev = i2cGetDev (fd)) == NULL)
+  {
+    if ((fd >= 0) && (fd < I2C_MAX_FDS))
+      i2cDevIds [fd] = 0 ;
+    close (fd) ;
+    return ;
+  }
+
+  pthread_mutex_lock (&i2cSetupLock) ;
+
+  i2cDevs [fd - I2C_HANDLE_BASE] = NULL ;
+  bus = dev->bus ;
+  free (dev) ;
+
+  if (--bus->users == 0)
+  {
+    for (prev = &i2cBuses ; *prev != bus ; prev = &(*prev)->next)
+      ;
+    *prev = bus->next ;
+
+    close (bus->fd) ;
+    pthread_mutex_destroy (&bus->lock) ;
+    free (bus->device) ;
+    free (bus) ;
+  }
+
+  pthread_mutex_unlock (&i2cSetupLock) ;
+}
+
+
+/*
+ * wiringPiI2CFuncs:
+ *	Return the adapter's I2C_FUNC_xxx functionality mask
+ *********************************************************************************
+ */
+
+unsigned long wiringPiI2CFuncs (int fd)
+{
+  struct i2cDev *dev ;
+  unsigned long funcs ;
+
+  if ((dev = i2cGetDev (fd)) != NULL)
+    return dev->bus->funcs ;
+
+  if (ioctl (fd, I2C_FUNCS, &funcs) < 0)
+    return 0 ;
+
+  return funcs ;
+}
+
+
+/*
+ * wiringPiI2CStats:
+ *	Take a copy of the transfer counters for the bus a shared device
+ *	handle is on.
+ *********************************************************************************
+ */
+
+int wiringPiI2CStats (int fd, struct wiringPiI2CStats *stats)
+{
+  struct i2cDev *dev ;
+
+  if ((dev = i2cGetDev (fd)) == NULL)
+    return -1 ;
+
+  pthread_mutex_lock (&dev->bus->lock) ;
+    *stats = dev->bus->stats ;
+  pthread_mutex_unlock (&dev->bus->lock) ;
+
+  return 0 ;
 }
@@ -22,6 +22,44 @@
  ***********************************************************************
  */
 
+#ifndef	_STDINT_H
+#  include <stdint.h>
+#endif
+
+// Message flags for wiringPiI2CTransfer ()
+//	These are the kernel's I2C_M_xxx values
+
+#define	WPI_I2C_M_RD		0x0001	// Read data, from slave to master
+#define	WPI_I2C_M_TEN		0x0010	// This is a ten bit chip address
+#define	WPI_I2C_M_NO_RD_ACK	0x0800	// Don't ACK the last byte of a read
+#define	WPI_I2C_M_IGNORE_NAK	0x1000	// Carry on after a NAK
+#define	WPI_I2C_M_REV_DIR_ADDR	0x2000	// Invert the R/W bit
+#define	WPI_I2C_M_NOSTART	0x4000	// No (repeated) start before this message
+#define	WPI_I2C_M_STOP		0x8000	// Send a STOP after this message
+
+// wiringPiI2CMsg:
+//	One message of a combined transaction. Same layout as the kernel's
+//	struct i2c_msg so it can be handed straight to the I2C_RDWR ioctl.
+
+struct wiringPiI2CMsg
+{
+  uint16_t  addr ;
+  uint16_t  flags ;
+  uint16_t  len ;
+  uint8_t  *buf ;
+} ;
+
+// wiringPiI2CStats:
+//	Transfer counters kept for each shared bus
+
+struct wiringPiI2CStats
+{
+  unsigned long transactions ;
+  unsigned long bytes ;
+  unsigned long errors ;
+  unsigned long selects ;	// Number of times I2C_SLAVE had to be changed
+} ;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -34,9 +72,25 @@ extern int wiringPiI2CWrite          (int fd, int data) ;
 extern int wiringPiI2CWriteReg8      (int fd, int reg, int data) ;
 extern int wiringPiI2CWriteReg16     (int fd, int reg, int data) ;
 
+extern int wiringPiI2CReadRaw        (int fd, uint8_t *data, int len) ;
+extern int wiringPiI2CWriteRaw       (int fd, const uint8_t *data, int len) ;
+extern int wiringPiI2CReadBlock      (int fd, int reg, uint8_t *data, int len) ;
+extern int wiringPiI2CWriteBlock     (int fd, int reg, const uint8_t *data, int len) ;
+extern int wiringPiI2CReadBlockData  (int fd, int reg, uint8_t *data) ;
+extern int wiringPiI2CWriteBlockData (int fd, int reg, const uint8_t *data, int len) ;
+extern int wiringPiI2CReadI2CBlock   (int fd, int reg, uint8_t *data, int len) ;
+extern int wiringPiI2CWriteI2CBlock  (int fd, int reg, const uint8_t *data, int len) ;
+extern int wiringPiI2CTransfer       (int fd, struct wiringPiI2CMsg *msgs, int count) ;
+
 extern int wiringPiI2CSetupInterface (const char *device, int devId) ;
 extern int wiringPiI2CSetup          (const int devId) ;
 
+extern int wiringPiI2CSetupSharedInterface (const char *device, int devId) ;
+extern int wiringPiI2CSetupShared    (const int devId) ;
+extern void wiringPiI2CClose         (int fd) ;
+extern unsigned long wiringPiI2CFuncs (int fd) ;
+extern int wiringPiI2CStats          (int fd, struct wiringPiI2CStats *stats) ;
+
 #ifdef __cplusplus
 }
 #endif
@@ -86,6 +86,53 @@ int wiringPiSPIDataRW (int channel, unsigned char *data, int len)
 }
 
 
+/*
+ * wiringPiSPIDataRWChain:
+ *	Do count separate transfers of len bytes each, back to back in a
+ *	single ioctl. The chip select is released between them, so this suits
+ *	devices like ADCs that need a fresh CS for each conversion, without
+ *	paying for a system call per conversion.
+ *	data holds count * len bytes and is overwritten like wiringPiSPIDataRW.
+ *********************************************************************************
+ */
+
+#define	SPI_CHAIN_MAX	64
+
+int wiringPiSPIDataRWChain (int channel, unsigned char *data, int len, int count)
+{
+  struct spi_ioc_transfer spi [SPI_CHAIN_MAX] ;
+  int i, n, res, total = 0 ;
+
+  channel &= 1 ;
+
+  while (count > 0)
+  {
+    n = (count > SPI_CHAIN_MAX) ? SPI_CHAIN_MAX : count ;
+
+    memset (spi, 0, sizeof (spi)) ;
+    for (i = 0 ; i < n ; ++i)
+    {
+      spi [i].tx_buf        = (unsigned long)(data + i * len) ;
+      spi [i].rx_buf        = (unsigned long)(data + i * len) ;
+      spi [i].len           = len ;
+      spi [i].delay_usecs   = spiDelay ;
+      spi [i].speed_hz      = spiSpeeds [channel] ;
+      spi [i].bits_per_word = spiBPW ;
+      spi [i].cs_change     = (i != n - 1) ;	// Not on the last or it stays selected
+    }
+
+    if ((res = ioctl (spiFds [channel], SPI_IOC_MESSAGE(n), spi)) < 0)
+      return res ;
+
+    total += res ;
+    data  += n * len ;
+    count -= n ;
+  }
+
+  return total ;
+}
+
+
 /*
  * wiringPiSPISetup:
  *	Open the SPI device, and set it up, etc.
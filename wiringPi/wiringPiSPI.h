@@ -28,6 +28,7 @@ extern "C" {
 
 int wiringPiSPIGetFd  (int channel) ;
 int wiringPiSPIDataRW (int channel, unsigned char *data, int len) ;
+int wiringPiSPIDataRWChain (int channel, unsigned char *data, int len, int count) ;
 int wiringPiSPISetup  (int channel, int speed) ;
 
 #ifdef __cplusplus
@@ -31,46 +31,187 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <linux/serial.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 
+#include "wiringPi.h"
 #include "wiringSerial.h"
 
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
+// Buffered ports:
+//	serialSetBuffered () hangs one of these off a port. Output is
+//	collected in tx and sent with a single writev () when it fills up,
+//	on serialFlushTx (), or before we wait for input. Input is read
+//	into the rx ring by one epoll thread shared by all the ports.
+
+#define	SERIAL_PORTS	8
+
+struct serialPort
+{
+  volatile int    inUse ;
+  int             fd ;
+  int             ready ;		// Locks & cond initialised
+  pthread_mutex_t lock ;		// The rx side and inUse
+  pthread_cond_t  cond ;		// Signalled when input arrives
+  pthread_mutex_t txLock ;		// The tx side - taken before lock, never inside it
+
+  unsigned char  *tx ;
+  int             txSize, txLen ;
+
+  unsigned char  *rx ;
+  unsigned int    rxMask ;
+  unsigned int    rxHead, rxTail ;	// Free running
+  int             rxPaused ;		// Ring was full; reader not re-armed
+  int             rxError ;		// Read failed - hung up or the like
+
+  struct serialStats stats ;
+} ;
+
+static struct serialPort ports [SERIAL_PORTS] ;
+static pthread_mutex_t   portsLock = PTHREAD_MUTEX_INITIALIZER ;
+static int               epollFd   = -1 ;
+static pthread_t         readerThread ;
+
+// RS-485 ports:
+//	serialSetRS485 () registers these. With a driver enable pin we
+//	raise it around every write ourselves; otherwise the kernel does
+//	it with RTS and there's only the frame gap for us to keep.
+
+struct rs485Port
+{
+  volatile int       inUse ;
+  int                fd ;
+  int                dePin ;		// -1 when the kernel does it
+  int                gapUs ;		// Quiet time between frames
+  unsigned long long lastEnd ;		// When the line last went quiet, nS
+} ;
+
+static struct rs485Port rs485 [SERIAL_PORTS] ;
+
 /*
- * serialOpen:
- *	Open and initialise the serial port, setting all the right
- *	port parameters - or as many as are required - hopefully!
+ * Baud rates:
+ *	The standard rates go through the usual termios calls. Anything
+ *	else is set with the termios2 ioctls and BOTHER, which glibc's
+ *	<termios.h> doesn't give us, so we carry our own copy of the
+ *	kernel's structure.
  *********************************************************************************
  */
 
-int serialOpen (const char *device, const int baud)
+struct serialTermios2
+{
+  tcflag_t c_iflag ;
+  tcflag_t c_oflag ;
+  tcflag_t c_cflag ;
+  tcflag_t c_lflag ;
+  cc_t     c_line ;
+  cc_t     c_cc [19] ;
+  speed_t  c_ispeed ;
+  speed_t  c_ospeed ;
+} ;
+
+#define	SERIAL_TCGETS2	_IOR ('T', 0x2A, struct serialTermios2)
+#define	SERIAL_TCSETS2	_IOW ('T', 0x2B, struct serialTermios2)
+
+#ifndef	BOTHER
+#  define	BOTHER	0010000
+#endif
+
+static const struct
+{
+  int     baud ;
+  speed_t speed ;
+} baudRates [] =
+{
+  {      50,      B50 }, {      75,      B75 }, {     110,     B110 },
+  {     134,     B134 }, {     150,     B150 }, {     200,     B200 },
+  {     300,     B300 }, {     600,     B600 }, {    1200,    B1200 },
+  {    1800,    B1800 }, {    2400,    B2400 }, {    4800,    B4800 },
+  {    9600,    B9600 }, {   19200,   B19200 }, {   38400,   B38400 },
+  {   57600,   B57600 }, {  115200,  B115200 }, {  230400,  B230400 },
+  {  460800,  B460800 }, {  500000,  B500000 }, {  576000,  B576000 },
+  {  921600,  B921600 }, { 1000000, B1000000 }, { 1152000, B1152000 },
+  { 1500000, B1500000 }, { 2000000, B2000000 }, { 2500000, B2500000 },
+  { 3000000, B3000000 }, { 3500000, B3500000 }, { 4000000, B4000000 },
+  {       0,        0 }
+} ;
+
+static speed_t standardBaud (const int baud)
+{
+  int i ;
+
+  for (i = 0 ; baudRates [i].baud != 0 ; ++i)
+    if (baudRates [i].baud == baud)
+      return baudRates [i].speed ;
+
+  return 0 ;
+}
+
+static int setCustomBaud (const int fd, const int baud)
+{
+  struct serialTermios2 tio ;
+
+  if (ioctl (fd, SERIAL_TCGETS2, &tio) < 0)
+    return -1 ;
+
+  tio.c_cflag &= ~CBAUD ;
+  tio.c_cflag |= BOTHER ;
+  tio.c_ispeed = tio.c_ospeed = baud ;
+
+  return ioctl (fd, SERIAL_TCSETS2, &tio) ;
+}
+
+
+/*
+ * setLowLatency:
+ *	Ask the UART driver not to hold received data back. Not all
+ *	drivers (or ptys) support it, and it's only a hint, so failures
+ *	are ignored.
+ *********************************************************************************
+ */
+
+static void setLowLatency (const int fd)
+{
+  struct serial_struct serial ;
+
+  if (ioctl (fd, TIOCGSERIAL, &serial) < 0)
+    return ;
+
+  serial.flags |= ASYNC_LOW_LATENCY ;
+  (void)ioctl (fd, TIOCSSERIAL, &serial) ;
+}
+
+
+/*
+ * serialOpenEx:
+ *	Open and initialise the serial port as described by config.
+ *	Returns the file descriptor, -1 if the port can't be opened, or
+ *	-2 if the configuration is invalid or the port won't accept it.
+ *********************************************************************************
+ */
+
+int serialOpenEx (const char *device, const struct serialConfig *config)
 {
   struct termios options ;
   speed_t myBaud ;
   int     status, fd ;
 
-  switch (baud)
-  {
-    case     50:	myBaud =     B50 ; break ;
-    case     75:	myBaud =     B75 ; break ;
-    case    110:	myBaud =    B110 ; break ;
-    case    134:	myBaud =    B134 ; break ;
-    case    150:	myBaud =    B150 ; break ;
-    case    200:	myBaud =    B200 ; break ;
-    case    300:	myBaud =    B300 ; break ;
-    case    600:	myBaud =    B600 ; break ;
-    case   1200:	myBaud =   B1200 ; break ;
-    case   1800:	myBaud =   B1800 ; break ;
-    case   2400:	myBaud =   B2400 ; break ;
-    case   4800:	myBaud =   B4800 ; break ;
-    case   9600:	myBaud =   B9600 ; break ;
-    case  19200:	myBaud =  B19200 ; break ;
-    case  38400:	myBaud =  B38400 ; break ;
-    case  57600:	myBaud =  B57600 ; break ;
-    case 115200:	myBaud = B115200 ; break ;
-    case 230400:	myBaud = B230400 ; break ;
-
-    default:
-      return -2 ;
-  }
+  if ((config->baud <= 0)
+	|| (config->dataBits < 5) || (config->dataBits > 8)
+	|| (config->stopBits < 1) || (config->stopBits > 2)
+	|| (config->vmin < 0) || (config->vmin > 255)
+	|| (config->vtime < 0) || (config->vtime > 255))
+    return -2 ;
+
+  myBaud = standardBaud (config->baud) ;
 
   if ((fd = open (device, O_RDWR | O_NOCTTY | O_NDELAY | O_NONBLOCK)) == -1)
     return -1 ;
@@ -82,22 +223,60 @@ int serialOpen (const char *device, const int baud)
   tcgetattr (fd, &options) ;
 
     cfmakeraw   (&options) ;
-    cfsetispeed (&options, myBaud) ;
-    cfsetospeed (&options, myBaud) ;
+    if (myBaud != 0)
+    {
+      cfsetispeed (&options, myBaud) ;
+      cfsetospeed (&options, myBaud) ;
+    }
 
     options.c_cflag |= (CLOCAL | CREAD) ;
-    options.c_cflag &= ~PARENB ;
-    options.c_cflag &= ~CSTOPB ;
+
     options.c_cflag &= ~CSIZE ;
-    options.c_cflag |= CS8 ;
+    switch (config->dataBits)
+    {
+      case 5:	options.c_cflag |= CS5 ; break ;
+      case 6:	options.c_cflag |= CS6 ; break ;
+      case 7:	options.c_cflag |= CS7 ; break ;
+      default:	options.c_cflag |= CS8 ; break ;
+    }
+
+    options.c_cflag &= ~(PARENB | PARODD) ;
+    options.c_iflag &= ~INPCK ;
+    if (config->parity != SERIAL_PARITY_NONE)
+    {
+      options.c_cflag |= PARENB ;
+      options.c_iflag |= INPCK ;
+      if (config->parity == SERIAL_PARITY_ODD)
+	options.c_cflag |= PARODD ;
+    }
+
+    if (config->stopBits == 2)
+      options.c_cflag |= CSTOPB ;
+    else
+      options.c_cflag &= ~CSTOPB ;
+
+    if (config->flowControl == SERIAL_FLOW_RTSCTS)
+      options.c_cflag |= CRTSCTS ;
+    else
+      options.c_cflag &= ~CRTSCTS ;
+
     options.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG) ;
     options.c_oflag &= ~OPOST ;
 
-    options.c_cc [VMIN]  =   0 ;
-    options.c_cc [VTIME] = 100 ;	// Ten seconds (100 deciseconds)
+    options.c_cc [VMIN]  = config->vmin ;
+    options.c_cc [VTIME] = config->vtime ;
 
   tcsetattr (fd, TCSANOW | TCSAFLUSH, &options) ;
 
+  if ((myBaud == 0) && (setCustomBaud (fd, config->baud) < 0))
+  {
+    close (fd) ;
+    return -2 ;
+  }
+
+  if (config->lowLatency)
+    setLowLatency (fd) ;
+
   ioctl (fd, TIOCMGET, &status);
 
   status |= TIOCM_DTR ;
@@ -111,6 +290,570 @@ int serialOpen (const char *device, const int baud)
 }
 
 
+/*
+ * serialOpen:
+ *	Open and initialise the serial port, setting all the right
+ *	port parameters - or as many as are required - hopefully!
+ *	8 data bits, no parity, 1 stop bit and a 10 second read timeout.
+ *********************************************************************************
+ */
+
+int serialOpen (const char *device, const int baud)
+{
+  struct serialConfig config ;
+
+  serialConfigDefaults (&config, baud) ;
+
+  return serialOpenEx (device, &config) ;
+}
+
+
+/*
+ * serialConfigDefaults:
+ *	Fill in a config with what serialOpen () uses, ready to be changed
+ *********************************************************************************
+ */
+
+void serialConfigDefaults (struct serialConfig *config, const int baud)
+{
+  config->baud        = baud ;
+  config->dataBits    = 8 ;
+  config->parity      = SERIAL_PARITY_NONE ;
+  config->stopBits    = 1 ;
+  config->flowControl = SERIAL_FLOW_NONE ;
+  config->lowLatency  = FALSE ;
+  config->vmin        = 0 ;
+  config->vtime       = 100 ;	// Ten seconds (100 deciseconds)
+}
+
+
+/*
+ * findPort:
+ *	The buffering for fd, or NULL if it's a plain port
+ *********************************************************************************
+ */
+
+static struct serialPort *findPort (const int fd)
+{
+  int i ;
+
+  for (i = 0 ; i < SERIAL_PORTS ; ++i)
+    if (ports [i].inUse && (ports [i].fd == fd))
+      return &ports [i] ;
+
+  return NULL ;
+}
+
+
+/*
+ * deadlineAfter: waitUntil:
+ *	Timeouts are done against CLOCK_MONOTONIC
+ *********************************************************************************
+ */
+
+static void deadlineAfterUs (struct timespec *ts, long long uS)
+{
+  clock_gettime (CLOCK_MONOTONIC, ts) ;
+  ts->tv_sec  += uS / 1000000 ;
+  ts->tv_nsec += (uS % 1000000) * 1000L ;
+  if (ts->tv_nsec >= 1000000000L)
+  {
+    ts->tv_nsec -= 1000000000L ;
+    ++ts->tv_sec ;
+  }
+}
+
+static void deadlineAfter (struct timespec *ts, int mS)
+{
+  deadlineAfterUs (ts, (long long)mS * 1000) ;
+}
+
+static int msUntil (const struct timespec *deadline)
+{
+  struct timespec now ;
+  long long mS ;
+
+  clock_gettime (CLOCK_MONOTONIC, &now) ;
+  mS = (deadline->tv_sec - now.tv_sec) * 1000LL + (deadline->tv_nsec - now.tv_nsec) / 1000000L ;
+
+  return (mS < 0) ? 0 : (int)mS ;
+}
+
+
+/*
+ * findRS485: nowNs:
+ *********************************************************************************
+ */
+
+static struct rs485Port *findRS485 (const int fd)
+{
+  int i ;
+
+  for (i = 0 ; i < SERIAL_PORTS ; ++i)
+    if (rs485 [i].inUse && (rs485 [i].fd == fd))
+      return &rs485 [i] ;
+
+  return NULL ;
+}
+
+static unsigned long long nowNs (void)
+{
+  struct timespec ts ;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts) ;
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec ;
+}
+
+
+/*
+ * deOn: deOff:
+ *	Driver enable for an RS-485 transceiver. We can only drop it once
+ *	the last stop bit has gone: tcdrain () waits for the tty layer,
+ *	but the UART may still be shifting out its last character, so
+ *	then poll the line status register until the transmitter is empty
+ *	(bounded, in case the driver never says so). When the kernel drives
+ *	RTS we still tcdrain () so lastEnd - and the frame gap timed from
+ *	it - starts when the data has actually gone.
+ *********************************************************************************
+ */
+
+static void deOn (struct rs485Port *rs)
+{
+  if ((rs != NULL) && (rs->dePin >= 0))
+    digitalWrite (rs->dePin, HIGH) ;
+}
+
+static void deOff (const int fd, struct rs485Port *rs)
+{
+  unsigned long long giveUp ;
+  int lsr ;
+
+  if (rs == NULL)
+    return ;
+
+  if (rs->dePin >= 0)
+  {
+    tcdrain (fd) ;
+
+    giveUp = nowNs () + 10000000ULL ;	// 10mS
+    while ((ioctl (fd, TIOCSERGETLSR, &lsr) == 0) && !(lsr & TIOCSER_TEMT) && (nowNs () < giveUp))
+      ;
+
+    digitalWrite (rs->dePin, LOW) ;
+  }
+  else
+    tcdrain (fd) ;
+
+  rs->lastEnd = nowNs () ;
+}
+
+
+/*
+ * writeAll: sendOut:
+ *	Send all of the iovecs, however many writev ()s it takes. The
+ *	buffered ports are non-blocking, so wait for room when we have to.
+ *	sendOut wraps that in the RS-485 driver enable if there is one;
+ *	stats is NULL for a plain port.
+ *********************************************************************************
+ */
+
+static int writeAll (const int fd, struct serialStats *stats, struct iovec *iov, int count)
+{
+  struct pollfd pfd ;
+  ssize_t n ;
+
+  while (count > 0)
+  {
+    if ((n = writev (fd, iov, count)) < 0)
+    {
+      if (errno == EINTR)
+	continue ;
+      if (errno != EAGAIN)
+	return -1 ;
+
+      pfd.fd     = fd ;
+      pfd.events = POLLOUT ;
+      (void)poll (&pfd, 1, -1) ;
+      continue ;
+    }
+
+    if (stats != NULL)
+    {
+      ++stats->txCalls ;
+      stats->txBytes += n ;
+    }
+
+    while ((count > 0) && ((size_t)n >= iov->iov_len))
+    {
+      n -= iov->iov_len ;
+      ++iov ;
+      --count ;
+    }
+    if (count > 0)
+    {
+      iov->iov_base  = (char *)iov->iov_base + n ;
+      iov->iov_len  -= n ;
+    }
+  }
+
+  return 0 ;
+}
+
+static int sendOut (const int fd, struct serialStats *stats, struct iovec *iov, int count)
+{
+  struct rs485Port *rs = findRS485 (fd) ;
+  int result ;
+
+  deOn (rs) ;
+    result = writeAll (fd, stats, iov, count) ;
+  deOff (fd, rs) ;
+
+  return result ;
+}
+
+static void sendPlain (const int fd, const void *data, int len)
+{
+  struct iovec iov ;
+
+  iov.iov_base = (void *)data ;
+  iov.iov_len  = len ;
+
+  (void)sendOut (fd, NULL, &iov, 1) ;
+}
+
+
+/*
+ * txFlush: txWrite: txSync:
+ *	txFlush is called with txLock held and sends what's buffered, plus
+ *	any extra data in the same writev (), so large writes don't get
+ *	copied into the buffer first. Output has its own lock as it can
+ *	wait for room in the kernel, and the reader mustn't wait with it.
+ *********************************************************************************
+ */
+
+static void txFlush (struct serialPort *port, const void *extra, int extraLen)
+{
+  struct iovec iov [2] ;
+  int n = 0 ;
+
+  if (port->txLen > 0)
+  {
+    iov [n].iov_base  = port->tx ;
+    iov [n++].iov_len = port->txLen ;
+  }
+  if (extraLen > 0)
+  {
+    iov [n].iov_base  = (void *)extra ;
+    iov [n++].iov_len = extraLen ;
+  }
+
+  if (n > 0)
+    (void)sendOut (port->fd, &port->stats, iov, n) ;
+
+  port->txLen = 0 ;
+}
+
+static void txWrite (struct serialPort *port, const void *data, int len)
+{
+  pthread_mutex_lock (&port->txLock) ;
+
+  if (port->txLen + len > port->txSize)
+    txFlush (port, data, len) ;
+  else
+  {
+    memcpy (port->tx + port->txLen, data, len) ;
+    if ((port->txLen += len) == port->txSize)
+      txFlush (port, NULL, 0) ;
+  }
+
+  pthread_mutex_unlock (&port->txLock) ;
+}
+
+static void txSync (struct serialPort *port)
+{
+  pthread_mutex_lock (&port->txLock) ;
+    txFlush (port, NULL, 0) ;
+  pthread_mutex_unlock (&port->txLock) ;
+}
+
+
+/*
+ * rxArm: rxFill:
+ *	Called with the port locked. The reader is one-shot: it's re-armed
+ *	after each read while there's room in the ring. When the ring is
+ *	full it's left disarmed, so the data waits in the kernel (and flow
+ *	control can push back) until the program takes some.
+ *********************************************************************************
+ */
+
+static void rxArm (struct serialPort *port)
+{
+  struct epoll_event ev ;
+
+  ev.events   = EPOLLIN | EPOLLONESHOT ;
+  ev.data.u32 = port - ports ;
+
+  port->rxPaused = (epoll_ctl (epollFd, EPOLL_CTL_MOD, port->fd, &ev) != 0) ;
+}
+
+static void rxFill (struct serialPort *port)
+{
+  unsigned int space, head, chunk ;
+  ssize_t n ;
+  int got = FALSE ;
+
+  for (;;)
+  {
+    head  = port->rxHead & port->rxMask ;
+    space = port->rxMask + 1 - (port->rxHead - port->rxTail) ;
+    if (space == 0)
+      break ;
+
+    chunk = port->rxMask + 1 - head ;	// To the end of the ring
+    if (chunk > space)
+      chunk = space ;
+
+    if ((n = read (port->fd, port->rx + head, chunk)) > 0)
+    {
+      ++port->stats.rxCalls ;
+      port->stats.rxBytes += n ;
+      port->rxHead        += n ;
+      got = TRUE ;
+      continue ;
+    }
+
+    if ((n < 0) && (errno == EINTR))
+      continue ;
+    if ((n == 0) || (errno != EAGAIN))
+      port->rxError = TRUE ;
+    break ;
+  }
+
+  if (got || port->rxError)
+    pthread_cond_broadcast (&port->cond) ;
+
+  if (port->rxError || ((port->rxHead - port->rxTail) > port->rxMask))
+    port->rxPaused = TRUE ;
+  else
+    rxArm (port) ;
+}
+
+
+/*
+ * serialReader:
+ *	The thread that fills the rx rings
+ *********************************************************************************
+ */
+
+static void *serialReader (void *arg)
+{
+  struct epoll_event events [SERIAL_PORTS] ;
+  struct serialPort *port ;
+  int i, n ;
+
+  for (;;)
+  {
+    if ((n = epoll_wait (epollFd, events, SERIAL_PORTS, -1)) < 0)
+    {
+      if (errno == EINTR)
+	continue ;
+      break ;
+    }
+
+    for (i = 0 ; i < n ; ++i)
+    {
+      port = &ports [events [i].data.u32] ;
+
+      pthread_mutex_lock (&port->lock) ;
+	if (port->inUse)
+	  rxFill (port) ;
+      pthread_mutex_unlock (&port->lock) ;
+    }
+  }
+
+  return NULL ;
+}
+
+
+/*
+ * rxTake:
+ *	Called with the port locked. Copy len bytes out of the ring and
+ *	wake the reader up again if it was waiting for room.
+ *********************************************************************************
+ */
+
+static void rxTake (struct serialPort *port, unsigned char *buf, unsigned int len)
+{
+  unsigned int tail, chunk ;
+
+  tail  = port->rxTail & port->rxMask ;
+  chunk = port->rxMask + 1 - tail ;
+  if (chunk > len)
+    chunk = len ;
+
+  memcpy (buf,         port->rx + tail, chunk) ;
+  memcpy (buf + chunk, port->rx,        len - chunk) ;
+  port->rxTail += len ;
+
+  if (port->rxPaused && !port->rxError && (len > 0))
+    rxArm (port) ;
+}
+
+
+/*
+ * serialSetBuffered:
+ *	Turn on buffering for a port opened with serialOpen (). Output is
+ *	held until txSize bytes are waiting, serialFlushTx () is called or
+ *	we look for input - a reply can't come to a request still in the
+ *	buffer (a txSize of 0 still sends each call's data in one go); input is
+ *	read in the background into a ring of rxSize bytes, rounded up to
+ *	a power of 2. Returns 0, or -1 with errno set.
+ *********************************************************************************
+ */
+
+int serialSetBuffered (const int fd, int txSize, int rxSize)
+{
+  struct serialPort *port = NULL ;
+  struct epoll_event ev ;
+  pthread_condattr_t attr ;
+  unsigned int size ;
+  int i ;
+
+  if ((txSize < 0) || (rxSize < 1))
+  {
+    errno = EINVAL ;
+    return -1 ;
+  }
+
+  pthread_mutex_lock (&portsLock) ;
+
+  if (findPort (fd) != NULL)
+  {
+    pthread_mutex_unlock (&portsLock) ;
+    errno = EBUSY ;
+    return -1 ;
+  }
+
+  if (epollFd == -1)
+  {
+    if ((epollFd = epoll_create1 (EPOLL_CLOEXEC)) < 0)
+      goto fail ;
+    if ((errno = pthread_create (&readerThread, NULL, serialReader, NULL)) != 0)
+    {
+      close (epollFd) ;
+      epollFd = -1 ;
+      goto fail ;
+    }
+  }
+
+  for (i = 0 ; i < SERIAL_PORTS ; ++i)
+    if (!ports [i].inUse)
+    {
+      port = &ports [i] ;
+      break ;
+    }
+
+  if (port == NULL)
+  {
+    errno = ENFILE ;
+    goto fail ;
+  }
+
+  if (!port->ready)
+  {
+    pthread_mutex_init        (&port->lock,   NULL) ;
+    pthread_mutex_init        (&port->txLock, NULL) ;
+    pthread_condattr_init     (&attr) ;
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC) ;
+    pthread_cond_init         (&port->cond, &attr) ;
+    pthread_condattr_destroy  (&attr) ;
+    port->ready = TRUE ;
+  }
+
+  for (size = 1 ; size < (unsigned int)rxSize ; size <<= 1)
+    ;
+
+  port->fd     = fd ;
+  port->txSize = txSize ;
+  port->txLen  = 0 ;
+  port->rxMask = size - 1 ;
+  port->rxHead = port->rxTail = 0 ;
+  port->rxPaused = port->rxError = FALSE ;
+  memset (&port->stats, 0, sizeof (port->stats)) ;
+
+  port->tx = (txSize > 0) ? (unsigned char *)malloc (txSize) : NULL ;
+  port->rx = (unsigned char *)malloc (size) ;
+  if (((txSize > 0) && (port->tx == NULL)) || (port->rx == NULL))
+  {
+    free (port->tx) ;
+    free (port->rx) ;
+    errno = ENOMEM ;
+    goto fail ;
+  }
+
+// The reader must never block, and neither should a full tx buffer
+
+  fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK) ;
+
+  port->inUse = TRUE ;
+
+  ev.events   = EPOLLIN | EPOLLONESHOT ;
+  ev.data.u32 = port - ports ;
+  if (epoll_ctl (epollFd, EPOLL_CTL_ADD, fd, &ev) != 0)
+  {
+    port->inUse = FALSE ;
+    free (port->tx) ;
+    free (port->rx) ;
+    goto fail ;
+  }
+
+  pthread_mutex_unlock (&portsLock) ;
+  return 0 ;
+
+fail:
+  pthread_mutex_unlock (&portsLock) ;
+  return -1 ;
+}
+
+
+/*
+ * serialFlushTx:
+ *	Send any buffered output now
+ *********************************************************************************
+ */
+
+void serialFlushTx (const int fd)
+{
+  struct serialPort *port ;
+
+  if ((port = findPort (fd)) != NULL)
+    txSync (port) ;
+}
+
+
+/*
+ * serialGetStats:
+ *	Bytes moved and system calls made by a buffered port
+ *********************************************************************************
+ */
+
+int serialGetStats (const int fd, struct serialStats *stats)
+{
+  struct serialPort *port ;
+
+  if ((port = findPort (fd)) == NULL)
+    return -1 ;
+
+  pthread_mutex_lock (&port->txLock) ;
+  pthread_mutex_lock (&port->lock) ;
+    *stats = port->stats ;
+  pthread_mutex_unlock (&port->lock) ;
+  pthread_mutex_unlock (&port->txLock) ;
+
+  return 0 ;
+}
+
+
 /*
  * serialFlush:
  *	Flush the serial buffers (both tx & rx)
@@ -119,6 +862,22 @@ int serialOpen (const char *device, const int baud)
 
 void serialFlush (const int fd)
 {
+  struct serialPort *port ;
+
+  if ((port = findPort (fd)) != NULL)
+  {
+    pthread_mutex_lock (&port->txLock) ;
+    pthread_mutex_lock (&port->lock) ;
+      port->txLen  = 0 ;
+      port->rxTail = port->rxHead ;
+      tcflush (fd, TCIOFLUSH) ;
+      if (port->rxPaused && !port->rxError)
+	rxArm (port) ;
+    pthread_mutex_unlock (&port->lock) ;
+    pthread_mutex_unlock (&port->txLock) ;
+    return ;
+  }
+
   tcflush (fd, TCIOFLUSH) ;
 }
 
@@ -131,6 +890,32 @@ void serialFlush (const int fd)
 
 void serialClose (const int fd)
 {
+  struct serialPort *port ;
+  struct rs485Port  *rs ;
+
+  pthread_mutex_lock (&portsLock) ;
+
+  if ((port = findPort (fd)) != NULL)
+  {
+    epoll_ctl (epollFd, EPOLL_CTL_DEL, fd, NULL) ;
+
+    pthread_mutex_lock (&port->txLock) ;
+      txFlush (port, NULL, 0) ;
+      pthread_mutex_lock (&port->lock) ;
+	port->inUse = FALSE ;
+	free (port->tx) ;
+	free (port->rx) ;
+	port->tx = port->rx = NULL ;
+	pthread_cond_broadcast (&port->cond) ;
+      pthread_mutex_unlock (&port->lock) ;
+    pthread_mutex_unlock (&port->txLock) ;
+  }
+
+  if ((rs = findRS485 (fd)) != NULL)
+    rs->inUse = FALSE ;
+
+  pthread_mutex_unlock (&portsLock) ;
+
   close (fd) ;
 }
 
@@ -143,7 +928,12 @@ void serialClose (const int fd)
 
 void serialPutchar (const int fd, const unsigned char c)
 {
-  write (fd, &c, 1) ;
+  struct serialPort *port ;
+
+  if ((port = findPort (fd)) != NULL)
+    txWrite (port, &c, 1) ;
+  else
+    sendPlain (fd, &c, 1) ;
 }
 
 
@@ -155,38 +945,75 @@ void serialPutchar (const int fd, const unsigned char c)
 
 void serialPuts (const int fd, const char *s)
 {
-  write (fd, s, strlen (s)) ;
+  struct serialPort *port ;
+
+  if ((port = findPort (fd)) != NULL)
+    txWrite (port, s, strlen (s)) ;
+  else
+    sendPlain (fd, s, strlen (s)) ;
 }
 
 /*
  * serialPrintf:
- *	Printf over Serial
+ *	Printf over Serial. Anything that doesn't fit the stack buffer
+ *	gets formatted again into one that does.
  *********************************************************************************
  */
 
 void serialPrintf (const int fd, const char *message, ...)
 {
   va_list argp ;
-  char buffer [1024] ;
+  char buffer [1024], *big ;
+  int len ;
+
+  va_start (argp, message) ;
+    len = vsnprintf (buffer, sizeof (buffer), message, argp) ;
+  va_end (argp) ;
+
+  if (len < 0)
+    return ;
+
+  if (len < (int)sizeof (buffer))
+  {
+    serialPuts (fd, buffer) ;
+    return ;
+  }
+
+  if ((big = (char *)malloc (len + 1)) == NULL)
+    return ;
 
   va_start (argp, message) ;
-    vsnprintf (buffer, 1023, message, argp) ;
+    vsnprintf (big, len + 1, message, argp) ;
   va_end (argp) ;
 
-  serialPuts (fd, buffer) ;
+  serialPuts (fd, big) ;
+  free (big) ;
 }
 
 
 /*
  * serialDataAvail:
- *	Return the number of bytes of data avalable to be read in the serial port
+ *	Return the number of bytes of data avalable to be read in the serial port.
+ *	A buffered port sends any pending output first, as a polling loop
+ *	would otherwise wait forever for the reply to it.
  *********************************************************************************
  */
 
 int serialDataAvail (const int fd)
 {
+  struct serialPort *port ;
   int result ;
 
+  if ((port = findPort (fd)) != NULL)
+  {
+    txSync (port) ;
+
+    pthread_mutex_lock (&port->lock) ;
+      result = port->rxHead - port->rxTail ;
+    pthread_mutex_unlock (&port->lock) ;
+    return result ;
+  }
+
   if (ioctl (fd, FIONREAD, &result) == -1)
     return -1 ;
 
@@ -206,8 +1033,380 @@ int serialGetchar (const int fd)
 {
   uint8_t x ;
 
+  if (findPort (fd) != NULL)
+    return (serialRead (fd, &x, 1, 10000) == 1) ? x : -1 ;
+
   if (read (fd, &x, 1) != 1)
     return -1 ;
 
   return ((int)x) & 0xFF ;
 }
+
+
+/*
+ * waitInput:
+ *	Wait, with the port locked, until test says we have what we want,
+ *	the port fails, or the deadline passes
+ *********************************************************************************
+ */
+
+static void waitInput (struct serialPort *port, const struct timespec *deadline,
+	int (*test)(struct serialPort *port, void *arg), void *arg)
+{
+  while (port->inUse && !port->rxError && !test (port, arg))
+    if (pthread_cond_timedwait (&port->cond, &port->lock, deadline) == ETIMEDOUT)
+      break ;
+}
+
+static int haveBytes (struct serialPort *port, void *arg)
+{
+  return (port->rxHead - port->rxTail) >= *(unsigned int *)arg ;
+}
+
+struct untilArg
+{
+  unsigned int max ;
+  int          term ;
+  unsigned int len ;	// Set when we find it
+} ;
+
+static int haveTerm (struct serialPort *port, void *arg)
+{
+  struct untilArg *u = (struct untilArg *)arg ;
+  unsigned int avail = port->rxHead - port->rxTail ;
+  unsigned int i ;
+
+  for (i = 0 ; (i < avail) && (i < u->max) ; ++i)
+    if (port->rx [(port->rxTail + i) & port->rxMask] == u->term)
+    {
+      u->len = i + 1 ;
+      return TRUE ;
+    }
+
+  if (avail >= u->max)
+  {
+    u->len = u->max ;
+    return TRUE ;
+  }
+
+  return FALSE ;
+}
+
+
+/*
+ * serialRead:
+ *	Read len bytes, waiting up to timeout mS for them all to arrive.
+ *	Returns the number read - fewer than len on a timeout - or -1.
+ *	Buffered output is sent first, as we're most likely waiting for
+ *	the reply to it.
+ *********************************************************************************
+ */
+
+int serialRead (const int fd, void *buf, int len, int timeout)
+{
+  struct serialPort *port ;
+  struct timespec deadline ;
+  struct pollfd pfd ;
+  unsigned int want, avail ;
+  int n, got = 0 ;
+
+  if (len <= 0)
+    return 0 ;
+
+  deadlineAfter (&deadline, timeout) ;
+
+  if ((port = findPort (fd)) != NULL)
+  {
+    want = len ;
+
+    txSync (port) ;
+
+    pthread_mutex_lock (&port->lock) ;
+      waitInput (port, &deadline, haveBytes, &want) ;
+
+      avail = port->rxHead - port->rxTail ;
+      if (avail > want)
+	avail = want ;
+      rxTake (port, (unsigned char *)buf, avail) ;
+      got = ((avail == 0) && port->rxError) ? -1 : (int)avail ;
+    pthread_mutex_unlock (&port->lock) ;
+
+    return got ;
+  }
+
+  pfd.fd     = fd ;
+  pfd.events = POLLIN ;
+
+  while (got < len)
+  {
+    if ((n = poll (&pfd, 1, msUntil (&deadline))) < 0)
+    {
+      if (errno == EINTR)
+	continue ;
+      return (got > 0) ? got : -1 ;
+    }
+    if (n == 0)
+      break ;
+
+    if ((n = read (fd, (char *)buf + got, len - got)) <= 0)
+    {
+      if ((n < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+	continue ;
+      return (got > 0) ? got : -1 ;
+    }
+    got += n ;
+  }
+
+  return got ;
+}
+
+
+/*
+ * serialReadUntil:
+ *	Read up to and including the terminating character term, or max
+ *	bytes, waiting up to timeout mS. Returns the number read; if the
+ *	last one isn't term we ran out of room or time.
+ *********************************************************************************
+ */
+
+int serialReadUntil (const int fd, void *buf, int max, int term, int timeout)
+{
+  struct serialPort *port ;
+  struct timespec deadline ;
+  struct untilArg u ;
+  unsigned char *ptr = (unsigned char *)buf ;
+  int got, n ;
+
+  if (max <= 0)
+    return 0 ;
+
+  deadlineAfter (&deadline, timeout) ;
+
+  if ((port = findPort (fd)) != NULL)
+  {
+    u.max  = max ;
+    u.term = term & 0xFF ;
+    u.len  = 0 ;
+
+    txSync (port) ;
+
+    pthread_mutex_lock (&port->lock) ;
+      waitInput (port, &deadline, haveTerm, &u) ;
+
+      if (u.len == 0)		// Timed out - take what there is
+      {
+	u.len = port->rxHead - port->rxTail ;
+	if (u.len > u.max)
+	  u.len = u.max ;
+      }
+      rxTake (port, ptr, u.len) ;
+      got = ((u.len == 0) && port->rxError) ? -1 : (int)u.len ;
+    pthread_mutex_unlock (&port->lock) ;
+
+    return got ;
+  }
+
+// Unbuffered we can't look ahead, so it's a byte at a time
+
+  for (got = 0 ; got < max ; )
+  {
+    if ((n = serialRead (fd, ptr + got, 1, msUntil (&deadline))) <= 0)
+      return (got > 0) ? got : n ;
+    if (ptr [got++] == (term & 0xFF))
+      break ;
+  }
+
+  return got ;
+}
+
+
+/*
+ * serialSetRS485:
+ *	Put a port into RS-485 half-duplex mode. With a dePin of -1 we
+ *	ask the kernel to drive RTS as the driver enable (TIOCSRS485),
+ *	and fail if the UART driver can't. Otherwise dePin is a wiringPi
+ *	pin wired to the transceiver's DE (and /RE), which we raise for
+ *	each write and drop as soon as the transmitter is empty.
+ *	gapUs is the quiet time between frames; 0 picks the Modbus RTU
+ *	3.5 character times for the port's baud rate.
+ *********************************************************************************
+ */
+
+int serialSetRS485 (const int fd, const int dePin, int gapUs)
+{
+  struct serial_rs485 conf ;
+  struct serialTermios2 tio ;
+  struct rs485Port *rs = NULL ;
+  int i ;
+
+  if (dePin < 0)
+  {
+    memset (&conf, 0, sizeof (conf)) ;
+    conf.flags = SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND ;
+    if (ioctl (fd, TIOCSRS485, &conf) < 0)
+      return -1 ;
+  }
+  else
+  {
+    pinMode      (dePin, OUTPUT) ;
+    digitalWrite (dePin, LOW) ;
+  }
+
+// 3.5 characters of 11 bits, or 1.75mS above 19200 baud, as Modbus says
+
+  if (gapUs <= 0)
+  {
+    memset (&tio, 0, sizeof (tio)) ;
+    (void)ioctl (fd, SERIAL_TCGETS2, &tio) ;
+
+    if ((tio.c_ospeed == 0) || (tio.c_ospeed > 19200))
+      gapUs = 1750 ;
+    else
+      gapUs = (int)(38500000LL / tio.c_ospeed) ;
+  }
+
+  pthread_mutex_lock (&portsLock) ;
+
+  if ((rs = findRS485 (fd)) == NULL)
+    for (i = 0 ; i < SERIAL_PORTS ; ++i)
+      if (!rs485 [i].inUse)
+      {
+	rs = &rs485 [i] ;
+	break ;
+      }
+
+  if (rs == NULL)
+  {
+    pthread_mutex_unlock (&portsLock) ;
+    errno = ENFILE ;
+    return -1 ;
+  }
+
+  rs->fd      = fd ;
+  rs->dePin   = dePin ;
+  rs->gapUs   = gapUs ;
+  rs->lastEnd = 0 ;
+  rs->inUse   = TRUE ;
+
+  pthread_mutex_unlock (&portsLock) ;
+
+  return 0 ;
+}
+
+
+/*
+ * readSome:
+ *	Wait up to timeout uS for anything to arrive and take up to max
+ *	bytes of it. Returns the number taken, 0 on a timeout or -1.
+ *********************************************************************************
+ */
+
+static int readSome (const int fd, unsigned char *buf, int max, long long timeout)
+{
+  struct serialPort *port ;
+  struct timespec deadline, ts ;
+  struct pollfd pfd ;
+  unsigned int one = 1, avail ;
+  int n ;
+
+  if ((port = findPort (fd)) != NULL)
+  {
+    deadlineAfterUs (&deadline, timeout) ;
+
+    pthread_mutex_lock (&port->lock) ;
+      waitInput (port, &deadline, haveBytes, &one) ;
+      avail = port->rxHead - port->rxTail ;
+      if (avail > (unsigned int)max)
+	avail = max ;
+      rxTake (port, buf, avail) ;
+      n = ((avail == 0) && port->rxError) ? -1 : (int)avail ;
+    pthread_mutex_unlock (&port->lock) ;
+
+    return n ;
+  }
+
+  pfd.fd     = fd ;
+  pfd.events = POLLIN ;
+  ts.tv_sec  = timeout / 1000000 ;
+  ts.tv_nsec = (timeout % 1000000) * 1000 ;
+
+  for (;;)
+  {
+    if ((n = ppoll (&pfd, 1, &ts, NULL)) < 0)
+      return (errno == EINTR) ? 0 : -1 ;
+    if (n == 0)
+      return 0 ;
+    if ((n = read (fd, buf, max)) >= 0)
+      return n ;
+    if ((errno != EINTR) && (errno != EAGAIN))
+      return -1 ;
+  }
+}
+
+
+/*
+ * serialTransaction:
+ *	Send a request frame and collect the reply frame. We wait out the
+ *	inter-frame gap since the line was last busy, throw away anything
+ *	stale, send the request in one go, then wait up to timeout mS for
+ *	the reply to start; it's complete when the line goes quiet for the
+ *	gap (or the buffer is full). Returns the reply length, 0 if there
+ *	wasn't one, or -1.
+ *	Works on any port, but the gap only means something in RS-485 mode.
+ *********************************************************************************
+ */
+
+int serialTransaction (const int fd, const void *request, int reqLen, void *reply, int replyMax, int timeout)
+{
+  struct rs485Port *rs = findRS485 (fd) ;
+  struct serialPort *port ;
+  struct timespec ts ;
+  unsigned long long quiet ;
+  long long gap = (rs != NULL) ? rs->gapUs : 1750 ;
+  unsigned char *ptr = (unsigned char *)reply ;
+  int n, got ;
+
+  if ((rs != NULL) && (rs->lastEnd != 0))
+  {
+    quiet      = rs->lastEnd + gap * 1000ULL ;
+    ts.tv_sec  = quiet / 1000000000ULL ;
+    ts.tv_nsec = quiet % 1000000000ULL ;
+    while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+      ;
+  }
+
+// Drop stale input and anything still waiting to go
+
+  if ((port = findPort (fd)) != NULL)
+  {
+    txSync (port) ;
+
+    pthread_mutex_lock (&port->lock) ;
+      tcflush (fd, TCIFLUSH) ;
+      port->rxTail = port->rxHead ;
+      if (port->rxPaused && !port->rxError)
+	rxArm (port) ;
+    pthread_mutex_unlock (&port->lock) ;
+  }
+  else
+    tcflush (fd, TCIFLUSH) ;
+
+  sendPlain (fd, request, reqLen) ;
+
+  if ((got = readSome (fd, ptr, replyMax, (long long)timeout * 1000)) <= 0)
+    return got ;
+
+  while (got < replyMax)
+  {
+    if ((n = readSome (fd, ptr + got, replyMax - got, gap)) < 0)
+      return -1 ;
+    if (n == 0)
+      break ;
+    got += n ;
+  }
+
+  if (rs != NULL)
+    rs->lastEnd = nowNs () ;
+
+  return got ;
+}
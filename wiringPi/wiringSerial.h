@@ -20,11 +20,49 @@
  ***********************************************************************
  */
 
+// serialConfig:
+//	For serialOpenEx (). Start from serialConfigDefaults ().
+//	Any baud rate the UART can get near is allowed, not just the
+//	standard ones. vmin and vtime are the termios read policy - vtime
+//	in tenths of a second.
+
+#define	SERIAL_PARITY_NONE	0
+#define	SERIAL_PARITY_ODD	1
+#define	SERIAL_PARITY_EVEN	2
+
+#define	SERIAL_FLOW_NONE	0
+#define	SERIAL_FLOW_RTSCTS	1
+
+struct serialConfig
+{
+  int baud ;
+  int dataBits ;	// 5 to 8
+  int parity ;
+  int stopBits ;	// 1 or 2
+  int flowControl ;
+  int lowLatency ;	// Set ASYNC_LOW_LATENCY on the UART
+  int vmin ;
+  int vtime ;
+} ;
+
+// serialStats:
+//	What a buffered port has done - compare the calls with the bytes
+
+struct serialStats
+{
+  unsigned long txBytes ;
+  unsigned long txCalls ;	// writev ()s
+  unsigned long rxBytes ;
+  unsigned long rxCalls ;	// read ()s
+} ;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 extern int   serialOpen      (const char *device, const int baud) ;
+extern int   serialOpenEx    (const char *device, const struct serialConfig *config) ;
+extern void  serialConfigDefaults (struct serialConfig *config, const int baud) ;
 extern void  serialClose     (const int fd) ;
 extern void  serialFlush     (const int fd) ;
 extern void  serialPutchar   (const int fd, const unsigned char c) ;
@@ -32,6 +70,14 @@ extern void  serialPuts      (const int fd, const char *s) ;
 extern void  serialPrintf    (const int fd, const char *message, ...) ;
 extern int   serialDataAvail (const int fd) ;
 extern int   serialGetchar   (const int fd) ;
+extern int   serialRead      (const int fd, void *buf, int len, int timeout) ;
+extern int   serialReadUntil (const int fd, void *buf, int max, int term, int timeout) ;
+
+extern int   serialSetBuffered (const int fd, int txSize, int rxSize) ;
+extern int   serialSetRS485    (const int fd, const int dePin, int gapUs) ;
+extern int   serialTransaction (const int fd, const void *request, int reqLen, void *reply, int replyMax, int timeout) ;
+extern void  serialFlushTx     (const int fd) ;
+extern int   serialGetStats    (const int fd, struct serialStats *stats) ;
 
 #ifdef __cplusplus
 }
@@ -23,10 +23,16 @@
  */
 
 #include <stdint.h>
+#include <time.h>
 
 #include "wiringPi.h"
 #include "wiringShift.h"
 
+#ifndef	TRUE
+#  define	TRUE	(1==1)
+#  define	FALSE	(1==2)
+#endif
+
 /*
  * shiftIn:
  *	Shift data in from a clocked source
@@ -81,3 +87,391 @@ void shiftOut (uint8_t dPin, uint8_t cPin, uint8_t order, uint8_t val)
       digitalWrite (cPin, LOW) ;
     }
 }
+
+
+/*
+ * Buffer versions:
+ *	These resolve the pins to their GPIO bank and bit once and then toggle
+ *	them with direct (shadowed) register writes rather than going through
+ *	digitalWrite for every edge. clockHz sets the clock rate: each half
+ *	of the clock cycle, and so the data setup and hold time either side
+ *	of the rising edge, is held for 1/(2*clockHz) seconds. Use 0 to go
+ *	as fast as possible. If a pin isn't on-board (or we're in sys mode)
+ *	we fall back to digitalWrite/digitalRead with the same timing.
+ *	On return the clock pin is left low.
+ *********************************************************************************
+ */
+
+struct shiftPins
+{
+  int          dPin, cPin ;
+  int          fast ;
+  int          dBank, cBank ;
+  unsigned int dMask, cMask ;
+  long         halfPeriod ;	// nS, 0 for no delay
+  struct timespec next ;
+} ;
+
+static void shiftPinsInit (struct shiftPins *p, int dPin, int cPin, int clockHz)
+{
+  p->dPin       = dPin ;
+  p->cPin       = cPin ;
+  p->halfPeriod = (clockHz > 0) ? 500000000L / clockHz : 0 ;
+  p->fast       = (wiringPiPinToBank (dPin, &p->dBank, &p->dMask) == 0) &&
+		  (wiringPiPinToBank (cPin, &p->cBank, &p->cMask) == 0) ;
+
+  if (p->fast)
+  {
+    (void)digitalReadBank (p->dBank) ;	// Refresh the shadows
+    (void)digitalReadBank (p->cBank) ;
+  }
+
+  clock_gettime (CLOCK_MONOTONIC, &p->next) ;
+}
+
+
+/*
+ * shiftHold:
+ *	Spin until the end of the current half clock period. The deadlines
+ *	are absolute so any overrun doesn't accumulate over the buffer.
+ *********************************************************************************
+ */
+
+static void shiftHold (struct shiftPins *p)
+{
+  struct timespec now ;
+
+  if (p->halfPeriod == 0)
+    return ;
+
+  p->next.tv_nsec += p->halfPeriod ;
+  while (p->next.tv_nsec >= 1000000000L)
+  {
+    p->next.tv_nsec -= 1000000000L ;
+    ++p->next.tv_sec ;
+  }
+
+  do
+    clock_gettime (CLOCK_MONOTONIC, &now) ;
+  while ((now.tv_sec < p->next.tv_sec) || ((now.tv_sec == p->next.tv_sec) && (now.tv_nsec < p->next.tv_nsec))) ;
+}
+
+
+/*
+ * shiftClockLow:
+ *	Drop the clock and, for output, present the next data bit. When both
+ *	pins are in the same bank that's a single register write.
+ *********************************************************************************
+ */
+
+static void shiftClockLow (struct shiftPins *p, int output, int bit)
+{
+  if (!p->fast)
+  {
+    digitalWrite (p->cPin, LOW) ;
+    if (output)
+      digitalWrite (p->dPin, bit) ;
+    return ;
+  }
+
+  if (output && (p->dBank == p->cBank))
+    digitalWriteBank (p->cBank, bit ? p->dMask : 0, p->dMask | p->cMask) ;
+  else
+  {
+    digitalWriteBank (p->cBank, 0, p->cMask) ;
+    if (output)
+      digitalWriteBank (p->dBank, bit ? p->dMask : 0, p->dMask) ;
+  }
+}
+
+static void shiftClockHigh (struct shiftPins *p)
+{
+  if (p->fast)
+    digitalWriteBank (p->cBank, p->cMask, p->cMask) ;
+  else
+    digitalWrite (p->cPin, HIGH) ;
+}
+
+static int shiftSample (struct shiftPins *p)
+{
+  if (p->fast)
+    return (digitalReadBank (p->dBank) & p->dMask) != 0 ;
+  else
+    return digitalRead (p->dPin) != LOW ;
+}
+
+
+/*
+ * shiftOutBuf:
+ *	Shift len bytes out. Data changes while the clock is low and is
+ *	clocked on the rising edge.
+ *********************************************************************************
+ */
+
+void shiftOutBuf (int dPin, int cPin, int order, const uint8_t *buf, int len, int clockHz)
+{
+  struct shiftPins p ;
+  int i, j, bit ;
+
+  shiftPinsInit (&p, dPin, cPin, clockHz) ;
+
+  for (i = 0 ; i < len ; ++i)
+    for (j = 0 ; j < 8 ; ++j)
+    {
+      bit = (order == MSBFIRST) ? (buf [i] >> (7 - j)) & 1 : (buf [i] >> j) & 1 ;
+
+      shiftClockLow  (&p, TRUE, bit) ; shiftHold (&p) ;
+      shiftClockHigh (&p) ;            shiftHold (&p) ;
+    }
+
+  shiftClockLow (&p, FALSE, 0) ;
+}
+
+
+/*
+ * shiftInBuf:
+ *	Shift len bytes in. Each bit is sampled at the end of the clock low
+ *	time, just before the rising edge - i.e. we expect the device to
+ *	present the first bit before any clock, and the next one after each
+ *	clock, like the 4021, 74x165 and DS1302 do.
+ *********************************************************************************
+ */
+
+void shiftInBuf (int dPin, int cPin, int order, uint8_t *buf, int len, int clockHz)
+{
+  struct shiftPins p ;
+  int i, j ;
+  uint8_t value ;
+
+  shiftPinsInit (&p, dPin, cPin, clockHz) ;
+
+  for (i = 0 ; i < len ; ++i)
+  {
+    value = 0 ;
+    for (j = 0 ; j < 8 ; ++j)
+    {
+      shiftClockLow (&p, FALSE, 0) ; shiftHold (&p) ;
+
+      if (shiftSample (&p))
+	value |= (order == MSBFIRST) ? (0x80 >> j) : (1 << j) ;
+
+      shiftClockHigh (&p) ;          shiftHold (&p) ;
+    }
+    buf [i] = value ;
+  }
+
+  shiftClockLow (&p, FALSE, 0) ;
+}
+
+
+/*
+ * Multi-lane versions:
+ *	Several data pins sharing one clock - parallel 595 chains, a row of
+ *	NES pads, etc. - are shifted together, so each clock pulse serves
+ *	every lane. When all the data pins are in the same GPIO bank (and the
+ *	clock too, ideally) each clock phase is a single register write.
+ *	The byte streams are turned into per-clock bank masks by transposing
+ *	them 8 lanes x 8 bits at a time.
+ *	Up to SHIFT_MAX_LANES lanes; bufs [lane] points to len bytes.
+ *********************************************************************************
+ */
+
+#define	SHIFT_MAX_LANES	32
+
+struct shiftLanes
+{
+  struct shiftPins clk ;	// Clock pin and timing; dPin/dBank unused
+  int              lanes ;
+  const int       *dPins ;
+  int              fast ;
+  int              dBank ;
+  unsigned int     dMask [SHIFT_MAX_LANES] ;
+  unsigned int     allData ;
+} ;
+
+
+/*
+ * transpose8:
+ *	Transpose an 8x8 bit matrix held as 8 bytes in a 64-bit word:
+ *	bit c of byte r moves to bit r of byte c.
+ *********************************************************************************
+ */
+
+static uint64_t transpose8 (uint64_t x)
+{
+  uint64_t t ;
+
+  t = (x ^ (x >>  7)) & 0x00AA00AA00AA00AAULL ; x ^= t ^ (t <<  7) ;
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL ; x ^= t ^ (t << 14) ;
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL ; x ^= t ^ (t << 28) ;
+
+  return x ;
+}
+
+
+/*
+ * shiftLanesInit:
+ *	Returns FALSE if there are too many lanes
+ *********************************************************************************
+ */
+
+static int shiftLanesInit (struct shiftLanes *sl, const int *dPins, int lanes, int cPin, int clockHz)
+{
+  int l, bank ;
+
+  if ((lanes < 1) || (lanes > SHIFT_MAX_LANES))
+    return FALSE ;
+
+  shiftPinsInit (&sl->clk, dPins [0], cPin, clockHz) ;
+
+  sl->lanes   = lanes ;
+  sl->dPins   = dPins ;
+  sl->fast    = sl->clk.fast ;
+  sl->dBank   = sl->clk.dBank ;
+  sl->allData = 0 ;
+
+  for (l = 0 ; (l < lanes) && sl->fast ; ++l)
+  {
+    if ((wiringPiPinToBank (dPins [l], &bank, &sl->dMask [l]) != 0) || (bank != sl->dBank))
+      sl->fast = FALSE ;
+    sl->allData |= sl->dMask [l] ;
+  }
+
+  return TRUE ;
+}
+
+
+/*
+ * shiftOutLanes:
+ *	Shift len bytes out of each lane's buffer at once
+ *********************************************************************************
+ */
+
+int shiftOutLanes (const int *dPins, int lanes, int cPin, int order, const uint8_t **bufs, int len, int clockHz)
+{
+  struct shiftLanes sl ;
+  unsigned int table [SHIFT_MAX_LANES / 8][256] ;
+  uint64_t rows, cols [SHIFT_MAX_LANES / 8] ;
+  unsigned int value ;
+  int groups, g, l, i, j, v, bit ;
+
+  if (!shiftLanesInit (&sl, dPins, lanes, cPin, clockHz))
+    return -1 ;
+
+  groups = (lanes + 7) / 8 ;
+
+// For each group of 8 lanes, map a byte of lane bits to the bank's data mask
+
+  if (sl.fast)
+    for (g = 0 ; g < groups ; ++g)
+    {
+      table [g][0] = 0 ;
+      for (v = 1 ; v < 256 ; ++v)
+      {
+	for (bit = 0 ; (v & (1 << bit)) == 0 ; ++bit)
+	  ;
+	l = g * 8 + bit ;
+	table [g][v] = table [g][v & (v - 1)] | ((l < lanes) ? sl.dMask [l] : 0) ;
+      }
+    }
+
+  for (i = 0 ; i < len ; ++i)
+  {
+    for (g = 0 ; g < groups ; ++g)
+    {
+      rows = 0 ;
+      for (l = 0 ; (l < 8) && (g * 8 + l < lanes) ; ++l)
+	rows |= (uint64_t)bufs [g * 8 + l][i] << (l * 8) ;
+      cols [g] = transpose8 (rows) ;	// Byte b is now bit b of each lane
+    }
+
+    for (j = 0 ; j < 8 ; ++j)
+    {
+      bit = (order == MSBFIRST) ? 7 - j : j ;
+
+      if (sl.fast)
+      {
+	for (value = 0, g = 0 ; g < groups ; ++g)
+	  value |= table [g][(cols [g] >> (bit * 8)) & 0xFF] ;
+
+	if (sl.clk.cBank == sl.dBank)
+	  digitalWriteBank (sl.dBank, value, sl.allData | sl.clk.cMask) ;
+	else
+	{
+	  digitalWriteBank (sl.clk.cBank, 0, sl.clk.cMask) ;
+	  digitalWriteBank (sl.dBank, value, sl.allData) ;
+	}
+      }
+      else
+      {
+	digitalWrite (cPin, LOW) ;
+	for (l = 0 ; l < lanes ; ++l)
+	  digitalWrite (dPins [l], (cols [l / 8] >> (bit * 8 + (l & 7))) & 1) ;
+      }
+      shiftHold (&sl.clk) ;
+
+      shiftClockHigh (&sl.clk) ;
+      shiftHold (&sl.clk) ;
+    }
+  }
+
+  shiftClockLow (&sl.clk, FALSE, 0) ;
+
+  return 0 ;
+}
+
+
+/*
+ * shiftInLanes:
+ *	Shift len bytes into each lane's buffer at once. As with shiftInBuf
+ *	each bit is sampled just before the rising edge.
+ *********************************************************************************
+ */
+
+int shiftInLanes (const int *dPins, int lanes, int cPin, int order, uint8_t **bufs, int len, int clockHz)
+{
+  struct shiftLanes sl ;
+  uint64_t cols [SHIFT_MAX_LANES / 8], rows ;
+  unsigned int sample ;
+  int groups, g, l, i, j, bit ;
+
+  if (!shiftLanesInit (&sl, dPins, lanes, cPin, clockHz))
+    return -1 ;
+
+  groups = (lanes + 7) / 8 ;
+
+  for (i = 0 ; i < len ; ++i)
+  {
+    for (g = 0 ; g < groups ; ++g)
+      cols [g] = 0 ;
+
+    for (j = 0 ; j < 8 ; ++j)
+    {
+      bit = (order == MSBFIRST) ? 7 - j : j ;
+
+      shiftClockLow (&sl.clk, FALSE, 0) ;
+      shiftHold (&sl.clk) ;
+
+// One read of the bank samples every lane
+
+      sample = sl.fast ? digitalReadBank (sl.dBank) : 0 ;
+      for (l = 0 ; l < lanes ; ++l)
+	if (sl.fast ? ((sample & sl.dMask [l]) != 0) : (digitalRead (dPins [l]) != LOW))
+	  cols [l / 8] |= (uint64_t)1 << (bit * 8 + (l & 7)) ;
+
+      shiftClockHigh (&sl.clk) ;
+      shiftHold (&sl.clk) ;
+    }
+
+    for (g = 0 ; g < groups ; ++g)
+    {
+      rows = transpose8 (cols [g]) ;	// Back to a byte per lane
+      for (l = 0 ; (l < 8) && (g * 8 + l < lanes) ; ++l)
+	bufs [g * 8 + l][i] = (rows >> (l * 8)) & 0xFF ;
+    }
+  }
+
+  shiftClockLow (&sl.clk, FALSE, 0) ;
+
+  return 0 ;
+}
@@ -36,6 +36,12 @@ extern "C" {
 extern uint8_t shiftIn      (uint8_t dPin, uint8_t cPin, uint8_t order) ;
 extern void    shiftOut     (uint8_t dPin, uint8_t cPin, uint8_t order, uint8_t val) ;
 
+extern void    shiftOutBuf  (int dPin, int cPin, int order, const uint8_t *buf, int len, int clockHz) ;
+extern void    shiftInBuf   (int dPin, int cPin, int order,       uint8_t *buf, int len, int clockHz) ;
+
+extern int     shiftOutLanes (const int *dPins, int lanes, int cPin, int order, const uint8_t **bufs, int len, int clockHz) ;
+extern int     shiftInLanes  (const int *dPins, int lanes, int cPin, int order,       uint8_t **bufs, int len, int clockHz) ;
+
 #ifdef __cplusplus
 }
 #endif